@@ -0,0 +1,163 @@
+// ==============================================================================
+// PROJECT:         zqloader
+// FILE:            blockplanner.cpp
+// DESCRIPTION:     Implementation of class BlockPlanner
+//
+// Copyright (c) 2025 Daan Scherft [Oxidaan]
+// This project uses the MIT license. See LICENSE.txt for details.
+// ==============================================================================
+
+#include "blockplanner.h"
+#include "compressor.h"
+#include "spectrum_consts.h"        // spectrum_clock
+#include <vector>
+#include <limits>
+#include <iostream>
+
+
+namespace
+{
+// As TurboBlock::MoveToLoader: leader (500, 500), sync, minisync.
+constexpr int    sync_tstates       = 250 + 499 + 501;
+constexpr double pause_after        = 0.010;                                // sec, see EstimateHowLongSpectrumWillTakeToDecompress
+constexpr size_t automatic_min_size = 200;                                  // smaller not compressed, see TurboBlock::TryCompress
+
+
+
+// Predicted time (seconds) to load a block of given size, given size as send.
+double TurboBlockTime(double p_leader_duration, double p_byte_tstates, size_t p_size, size_t p_sent_size, bool p_is_compressed, int p_decompression_speed)
+{
+    double retval = p_leader_duration + pause_after +
+                    (sync_tstates + p_byte_tstates * double(TurboBlock::GetHeaderSize() + p_sent_size)) / spectrum::spectrum_clock;
+    if (p_is_compressed)
+    {
+        retval += double(p_size) / (1024.0 * p_decompression_speed);
+    }
+    return retval;
+}
+}   // namespace
+
+
+
+/// Size after RLE compression.
+size_t BlockPlanner::GetCompressedSize(const DataBlockView &p_data)
+{
+    Compressor<DataBlock>::RLE_Meta rle_meta{};
+    uint16_t decompress_counter = 0;
+    return Compressor<DataBlock>::Compress(DataBlock(p_data.begin(), p_data.end()), rle_meta, decompress_counter).size();
+}
+
+
+
+/// Predicted time (seconds) to load a block of given size, which is given size
+/// when RLE compressed. Takes the better of both, as allowed by compression type.
+/// As TurboBlock no compression when it does not get smaller.
+/// Returns chosen compression type as output parameter.
+double BlockPlanner::GetSegmentTime(size_t p_size, size_t p_compressed_size, CompressionType &out_compression_type) const
+{
+    double retval = TurboBlockTime(GetLeaderDuration(), GetByteTstates(), p_size, p_size, false, m_decompression_speed);
+    out_compression_type = CompressionType::none;
+    if (p_compressed_size < p_size &&
+       (m_compression_type == CompressionType::rle ||
+       (m_compression_type == CompressionType::automatic && p_size >= automatic_min_size)))
+    {
+        double rle_time = TurboBlockTime(GetLeaderDuration(), GetByteTstates(), p_size, p_compressed_size, true, m_decompression_speed);
+        if (m_compression_type == CompressionType::rle || rle_time < retval)
+        {
+            retval = rle_time;
+            out_compression_type = CompressionType::rle;
+        }
+    }
+    return retval;
+}
+
+
+
+/// Split given block when faster, and set compression type of each segment
+/// (only when automatic: eg incompressible data is faster uncompressed because of decompression time).
+/// Each piece (m_granularity bytes, last can be less) is compressed once; the compressed
+/// size of a segment is estimated as the sum of that of its pieces.
+/// best[i]: lowest time to load the first i pieces, taking any j < i as last cut point.
+MemoryBlocks BlockPlanner::Run(MemoryBlock p_block) const
+{
+    MemoryBlocks retval;
+    const size_t size = p_block.m_datablock.size();
+    const size_t pieces = (size + m_granularity - 1) / m_granularity;
+    if (m_compression_type == CompressionType::none || pieces < 2)
+    {
+        retval.push_back(std::move(p_block));
+        return retval;
+    }
+    auto Offset = [&](size_t p_piece)
+    {
+        return std::min(size, p_piece * m_granularity);
+    };
+
+    std::vector<size_t> sum_compressed(pieces + 1, 0);
+    for (size_t i = 0; i < pieces; i++)
+    {
+        sum_compressed[i + 1] = sum_compressed[i] + GetCompressedSize(DataBlockView(p_block.m_datablock, Offset(i), Offset(i + 1) - Offset(i)));
+    }
+
+    std::vector<double> best(pieces + 1, std::numeric_limits<double>::max());
+    std::vector<size_t> cut(pieces + 1, 0);          // last cut point for best[i]
+    std::vector<CompressionType> compression(pieces + 1, CompressionType::none);   // of last segment for best[i]
+    double unsplit_time = 0;
+    best[0] = 0;
+    for (size_t i = 1; i <= pieces; i++)
+    {
+        // RLE is decompressed inline (loaded at end, decompressed to start), which fails when any tail
+        // does not compress (eg incompressible data at end); TurboBlock then takes no compression.
+        bool can_inline = true;
+        for (size_t j = i; j-- > 0;)
+        {
+            size_t compressed_size = sum_compressed[i] - sum_compressed[j];
+            can_inline = can_inline && compressed_size < Offset(i) - Offset(j);
+            CompressionType compression_type;
+            double time = best[j] + GetSegmentTime(Offset(i) - Offset(j), can_inline ? compressed_size : std::numeric_limits<size_t>::max(), compression_type);
+            if (j == 0 && i == pieces)
+            {
+                unsplit_time = time;
+            }
+            if (time < best[i])
+            {
+                best[i]        = time;
+                cut[i]         = j;
+                compression[i] = compression_type;
+            }
+        }
+    }
+    auto SetCompressionType = [&](MemoryBlock &p_segment, size_t p_end_piece)
+    {
+        if (m_compression_type == CompressionType::automatic)
+        {
+            p_segment.m_compression_type = compression[p_end_piece];
+        }
+    };
+
+    std::vector<size_t> cuts;                         // cut points, backwards
+    for (size_t i = pieces; i > 0; i = cut[i])
+    {
+        cuts.push_back(cut[i]);
+    }
+    if (cuts.size() == 1)
+    {
+        SetCompressionType(p_block, pieces);
+        retval.push_back(std::move(p_block));         // not split
+        return retval;
+    }
+    std::cout << "Splitting block at " << p_block.GetStartAddress() << " (length " << size << ") in " << cuts.size() <<
+                 " blocks; predicted " << int(best[pieces] * 1000) << "ms instead of " << int(unsplit_time * 1000) << "ms" << std::endl;
+    size_t end = pieces;
+    for (auto piece : cuts)
+    {
+        MemoryBlock segment;
+        segment.m_address   = p_block.m_address + int(Offset(piece));
+        segment.m_bank      = p_block.m_bank;
+        segment.m_datablock = DataBlockView(p_block.m_datablock, Offset(piece), Offset(end) - Offset(piece));
+        SetCompressionType(segment, end);
+        retval.push_front(std::move(segment));
+        end = piece;
+    }
+    return retval;
+}
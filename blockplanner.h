@@ -0,0 +1,101 @@
+// ==============================================================================
+// PROJECT:         zqloader
+// FILE:            blockplanner.h
+// DESCRIPTION:     Definition of class BlockPlanner
+//
+// Copyright (c) 2025 Daan Scherft [Oxidaan]
+// This project uses the MIT license. See LICENSE.txt for details.
+// ==============================================================================
+
+#pragma once
+
+#include <cstdint>
+#include "types.h"              // CompressionType
+#include "loader_defaults.h"
+#include "memoryblock.h"        // MemoryBlocks
+#include "turboblock.h"         // leader_duration
+
+
+/// Splits memory blocks where that makes loading faster.
+/// Each block costs a leader, sync, header and a pause to decompress; splitting
+/// pays off when eg an incompressible part can be send uncompressed while the
+/// rest compresses better with its own RLE parameters.
+/// Per memory block, dynamic programming over cut points (at a fixed granularity)
+/// finds the split into segments with lowest predicted load time, where each segment
+/// takes the better of RLE and no compression, as TurboBlock does with CompressionType::automatic.
+/// Compressed size of a segment is estimated from its pieces, so stays linear in block size.
+/// Splitting gives views, no data is copied.
+class BlockPlanner
+{
+public:
+
+    /// Set durations (T-states) of zero and one and end of byte delay as used for turbo blocks.
+    BlockPlanner& SetDurations(int p_zero_duration, int p_one_duration, int p_end_of_byte_delay)
+    {
+        m_zero_duration     = p_zero_duration;
+        m_one_duration      = p_one_duration;
+        m_end_of_byte_delay = p_end_of_byte_delay;
+        return *this;
+    }
+
+    /// Set DeCompression speed (kb/sec) as at TurboBlocks.
+    BlockPlanner& SetDeCompressionSpeed(int p_kb_per_sec)
+    {
+        m_decompression_speed = p_kb_per_sec;
+        return *this;
+    }
+
+    /// Set compression type as at TurboBlocks; with none nothing is split.
+    BlockPlanner& SetCompressionType(CompressionType p_compression_type)
+    {
+        m_compression_type = p_compression_type;
+        return *this;
+    }
+
+    /// Blocks chained (see TurboBlocks::SetSkipPilots): an extra block only costs a short resync.
+    BlockPlanner& SetSkipPilots(bool p_to_what)
+    {
+        m_skip_pilots = p_to_what;
+        return *this;
+    }
+
+    /// Cut points are at multiples of this (bytes) from block start.
+    BlockPlanner& SetGranularity(int p_granularity)
+    {
+        m_granularity = p_granularity;
+        return *this;
+    }
+
+    /// Split given block when faster. Returns the block itself when not.
+    /// When compression type is automatic also sets the compression type of each (returned) block.
+    MemoryBlocks Run(MemoryBlock p_block) const;
+
+private:
+
+    static size_t GetCompressedSize(const DataBlockView &p_data);
+
+    double GetSegmentTime(size_t p_size, size_t p_compressed_size, CompressionType &out_compression_type) const;
+
+    // Seconds of leader before each block.
+    double GetLeaderDuration() const
+    {
+        return m_skip_pilots ? TurboBlock::resync_patterns * 1000.0 / spectrum::spectrum_clock :
+                               std::chrono::duration<double>(TurboBlock::leader_duration).count();
+    }
+
+    // T-states of an average (random) byte.
+    double GetByteTstates() const
+    {
+        return 4.0 * (m_zero_duration + m_one_duration) + m_end_of_byte_delay;
+    }
+
+private:
+
+    int              m_zero_duration       = loader_defaults::zero_duration;
+    int              m_one_duration        = loader_defaults::one_duration;
+    int              m_end_of_byte_delay   = loader_defaults::end_of_byte_delay;
+    int              m_decompression_speed = loader_defaults::decompression_speed;
+    CompressionType  m_compression_type    = loader_defaults::compression_type;
+    int              m_granularity         = 1024;
+    bool             m_skip_pilots         = false;
+}; // class BlockPlanner
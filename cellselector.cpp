@@ -0,0 +1,250 @@
+// ==============================================================================
+// PROJECT:         zqloader
+// FILE:            cellselector.cpp
+// DESCRIPTION:     Implementation of class CellSelector
+//
+// Copyright (c) 2026 Daan Scherft [Oxidaan]
+// This project uses the MIT license. See LICENSE.txt for details.
+// ==============================================================================
+
+#include "cellselector.h"
+#include "spectrum_screen.h"
+#include "color_distance.h"         // ColorDistanceRgb
+#include <algorithm>                // std::max
+#include <iterator>                 // std::prev
+#include <queue>
+#include <set>
+#include <vector>
+
+using namespace spectrum::screen;
+
+
+namespace
+{
+constexpr int cells_x        = SCREEN_WIDTH / 8;
+constexpr int cells_y        = SCREEN_HEIGHT / 8;
+constexpr int lines_per_cell = 9;               // 8 pixel lines, attribute
+
+// Offset in screen of given line (0-7 pixels, 8 attribute) of given cell.
+int GetOffset(int p_cell_x, int p_cell_y, int p_line)
+{
+    if (p_line == 8)
+    {
+        return SCREEN_PIXEL_SIZE + p_cell_y * cells_x + p_cell_x;
+    }
+    int y = p_cell_y * 8 + p_line;
+    // 0  1  0  y7 y6  y2 y1 y0    y5 y4 y3 x7 x6 x5 x4 x3
+    return (( y & 0b11000000 ) << 5 ) + (( y & 0b00000111 ) << 8 ) + (( y & 0b00111000 ) << 2 ) + p_cell_x;
+}
+
+
+
+// Visual error: distance of each pixel of the cell as shown to as new, in color.
+int GetError(const DataBlock &p_shown, const DataBlock &p_new, int p_cell_x, int p_cell_y)
+{
+    Attr shown_attr;
+    Attr new_attr;
+    shown_attr.byte = p_shown[GetOffset(p_cell_x, p_cell_y, 8)];
+    new_attr.byte   = p_new[GetOffset(p_cell_x, p_cell_y, 8)];
+    int error = 0;
+    for (int line = 0; line < 8; line++)
+    {
+        int shown = int(p_shown[GetOffset(p_cell_x, p_cell_y, line)]);
+        int news  = int(p_new[GetOffset(p_cell_x, p_cell_y, line)]);
+        for (int bit = 0; bit < 8; bit++)
+        {
+            auto shown_rgb = (shown >> bit) & 1 ? AttrInkToRgbColor(shown_attr) : AttrPaperToRgbColor(shown_attr);
+            auto new_rgb   = (news >> bit) & 1  ? AttrInkToRgbColor(new_attr)   : AttrPaperToRgbColor(new_attr);
+            error += ColorDistanceRgb(shown_rgb, new_rgb);
+        }
+    }
+    return error;
+}
+
+
+
+// Sum of visual error of all cells.
+long long GetError(const DataBlock &p_shown, const DataBlock &p_new)
+{
+    long long error = 0;
+    for (int cell = 0; cell < cells_x * cells_y; cell++)
+    {
+        error += GetError(p_shown, p_new, cell % cells_x, cell / cells_x);
+    }
+    return error;
+}
+}   // namespace
+
+
+
+/// Two ways to spend the budget, whichever leaves the least visual error:
+/// cells as ranked (best when few changed, or budget is large); or, since each
+/// block costs m_max_gap extra, a few runs of consecutive bytes with most error
+/// (best when much changed and the budget only fits a few blocks).
+DataBlock CellSelector::Run(const DataBlock &p_shown, const DataBlock &p_new) const
+{
+    std::vector<int> errors(cells_x * cells_y);
+    for (int cell = 0; cell < cells_x * cells_y; cell++)
+    {
+        errors[cell] = GetError(p_shown, p_new, cell % cells_x, cell / cells_x);
+    }
+    auto cells = SelectCells(p_shown, p_new, errors);
+    auto runs  = SelectRuns(p_shown, p_new, errors);
+    return GetError(runs, p_new) < GetError(cells, p_new) ? std::move(runs) : std::move(cells);
+}
+
+
+
+/// Greedy: take the cell with most error per byte, until the budget is used.
+/// The cost of a cell changes when a cell near it (in memory) is taken, so when a cell
+/// comes up its cost is recalculated first; when it then no longer is the best, it goes back.
+DataBlock CellSelector::SelectCells(const DataBlock &p_shown, const DataBlock &p_new, const std::vector<int> &p_errors) const
+{
+    std::set<int> taken;                // offsets of changed bytes of cells taken so far
+
+    // Extra bytes to send, when given changed byte is taken as well: as MemoryImage::GetChanged
+    // would combine them. Each block counts m_max_gap extra.
+    auto GetByteCost = [&](int p_offset)
+    {
+        auto next  = taken.lower_bound(p_offset);
+        bool left  = next != taken.begin() && p_offset - *std::prev(next) - 1 <= m_max_gap;
+        bool right = next != taken.end() && *next - p_offset - 1 <= m_max_gap;
+        int  prev  = left  ? *std::prev(next) : 0;
+        if (left && right && *next - prev - 1 <= m_max_gap)
+        {
+            return 0;                   // between changed bytes already send along
+        }
+        return left && right ? *next - prev - 1 - m_max_gap :
+               left          ? p_offset - prev :
+               right         ? *next - p_offset :
+                               m_max_gap + 1;
+    };
+    auto ForEachChanged = [&](int p_cell, auto p_function)
+    {
+        for (int line = 0; line < lines_per_cell; line++)
+        {
+            int offset = GetOffset(p_cell % cells_x, p_cell / cells_x, line);
+            if (p_shown[offset] != p_new[offset])
+            {
+                p_function(offset);
+            }
+        }
+    };
+    auto GetCost = [&](int p_cell)
+    {
+        int cost = 0;
+        std::vector<int> added;
+        ForEachChanged(p_cell, [&](int p_offset)
+        {
+            cost += GetByteCost(p_offset);
+            taken.insert(p_offset);
+            added.push_back(p_offset);
+        });
+        for (int offset : added)
+        {
+            taken.erase(offset);
+        }
+        return cost;
+    };
+
+    std::priority_queue<std::pair<double, int>> queue;                  // error per byte, cell
+    for (int cell = 0; cell < cells_x * cells_y; cell++)
+    {
+        if (p_errors[cell] > 0)
+        {
+            queue.emplace(double(p_errors[cell]) / std::max(1, GetCost(cell)), cell);
+        }
+    }
+
+    DataBlock retval = p_shown.Clone();
+    int size = 0;
+    while (!queue.empty() && size < m_max_size)
+    {
+        int cell = queue.top().second;
+        queue.pop();
+        int    cost = GetCost(cell);
+        double now  = double(p_errors[cell]) / std::max(1, cost);
+        if (!queue.empty() && now < queue.top().first)
+        {
+            queue.emplace(now, cell);                   // got more expensive
+            continue;
+        }
+        if (size + cost > m_max_size)
+        {
+            continue;                                   // does not fit (a smaller one might)
+        }
+        size += cost;
+        ForEachChanged(cell, [&](int p_offset)
+        {
+            taken.insert(p_offset);
+            retval[p_offset] = p_new[p_offset];
+        });
+    }
+    return retval;
+}
+
+
+
+/// The error of a cell is spread over its changed bytes. Repeatedly take the run of
+/// bytes that fits the budget left with the most error, trimmed to its changed bytes.
+DataBlock CellSelector::SelectRuns(const DataBlock &p_shown, const DataBlock &p_new, const std::vector<int> &p_errors) const
+{
+    std::vector<double> weights(SCREEN_SIZE, 0.0);
+    for (int cell = 0; cell < cells_x * cells_y; cell++)
+    {
+        std::vector<int> changed;
+        for (int line = 0; line < lines_per_cell; line++)
+        {
+            int offset = GetOffset(cell % cells_x, cell / cells_x, line);
+            if (p_shown[offset] != p_new[offset])
+            {
+                changed.push_back(offset);
+            }
+        }
+        for (int offset : changed)
+        {
+            weights[offset] = double(p_errors[cell]) / double(changed.size());
+        }
+    }
+
+    DataBlock retval = p_shown.Clone();
+    int left = m_max_size;
+    while (left > m_max_gap)
+    {
+        int length = std::min(left - m_max_gap, int(SCREEN_SIZE));
+        std::vector<double> sums(SCREEN_SIZE + 1, 0.0);             // prefix sums
+        for (int n = 0; n < SCREEN_SIZE; n++)
+        {
+            sums[n + 1] = sums[n] + weights[n];
+        }
+        int best = 0;
+        for (int n = 1; n + length <= SCREEN_SIZE; n++)
+        {
+            if (sums[n + length] - sums[n] > sums[best + length] - sums[best])
+            {
+                best = n;
+            }
+        }
+        int begin = best;
+        int end   = best + length;
+        while (begin < end && weights[begin] == 0)
+        {
+            begin++;
+        }
+        while (end > begin && weights[end - 1] == 0)
+        {
+            end--;
+        }
+        if (begin == end)
+        {
+            break;                                      // nothing (more) changed
+        }
+        for (int n = begin; n < end; n++)
+        {
+            retval[n]  = p_new[n];
+            weights[n] = 0;
+        }
+        left -= end - begin + m_max_gap;
+    }
+    return retval;
+}
@@ -0,0 +1,48 @@
+// ==============================================================================
+// PROJECT:         zqloader
+// FILE:            cellselector.h
+// DESCRIPTION:     Definition of class CellSelector
+//
+// Copyright (c) 2026 Daan Scherft [Oxidaan]
+// This project uses the MIT license. See LICENSE.txt for details.
+// ==============================================================================
+
+#pragma once
+
+#include <vector>
+#include "datablock.h"
+
+
+/// Full screen video frames (pixels plus attributes, see ZQLoader::AddFrame):
+/// selects which 8x8 cells of a new screen to send when not all that changed fits
+/// in the time budget of a frame.
+/// Cells are ranked by visual error: how much the cell as shown differs from the new
+/// one, both rendered in color (so changed pixels that look the same, eg ink and paper
+/// the same color, count for nothing), per byte it takes to send it.
+/// The 8 pixel lines and the attribute of a cell are each at other addresses, so a cell
+/// alone takes up to 9 blocks; cells near it in memory (left, right, below in the same
+/// third) extend the same blocks so are cheaper.
+/// Cells not selected keep their error, so go (first) with a next frame.
+class CellSelector
+{
+public:
+
+    /// p_max_size: bytes that fit in the budget, counting p_max_gap extra for each
+    /// (chained) block, as TurboBlocks does.
+    CellSelector(int p_max_size, int p_max_gap) :
+        m_max_size(p_max_size),
+        m_max_gap(p_max_gap)
+    {}
+
+    /// Given screen as shown and the new one (both SCREEN_SIZE: pixels plus attributes)
+    /// get screen as shown with the selected cells as new.
+    DataBlock Run(const DataBlock &p_shown, const DataBlock &p_new) const;
+
+private:
+
+    DataBlock SelectCells(const DataBlock &p_shown, const DataBlock &p_new, const std::vector<int> &p_errors) const;
+    DataBlock SelectRuns(const DataBlock &p_shown, const DataBlock &p_new, const std::vector<int> &p_errors) const;
+
+    int m_max_size;
+    int m_max_gap;
+}; // class CellSelector
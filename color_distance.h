@@ -0,0 +1,301 @@
+//==============================================================================
+// PROJECT:         zqloader
+// FILE:            color_distance.h
+// DESCRIPTION:     Distance to mean helper function. Colors as 0xAARRGGBB,
+//                  as QRgb. Not spectrum specific.
+//
+// Copyright (c) 2026 Daan Scherft [Oxidaan]
+// This project uses the MIT license. See LICENSE.txt for details.
+//==============================================================================
+
+
+#pragma once
+
+#include <span>
+#include <vector>
+#include <array>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <algorithm>
+#include <cstdint>
+
+/// Color as 0xAARRGGBB; same as QRgb, without needing Qt.
+using Rgb = uint32_t;
+
+/// As qRed.
+inline constexpr int RgbRed(Rgb p_color)
+{
+    return int(( p_color >> 16 ) & 0xff);
+}
+
+/// As qGreen.
+inline constexpr int RgbGreen(Rgb p_color)
+{
+    return int(( p_color >> 8 ) & 0xff);
+}
+
+/// As qBlue.
+inline constexpr int RgbBlue(Rgb p_color)
+{
+    return int(p_color & 0xff);
+}
+
+/// As qRgb.
+inline constexpr Rgb MakeRgb(int p_red, int p_green, int p_blue)
+{
+    return 0xff000000u | ( Rgb(p_red & 0xff) << 16 ) | ( Rgb(p_green & 0xff) << 8 ) | Rgb(p_blue & 0xff);
+}
+
+/// As qGray: (r * 11 + g * 16 + b * 5) / 32.
+inline constexpr int RgbGray(Rgb p_color)
+{
+    return ( RgbRed(p_color) * 11 + RgbGreen(p_color) * 16 + RgbBlue(p_color) * 5 ) / 32;
+}
+
+/// Distance to mean, squared.
+inline int ColorDistanceRgb(Rgb p_color1, Rgb p_color2)
+{
+    int r1 = RgbRed(p_color1);
+    int g1 = RgbGreen(p_color1);
+    int b1 = RgbBlue(p_color1);
+    int r2 = RgbRed(p_color2);
+    int g2 = RgbGreen(p_color2);
+    int b2 = RgbBlue(p_color2);
+    return ( r1 - r2 ) * ( r1 - r2 ) + ( g1 - g2 ) * ( g1 - g2 ) + ( b1 - b2 ) * ( b1 - b2 );
+}
+
+/// Hue (0-359, -1 when gray), saturation and value (0-255) as QColor has them.
+struct Hsv
+{
+    int m_hue;
+    int m_saturation;
+    int m_value;
+};
+
+/// Convert to HSV as QColor::hue(), saturation(), value(), without making QColor's.
+inline Hsv RgbToHsv(Rgb p_color)
+{
+    int r = RgbRed(p_color);
+    int g = RgbGreen(p_color);
+    int b = RgbBlue(p_color);
+    int max = std::max({ r, g, b });
+    int min = std::min({ r, g, b });
+    int delta = max - min;
+    Hsv retval{ -1, max == 0 ? 0 : (255 * delta + max / 2) / max, max };
+    if (delta != 0)
+    {
+        double hue = max == r ? double(g - b) / delta :
+                     max == g ? 2.0 + double(b - r) / delta :
+                                4.0 + double(r - g) / delta;
+        hue *= 60;
+        if (hue < 0)
+        {
+            hue += 360;
+        }
+        retval.m_hue = int(hue + 0.5) % 360;
+    }
+    return retval;
+}
+
+inline int ColorDistanceHsv(const Hsv &p_color1, const Hsv &p_color2)
+{
+    int dh = p_color1.m_hue        - p_color2.m_hue;
+    int ds = p_color1.m_saturation - p_color2.m_saturation;
+    int dv = p_color1.m_value      - p_color2.m_value;
+    return dh * dh + ds * ds + dv * dv;
+}
+
+inline int ColorDistanceHsv(Rgb p_color1, Rgb p_color2)
+{
+    return ColorDistanceHsv(RgbToHsv(p_color1), RgbToHsv(p_color2));
+}
+
+
+inline bool IsAlmostGray(Rgb p_rgb, int p_threshold = 10)
+{
+    // Saturation: 0 = gray, 255 = fully saturated
+    return RgbToHsv(p_rgb).m_saturation < p_threshold;
+}
+
+
+inline bool IsAlmostSkin(Rgb p_rgb)
+{
+    int r = RgbRed(p_rgb);
+    int g = RgbGreen(p_rgb);
+    int b = RgbBlue(p_rgb);
+
+    // Convert to YCbCr (approximation)
+    //int Y  =  0.299*r + 0.587*g + 0.114*b;
+    int Cb = int(-0.1687*r - 0.3313*g + 0.5*b + 128);
+    int Cr = int(0.5*r - 0.4187*g - 0.0813*b + 128);
+
+    // Typical skin-color range
+    return (Cb >= 77 && Cb <= 127) &&
+           (Cr >= 133 && Cr <= 173);
+}
+
+
+/// For given color, find nearest color at given palette.
+/// returns index at p_palette (0 is first) for nearest found color plus
+/// the distance (squared) to that color.
+/// Can optionally limit acceptable colors in given pallete with colors in p_which_colors.
+/// Eg to use filter out 'dark' and 'light' colors.
+/// Generic - so not spectrum specific.
+inline std::pair<int, int> GetNearestColor(const Rgb &p_color,
+    std::span<const uint32_t>p_palette, std::span<const int> p_which_colors = {} )
+{
+    int mindist{};
+    int found_index{};
+    bool first = true;
+    for(int n = 0; n < int(p_palette.size()); n++)
+    {
+        // c++23 if(std::ranges::contains(p_which_colors, n))
+        if(p_which_colors.size() == 0 || std::ranges::find(p_which_colors, n) != p_which_colors.end())
+        {
+
+            int dist = ColorDistanceRgb(p_color, p_palette[n]);
+
+            if(( dist < mindist ) || first)
+            {
+                mindist     = dist;
+                found_index = n;
+                first = false;
+            }
+        }
+    }
+    return { mindist, found_index };
+}
+
+
+inline std::pair<int, int> GetNearestColor(
+    const Rgb& p_color,
+    std::span<const uint32_t> p_palette,
+    std::initializer_list<int> colors)
+{
+    return GetNearestColor(
+        p_color,
+        p_palette,
+        std::span<const int>(colors.begin(), colors.size()));
+}
+
+
+
+/// Distance used to find nearest color.
+enum class ColorMetric
+{
+    rgb,            // ColorDistanceRgb
+    hsv,            // ColorDistanceHsv, more perceptual
+};
+
+
+
+/// As GetNearestColor but in O(1): a 32x32x32 table over RGB (5 bits per component)
+/// holds the nearest color (index at palette) for the center of each cube.
+/// So for colors near halfway two palette colors it can differ from GetNearestColor.
+/// Distance returned is exact, to the found color.
+/// Made once per palette, colors used and metric, see GetNearestColorTable.
+/// Read only after construction, so can be used from multiple threads.
+class NearestColorTable
+{
+public:
+
+    NearestColorTable(std::span<const uint32_t> p_palette, std::span<const int> p_which_colors, ColorMetric p_metric) :
+        m_palette(p_palette.begin(), p_palette.end()),
+        m_metric(p_metric)
+    {
+        std::vector<int> which(p_which_colors.begin(), p_which_colors.end());
+        if (which.empty())
+        {
+            for (int n = 0; n < int(m_palette.size()); n++)
+            {
+                which.push_back(n);
+            }
+        }
+        for (auto color : m_palette)
+        {
+            m_palette_hsv.push_back(RgbToHsv(color));
+        }
+        m_table.resize(size * size * size);
+        for (int index = 0; index < int(m_table.size()); index++)
+        {
+            // center of cube
+            Rgb color = MakeRgb(((index >> (2 * bits)) << shift) | half,
+                              (((index >> bits) & (size - 1)) << shift) | half,
+                              ((index & (size - 1)) << shift) | half);
+            Hsv hsv = RgbToHsv(color);
+            int mindist = 0;
+            bool first = true;
+            for (int n : which)
+            {
+                int dist = GetDistance(color, hsv, n);
+                if (dist < mindist || first)
+                {
+                    mindist        = dist;
+                    m_table[index] = uint8_t(n);
+                    first          = false;
+                }
+            }
+        }
+    }
+
+    /// For given color, find nearest color at palette (of the colors used).
+    /// returns distance (squared) to that color plus its index at palette, as GetNearestColor.
+    std::pair<int, int> GetNearest(Rgb p_color) const
+    {
+        int index = m_table[((RgbRed(p_color) >> shift) << (2 * bits)) | ((RgbGreen(p_color) >> shift) << bits) | (RgbBlue(p_color) >> shift)];
+        return { GetDistance(p_color, m_metric == ColorMetric::hsv ? RgbToHsv(p_color) : Hsv{}, index), index };
+    }
+
+private:
+
+    int GetDistance(Rgb p_color, const Hsv &p_hsv, int p_index) const
+    {
+        return m_metric == ColorMetric::hsv ? ColorDistanceHsv(p_hsv, m_palette_hsv[p_index]) :
+                                              ColorDistanceRgb(p_color, m_palette[p_index]);
+    }
+
+    static constexpr int bits  = 5;
+    static constexpr int size  = 1 << bits;
+    static constexpr int shift = 8 - bits;
+    static constexpr int half  = 1 << (shift - 1);
+
+    std::vector<uint32_t> m_palette;
+    std::vector<Hsv>      m_palette_hsv;
+    std::vector<uint8_t>  m_table;              // index at palette, per cube
+    ColorMetric           m_metric;
+};
+
+
+
+/// Get (make when first asked) NearestColorTable for given palette, colors used and metric.
+/// Tables are kept until the program ends. Thread safe.
+/// Get once, eg per image, then use GetNearest per pixel.
+inline const NearestColorTable& GetNearestColorTable(std::span<const uint32_t> p_palette,
+    std::span<const int> p_which_colors = {}, ColorMetric p_metric = ColorMetric::rgb)
+{
+    using Key = std::tuple<std::vector<uint32_t>, std::vector<int>, ColorMetric>;
+    static std::map<Key, std::unique_ptr<NearestColorTable>> tables;
+    static std::mutex mutex;
+    Key key{ { p_palette.begin(), p_palette.end() }, { p_which_colors.begin(), p_which_colors.end() }, p_metric };
+    std::unique_lock lock(mutex);
+    auto &table = tables[std::move(key)];
+    if (!table)
+    {
+        table = std::make_unique<NearestColorTable>(p_palette, p_which_colors, p_metric);
+    }
+    return *table;
+}
+
+
+inline const NearestColorTable& GetNearestColorTable(
+    std::span<const uint32_t> p_palette,
+    std::initializer_list<int> colors,
+    ColorMetric p_metric = ColorMetric::rgb)
+{
+    return GetNearestColorTable(
+        p_palette,
+        std::span<const int>(colors.begin(), colors.size()),
+        p_metric);
+}
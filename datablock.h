@@ -12,6 +12,9 @@
 
 #include <vector>
 #include <filesystem>
+#include <memory>           // std::shared_ptr
+#include <cstddef>          // std::byte
+#include <stdexcept>        // std::out_of_range
 
 
 /// Used for all data block storages.
@@ -55,6 +58,96 @@ public:
 
 };
 
+/// Read only view at (part of) a DataBlock that is shared (ref counted).
+/// So eg header and payload of a TurboBlock can be given to different pulsers
+/// without copying; the data exists once until the last view is gone.
+/// The viewed DataBlock can not be changed anymore, see Release to get it back.
+class DataBlockView
+{
+public:
+
+    DataBlockView() = default;
+
+    /// Take given DataBlock (move), view all of it.
+    DataBlockView(DataBlock p_data) :
+        m_data(std::make_shared<DataBlock>(std::move(p_data))),
+        m_size(m_data->size())
+    {}
+
+    /// View part of given view, sharing its data.
+    DataBlockView(const DataBlockView& p_other, size_t p_offset, size_t p_size) :
+        m_data(p_other.m_data),
+        m_offset(p_other.m_offset + p_offset),
+        m_size(p_size)
+    {
+        if (p_offset + p_size > p_other.m_size)
+        {
+            throw std::out_of_range("DataBlockView: part out of range");
+        }
+    }
+
+    DataBlockView(const DataBlockView&)              = default;
+    DataBlockView(DataBlockView&&)                   = default;
+    DataBlockView& operator = (const DataBlockView&) = default;
+    DataBlockView& operator = (DataBlockView&&)      = default;
+
+    /// Get the viewed part as a DataBlock that can be changed.
+    /// Moves the DataBlock out when this is the only view at all of it, else copies.
+    /// This view is empty after.
+    DataBlock Release() &&
+    {
+        DataBlock retval;
+        if (m_data && m_data.use_count() == 1 && m_offset == 0 && m_size == m_data->size())
+        {
+            retval = std::move(*m_data);
+        }
+        else
+        {
+            retval = DataBlock(begin(), end());
+        }
+        *this = DataBlockView();
+        return retval;
+    }
+
+    size_t size() const
+    {
+        return m_size;
+    }
+
+    bool empty() const
+    {
+        return m_size == 0;
+    }
+
+    const std::byte* data() const
+    {
+        return m_data ? m_data->data() + m_offset : nullptr;
+    }
+
+    const std::byte* begin() const
+    {
+        return data();
+    }
+
+    const std::byte* end() const
+    {
+        return data() + m_size;
+    }
+
+    const std::byte& operator[](size_t p_index) const
+    {
+        return data()[p_index];
+    }
+
+private:
+
+    std::shared_ptr<DataBlock>  m_data;          // only read, see Release
+    size_t                      m_offset = 0;
+    size_t                      m_size   = 0;
+};
+
+
+
 ///  Load (binary) from given file
 DataBlock LoadFromFile(const std::filesystem::path &p_filename);
 
@@ -0,0 +1,104 @@
+// ==============================================================================
+// PROJECT:         zqloader
+// FILE:            framescheduler.cpp
+// DESCRIPTION:     Implementation of class FrameScheduler
+//
+// Copyright (c) 2026 Daan Scherft [Oxidaan]
+// This project uses the MIT license. See LICENSE.txt for details.
+// ==============================================================================
+
+#include "framescheduler.h"
+#include <algorithm>
+#include <sstream>
+
+
+namespace
+{
+constexpr double smoothing    = 0.2;          // of averages: weight of newest
+constexpr double min_gain     = 0.2;
+constexpr double max_gain     = 1.5;
+
+template <class T>
+T Average(T p_average, T p_new, bool p_first)
+{
+    return p_first ? p_new : p_average + (p_new - p_average) * smoothing;
+}
+}   // namespace
+
+
+
+// static
+size_t FrameScheduler::SelectFrame(std::span<const TimePoint> p_capture_times, TimePoint p_show_time)
+{
+    auto Distance = [&](TimePoint p_time)
+    {
+        return p_time > p_show_time ? p_time - p_show_time : p_show_time - p_time;
+    };
+    auto best = std::min_element(p_capture_times.begin(), p_capture_times.end(), [&](TimePoint p_1, TimePoint p_2)
+    {
+        return Distance(p_1) < Distance(p_2);
+    });
+    return size_t(best - p_capture_times.begin());
+}
+
+
+
+std::chrono::milliseconds FrameScheduler::GetFrameBudget() const
+{
+    if (m_target_fps <= 0)
+    {
+        return {};
+    }
+    auto budget = std::chrono::duration_cast<std::chrono::milliseconds>(Doublesec(m_gain / m_target_fps));
+    return std::max(budget, std::chrono::milliseconds(1));
+}
+
+
+
+/// Adapt gain: airtime includes fixed cost per frame (pause, resync, headers) which
+/// the budget does not, so budget is scaled until airtime matches the frame period.
+FrameScheduler& FrameScheduler::OnFrameSend(TimePoint p_capture_time, std::chrono::microseconds p_airtime)
+{
+    m_capture_time = p_capture_time;
+    m_airtime      = Average(m_airtime, Doublesec(p_airtime), m_airtime == Doublesec{});
+    if (m_target_fps > 0 && p_airtime.count() > 0)
+    {
+        double ratio = (1.0 / m_target_fps) / Doublesec(p_airtime).count();
+        m_gain = std::clamp(Average(m_gain, m_gain * ratio, false), min_gain, max_gain);
+    }
+    return *this;
+}
+
+
+
+FrameScheduler& FrameScheduler::OnFrameShown(TimePoint p_now)
+{
+    if (m_capture_time != TimePoint{})
+    {
+        m_latency = Average(m_latency, Doublesec(p_now - m_capture_time), m_count == 0);
+    }
+    if (m_last_shown != TimePoint{} && p_now > m_last_shown)
+    {
+        m_fps = Average(m_fps, 1.0 / Doublesec(p_now - m_last_shown).count(), m_fps == 0);
+    }
+    m_last_shown = p_now;
+    m_count++;
+    return *this;
+}
+
+
+
+std::string FrameScheduler::GetReport() const
+{
+    std::stringstream report;
+    report << "Video: " << int(m_fps * 10) / 10.0 << " fps; latency " << GetLatency().count() << "ms; budget " << GetFrameBudget().count() << "ms";
+    return report.str();
+}
+
+
+
+FrameScheduler& FrameScheduler::Reset()
+{
+    *this = FrameScheduler().SetTargetFps(m_target_fps);
+    return *this;
+}
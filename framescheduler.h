@@ -0,0 +1,101 @@
+// ==============================================================================
+// PROJECT:         zqloader
+// FILE:            framescheduler.h
+// DESCRIPTION:     Definition of class FrameScheduler
+//
+// Copyright (c) 2026 Daan Scherft [Oxidaan]
+// This project uses the MIT license. See LICENSE.txt for details.
+// ==============================================================================
+
+#pragma once
+
+#include <chrono>
+#include <span>
+#include <string>
+#include "zqloader.h"           // LIB_API
+
+
+/// Schedules video frames send to the ZX Spectrum (ZQLoader::AddFrame).
+/// A frame is visible at the ZX Spectrum when its blocks are loaded, so the
+/// source frame to send is the one captured closest to that moment, not the newest
+/// (SelectFrame; when frames are known ahead, eg read from a file: VideoEncoder.
+/// Capturing live, the newest is always the closest).
+/// Airtime of each frame is known exactly (ZQLoader::GetQueuedDuration), the next
+/// one is expected to take about as long.
+/// Adapts the budget given to AddFrame (so the delta density: how many changed
+/// bytes are send per frame) to reach the target frame rate.
+/// Measures frame rate and capture-to-screen latency, see GetReport.
+/// Does not log itself: OnFrameShown can be called from a real time (audio) thread.
+class LIB_API FrameScheduler
+{
+public:
+
+    static constexpr int report_every = 50;      // frames, see IsReportDue
+
+    using Clock     = std::chrono::steady_clock;
+    using TimePoint = Clock::time_point;
+
+    /// Set target frames per second; 0 (default) is as fast as possible.
+    FrameScheduler& SetTargetFps(double p_fps)
+    {
+        m_target_fps = p_fps;
+        return *this;
+    }
+
+    /// Moment a frame send now is expected to be visible.
+    TimePoint GetShowTime(TimePoint p_now) const
+    {
+        return p_now + std::chrono::duration_cast<Clock::duration>(m_airtime);
+    }
+
+    /// Index of capture time closest to given moment.
+    /// p_capture_times must not be empty.
+    static size_t SelectFrame(std::span<const TimePoint> p_capture_times, TimePoint p_show_time);
+
+    /// Time next frame may take to send, for ZQLoader::AddFrame.
+    /// 0 when no target frame rate (no limit).
+    std::chrono::milliseconds GetFrameBudget() const;
+
+    /// A frame captured at given time was added, taking given airtime.
+    FrameScheduler& OnFrameSend(TimePoint p_capture_time, std::chrono::microseconds p_airtime);
+
+    /// Previous frame send is loaded, so now visible (eg at ZQLoader OnDone).
+    FrameScheduler& OnFrameShown(TimePoint p_now);
+
+    /// Measured frames per second.
+    double GetFps() const
+    {
+        return m_fps;
+    }
+
+    /// Measured time between capture of a frame and it being visible at the ZX Spectrum.
+    std::chrono::milliseconds GetLatency() const
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(m_latency);
+    }
+
+    /// Right after OnFrameShown: true each report_every frames, then time to log GetReport.
+    bool IsReportDue() const
+    {
+        return m_count > 0 && m_count % report_every == 0;
+    }
+
+    /// Frame rate, latency and budget as text, to log.
+    std::string GetReport() const;
+
+    /// Forget everything measured, eg when video (re)starts.
+    FrameScheduler& Reset();
+
+private:
+
+    using Doublesec = std::chrono::duration<double>;
+
+    double       m_target_fps       = 0;
+    double       m_gain             = 1.0;          // budget relative to frame period
+    Doublesec    m_airtime{};                       // average airtime of a frame
+    Doublesec    m_latency{};                       // average
+    double       m_fps              = 0;
+    TimePoint    m_capture_time{};                  // of frame send last, not shown yet
+    TimePoint    m_last_shown{};
+    int          m_count            = 0;            // frames shown
+}; // class FrameScheduler
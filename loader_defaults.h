@@ -15,6 +15,7 @@ namespace loader_tstates
 {
 // T-states. Values depend only on z80 code. See zqloader.z80asm
 constexpr int wait_for_edge_loop_duration  = 40;    // Polling loop duration
+constexpr int wait_for_edge_loop           = 43;    // T-states between IN's at WAIT_FOR_EDGE (wait_for_edge_loop1), while leader/sync
 constexpr int bit_loop_duration            = 91;    // Bit loop duration
 constexpr int byte_loop_loop_duration      = 155;   // Byte loop duration
 constexpr int end_of_byte_delay            = byte_loop_loop_duration - bit_loop_duration ;   // Extra delay at end of byte (store/crc etc)
@@ -24,6 +25,22 @@ constexpr int decompression_loop           = 72;    // min 65; realistic 72; dec
 constexpr int decompression_loop           = 72+15; // decompresion loop speed tstates/byte
 #endif
 constexpr int ldir_speed                   = spectrum::spectrum_clock / (21 * 1024);         // 21=ldir tstates. kb / second
+// DECOMPRESS, per path (no contention). See TurboBlock::GetDeCompressionTstates
+#ifndef DO_COMRESS_PAIRS
+constexpr int decompress_byte              = 65;    // normal byte
+constexpr int decompress_most              = 110;   // [code_for_most][count] (plus decompress_run_byte per byte)
+constexpr int decompress_multiples         = 137;   // [code_for_multiples][value][count] (plus decompress_run_byte per byte)
+constexpr int decompress_escape            = 107;   // code doubled, written as normal byte (worst of both codes)
+#else
+constexpr int decompress_byte              = 65+15;
+constexpr int decompress_most              = 110;
+constexpr int decompress_multiples         = 137+15;
+constexpr int decompress_pairs             = 137;   // [code_for_pairs]
+constexpr int decompress_escape            = 107+15;
+#endif
+constexpr int decompress_run_byte          = 26;    // .write_rle_bytes loop
+constexpr int decompress_counter_msb       = 26;    // each 256 codes
+constexpr int leader_min_edges             = 200;   // LEADER_MIN_EDGES: # edges a leader needs to be accepted
 }
 
 
@@ -53,4 +70,6 @@ constexpr CompressionType compression_type = CompressionType::automatic;
 constexpr int decompression_speed          = spectrum::spectrum_clock / (loader_tstates::decompression_loop * 1024);   // kb / second
 
 constexpr std::chrono::milliseconds initial_wait = 100ms;     // first wait after loading zqloader
+
+constexpr int timing_safety_margin         = 10;  // T-states each edge must be away from a wrong decision, see TimingOptimizer
 }
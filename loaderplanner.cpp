@@ -0,0 +1,160 @@
+// ==============================================================================
+// PROJECT:         zqloader
+// FILE:            loaderplanner.cpp
+// DESCRIPTION:     Implementation of class LoaderPlanner
+//
+// Copyright (c) 2025 Daan Scherft [Oxidaan]
+// This project uses the MIT license. See LICENSE.txt for details.
+// ==============================================================================
+
+#include "loaderplanner.h"
+#include "spectrum_consts.h"
+#include "spectrum_screen.h"        // SCREEN_SIZE
+#include "byte_tools.h"             // 0_byte
+#include <limits>
+#include <algorithm>          // std::fill
+
+
+namespace
+{
+constexpr int cost_extra_block  = 1000;     // header + leader + sync, takes about as long as 1000 bytes
+constexpr int cost_screen_byte  = 1;        // overwrites empty (not loaded or zero) pixels
+constexpr int cost_pixel_byte   = 4;        // overwrites loaded pixels
+constexpr int cost_attr_byte    = 8;        // overwrites attributes, garbage colors (flash)
+constexpr int screen_begin      = spectrum::SCREEN_START;
+constexpr int screen_end        = spectrum::SCREEN_START + spectrum::screen::SCREEN_SIZE;
+constexpr int memory_size       = 64 * 1024;
+
+enum class State : uint8_t
+{
+    free,           // not loaded by any block
+    zero,           // loaded with value 0
+    data,           // loaded with value != 0
+    reserved,
+};
+}
+
+
+
+/// Does the loader copied to given address need blocks to be split (so is not at screen)?
+/// The screen is loaded first, before the loader is copied, so no need to split it.
+bool LoaderPlanner::NeedsSplit(uint16_t p_address, uint16_t p_length)
+{
+    return !(p_address >= screen_begin && p_address + p_length <= screen_end);
+}
+
+
+
+/// Try each address, using running sums over a map of the final memory.
+LoaderPlacement LoaderPlanner::Run(const MemoryBlocks &p_memory_blocks) const
+{
+    std::vector<State> memory(memory_size, State::free);
+    for (int address = 0; address < spectrum::SCREEN_START; address++)
+    {
+        memory[address] = State::reserved;                  // ROM
+    }
+    for (const auto &block : p_memory_blocks)
+    {
+        if (block.m_bank >= 0)
+        {
+            // 128K: upper 16K is paged, loader can not be there.
+            std::fill(memory.begin() + 0xc000, memory.end(), State::reserved);
+            continue;
+        }
+        for (int n = 0; n < block.size() && block.GetStartAddress() + n < memory_size; n++)
+        {
+            auto &state = memory[block.GetStartAddress() + n];
+            if (state != State::reserved)
+            {
+                state = block.m_datablock[n] == 0_byte ? State::zero : State::data;
+            }
+        }
+    }
+    for (auto [start, end] : m_reserved)
+    {
+        for (int address = std::max(start, 0); address < std::min(end, memory_size); address++)
+        {
+            memory[address] = State::reserved;
+        }
+    }
+
+    // Running sums: # bytes that can not be used, screen cost, # free bytes.
+    // At screen only reserved can not be used, else also data (and zero when not allowed).
+    std::vector<int> sum_bad_screen(memory_size + 1);
+    std::vector<int> sum_bad(memory_size + 1);
+    std::vector<int> sum_cost(memory_size + 1);
+    std::vector<int> sum_free(memory_size + 1);
+    for (int address = 0; address < memory_size; address++)
+    {
+        State state = memory[address];
+        bool bad = state == State::reserved || state == State::data || (state == State::zero && !m_allow_zero);
+        int cost = 0;
+        if (address >= screen_begin && address < screen_end)
+        {
+            cost = address >= spectrum::screen::ATTR_BEGIN ? cost_attr_byte :
+                   state == State::data                    ? cost_pixel_byte :
+                                                             cost_screen_byte;
+        }
+        sum_bad_screen[address + 1] = sum_bad_screen[address] + (state == State::reserved);
+        sum_bad[address + 1]        = sum_bad[address] + bad;
+        sum_cost[address + 1]       = sum_cost[address] + cost;
+        sum_free[address + 1]       = sum_free[address] + (state == State::free);
+    }
+
+    LoaderPlacement best;
+    best.m_cost = std::numeric_limits<int>::max();
+    auto IsBetter = [&](int p_address, int p_cost)
+    {
+        return p_cost < best.m_cost || (p_cost == best.m_cost && p_address == m_preferred);
+    };
+    auto Take = [&](int p_address, int p_cost, bool p_needs_split, std::string p_reason)
+    {
+        best.m_address     = uint16_t(p_address);
+        best.m_cost        = p_cost;
+        best.m_needs_split = p_needs_split;
+        best.m_reason      = std::move(p_reason);
+    };
+
+    const int length = m_length;
+    for (int address = screen_begin; address + length <= memory_size; address++)
+    {
+        int end = address + length;
+        if (!NeedsSplit(uint16_t(address), uint16_t(length)))
+        {
+            int cost = sum_cost[end] - sum_cost[address];
+            if (sum_bad_screen[end] - sum_bad_screen[address] == 0 && IsBetter(address, cost))
+            {
+                Take(address, cost, false, "at screen so no block needs to be split; costs " +
+                     std::to_string(cost) + " for overwriting screen");
+            }
+        }
+        else if (address >= screen_end && sum_bad[end] - sum_bad[address] == 0)
+        {
+            // Each block this cuts in two gives an extra block; a block completely
+            // covered (zero) is not needed at all.
+            int extra_blocks = 0;
+            for (const auto &block : p_memory_blocks)
+            {
+                if (block.m_bank < 0 && Overlaps(block, address, end))
+                {
+                    bool before = block.GetStartAddress() < address;
+                    bool after  = block.GetEndAddress() > end;
+                    extra_blocks += (before && after) ? 1 : (!before && !after) ? -1 : 0;
+                }
+            }
+            int cost = std::max(0, extra_blocks) * cost_extra_block;
+            if (IsBetter(address, cost))
+            {
+                bool is_free = sum_free[end] - sum_free[address] == length;
+                Take(address, cost, true, (is_free ? "at free memory (not loaded)" : "at zero filled memory") +
+                     std::string("; gives ") + std::to_string(extra_blocks) + " extra block(s)");
+            }
+        }
+    }
+    if (best.m_cost == std::numeric_limits<int>::max())
+    {
+        best = LoaderPlacement{};
+        best.m_reason = "no location found";
+    }
+    return best;
+}
@@ -0,0 +1,85 @@
+// ==============================================================================
+// PROJECT:         zqloader
+// FILE:            loaderplanner.h
+// DESCRIPTION:     Definition of class LoaderPlanner
+//
+// Copyright (c) 2025 Daan Scherft [Oxidaan]
+// This project uses the MIT license. See LICENSE.txt for details.
+// ==============================================================================
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <utility>          // std::pair
+#include "memoryblock.h"    // MemoryBlocks
+
+
+/// Where to copy the loader to, as found by LoaderPlanner.
+struct LoaderPlacement
+{
+    uint16_t    m_address     = 0;       // start of free space for loader (stack first), 0 when none
+    bool        m_needs_split = false;   // blocks overlapping it must be split (not at screen)
+    int         m_cost        = 0;       // lower is better, see LoaderPlanner
+    std::string m_reason;                // why here (to show)
+};
+
+
+
+/// Finds the best place to copy the zqloader (stack, control code, ...) to when
+/// its location at BASIC gets overwritten, looking at the final memory image.
+/// Candidates (lowest cost wins):
+/// - At screen: no blocks need to be split because the screen is loaded before
+///   the loader is copied. Costs for each byte of screen that gets overwritten,
+///   more for loaded (non zero) pixels and attributes.
+/// - Free memory (not loaded by any block): costs nothing.
+/// - Zero filled memory loaded by a block (only when allowed, eg snapshots):
+///   costs for each extra block (header, sync) that splitting gives.
+/// Reserved regions (eg BASIC, loader at upper memory, snapshot stack) are never used.
+class LoaderPlanner
+{
+public:
+
+    /// Set # bytes needed (see TurboBlocks::GetLoaderCodeLength).
+    LoaderPlanner& SetLength(uint16_t p_length)
+    {
+        m_length = p_length;
+        return *this;
+    }
+
+    /// Add a region [p_start, p_end) the loader can not be copied to.
+    LoaderPlanner& AddReserved(int p_start, int p_end)
+    {
+        m_reserved.emplace_back(p_start, p_end);
+        return *this;
+    }
+
+    /// Allow using zero filled memory loaded by a block (ignoring those zeros).
+    /// Only makes sense for snapshots.
+    LoaderPlanner& SetAllowZeroRegions(bool p_allow)
+    {
+        m_allow_zero = p_allow;
+        return *this;
+    }
+
+    /// Take this address when equally good (eg screen 2/3rd where fun attributes hide it).
+    LoaderPlanner& SetPreferred(uint16_t p_address)
+    {
+        m_preferred = p_address;
+        return *this;
+    }
+
+    /// Find best location for given (final) memory blocks. Always finds one at screen.
+    LoaderPlacement Run(const MemoryBlocks &p_memory_blocks) const;
+
+    /// Does the loader copied to given address need blocks to be split (so is not at screen)?
+    static bool NeedsSplit(uint16_t p_address, uint16_t p_length);
+
+private:
+
+    uint16_t                         m_length     = 0;
+    std::vector<std::pair<int, int>> m_reserved;
+    bool                             m_allow_zero = false;
+    uint16_t                         m_preferred  = 0;
+}; // class LoaderPlanner
@@ -0,0 +1,108 @@
+// ==============================================================================
+// PROJECT:         zqloader
+// FILE:            loadersession.cpp
+// DESCRIPTION:     Implementation of class LoaderSession
+//
+// Copyright (c) 2025 Daan Scherft [Oxidaan]
+// This project uses the MIT license. See LICENSE.txt for details.
+// ==============================================================================
+
+#include "loadersession.h"
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+
+namespace
+{
+// Remove leading and trailing white space
+std::string Trim(const std::string &p_string)
+{
+    auto begin = p_string.find_first_not_of(" \t\r");
+    auto end   = p_string.find_last_not_of(" \t\r");
+    return begin == std::string::npos ? std::string() : p_string.substr(begin, end - begin + 1);
+}
+}   // namespace
+
+
+
+/// Read session (key = value lines, # comment); unknown keys are ignored.
+LoaderSession& LoaderSession::SetFilename(const fs::path &p_filename)
+{
+    m_filename = p_filename;
+    SetResident(false);
+    m_image.Clear();
+    if (!fs::exists(m_filename))
+    {
+        std::cout << "New session: " << m_filename << std::endl;
+        return *this;
+    }
+    std::ifstream fileread(m_filename);
+    if (!fileread)
+    {
+        throw std::runtime_error("Could not open session file " + m_filename.string() + " for reading");
+    }
+    std::string line;
+    while (std::getline(fileread, line))
+    {
+        auto pos = line.find('=');
+        if (line.empty() || line[0] == '#' || pos == std::string::npos)
+        {
+            continue;
+        }
+        auto key   = Trim(line.substr(0, pos));
+        auto value = Trim(line.substr(pos + 1));
+        try
+        {
+            if (key == "resident")           { m_is_resident = std::stoi(value) != 0; }
+            else if (key == "started")       { m_is_started = std::stoi(value) != 0; }
+            else if (key == "loader")        { m_parameters.m_filename = value; }
+            else if (key == "bit_loop_max")  { m_parameters.m_bit_loop_max = std::stoi(value); }
+            else if (key == "zero_max")      { m_parameters.m_zero_max = std::stoi(value); }
+            else if (key == "io_init_value") { m_parameters.m_io_init_value = std::stoi(value); }
+            else if (key == "io_xor_value")  { m_parameters.m_io_xor_value = std::stoi(value); }
+        }
+        catch (const std::logic_error &)
+        {
+            throw std::runtime_error("Session file " + m_filename.string() + ": invalid value for " + key + ": '" + value + "'");
+        }
+    }
+    std::cout << "Session: " << m_filename << "; zqloader " << (m_is_resident ? "is resident" : "not resident") <<
+                 (m_is_resident && m_is_started ? " (when the program started last returned to BASIC)" : "") << std::endl;
+    if (m_is_resident)
+    {
+        m_image.Load(GetImageFilename());
+    }
+    return *this;
+}
+
+
+
+const LoaderSession& LoaderSession::Save() const
+{
+    if (!IsSet())
+    {
+        return *this;
+    }
+    std::ofstream filewrite(m_filename);
+    if (!filewrite)
+    {
+        throw std::runtime_error("Could not open session file " + m_filename.string() + " for writing");
+    }
+    filewrite << "# zqloader session\n" <<
+                 "resident = "      << int(m_is_resident) << '\n' <<
+                 "started = "       << int(m_is_started) << '\n' <<
+                 "loader = "        << m_parameters.m_filename.string() << '\n' <<
+                 "bit_loop_max = "  << m_parameters.m_bit_loop_max << '\n' <<
+                 "zero_max = "      << m_parameters.m_zero_max << '\n' <<
+                 "io_init_value = " << m_parameters.m_io_init_value << '\n' <<
+                 "io_xor_value = "  << m_parameters.m_io_xor_value << '\n';
+    if (m_is_resident)
+    {
+        m_image.Save(GetImageFilename());
+    }
+    return *this;
+}
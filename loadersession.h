@@ -0,0 +1,122 @@
+// ==============================================================================
+// PROJECT:         zqloader
+// FILE:            loadersession.h
+// DESCRIPTION:     Definition of class LoaderSession
+//
+// Copyright (c) 2025 Daan Scherft [Oxidaan]
+// This project uses the MIT license. See LICENSE.txt for details.
+// ==============================================================================
+
+#pragma once
+
+#include <filesystem>
+#include "memoryimage.h"
+
+
+/// Parameters zqloader was patched with when it was send; a resident zqloader
+/// can only be used again when these are the same.
+struct LoaderParameters
+{
+    std::filesystem::path m_filename;               // eg path/to/zqloader48.tap
+    int                   m_bit_loop_max  = 0;      // 0 = default
+    int                   m_zero_max      = 0;      // 0 = default
+    int                   m_io_init_value = 0;
+    int                   m_io_xor_value  = 0;
+
+    bool operator == (const LoaderParameters &) const = default;
+};
+
+
+
+/// Keeps track of the ZX Spectrum during a session of loading multiple programs,
+/// so over multiple runs of zqloader.
+/// Stored as a small text file (key = value).
+/// Knows whether zqloader is resident: still present and intact at the ZX Spectrum
+/// after loading the previous program, either waiting for the next program or
+/// restartable from BASIC (RUN). Then zqloader.tap need not be send again.
+/// While resident also keeps the memory as last send (path/to/session.img), to
+/// send only what changed (delta).
+/// With delta zqloader can stay resident after starting machine code, when the
+/// program returns to BASIC leaving it alone: that is not known here, see IsStarted.
+class LoaderSession
+{
+public:
+
+    /// Set file to keep session in; reads it when it exists.
+    /// Throws when it exists but could not be read.
+    LoaderSession& SetFilename(const std::filesystem::path &p_filename);
+
+    /// Is a session file set (so in session mode)?
+    bool IsSet() const
+    {
+        return !m_filename.empty();
+    }
+
+    /// Is zqloader resident at the ZX Spectrum, patched with given parameters?
+    bool IsResident(const LoaderParameters &p_parameters) const
+    {
+        return m_is_resident && p_parameters == m_parameters;
+    }
+
+    /// Is any zqloader resident at the ZX Spectrum?
+    bool IsResident() const
+    {
+        return m_is_resident;
+    }
+
+    /// Set whether zqloader is resident at the ZX Spectrum, patched with given parameters.
+    /// Not started (see SetStarted). Not saved yet.
+    LoaderSession& SetResident(bool p_is_resident, LoaderParameters p_parameters = {})
+    {
+        m_is_resident = p_is_resident;
+        m_parameters  = std::move(p_parameters);
+        m_is_started  = false;
+        return *this;
+    }
+
+    /// Was machine code started after zqloader was last used? Then zqloader and the
+    /// memory image are only valid when the program returned to BASIC without
+    /// overwriting them, which only the user knows.
+    bool IsStarted() const
+    {
+        return m_is_started;
+    }
+
+    /// Set machine code was started after loading (see IsStarted). Not saved yet.
+    LoaderSession& SetStarted(bool p_is_started)
+    {
+        m_is_started = p_is_started;
+        return *this;
+    }
+
+    /// Memory at the ZX Spectrum as send during this session (when resident).
+    const MemoryImage& GetImage() const
+    {
+        return m_image;
+    }
+
+    /// Memory at the ZX Spectrum as send during this session. Not saved yet.
+    MemoryImage& GetImage()
+    {
+        return m_image;
+    }
+
+    /// Write session file (and memory image). No-op when no session file set.
+    /// Throws when it could not be written.
+    const LoaderSession& Save() const;
+
+private:
+
+    std::filesystem::path GetImageFilename() const
+    {
+        return std::filesystem::path(m_filename) += ".img";
+    }
+
+private:
+
+    std::filesystem::path m_filename;
+    bool                  m_is_resident = false;
+    bool                  m_is_started  = false;
+    LoaderParameters      m_parameters;
+    MemoryImage           m_image;
+}; // class LoaderSession
@@ -20,6 +20,8 @@
 
 #ifdef _WIN32
 #include <conio.h>
+#include <io.h>         // _setmode
+#include <fcntl.h>      // _O_BINARY
 #endif
 
 
@@ -27,6 +29,8 @@
 #include <iostream>
 #include <filesystem>
 #include "zqloader.h"
+#include "videoencoder.h"
+#include "temporalquantizer.h"
 #include "loader_defaults.h"
 namespace fs = std::filesystem;
 
@@ -58,6 +62,34 @@ int Key()
 
 
 
+// Video fun without ui: see 'video' option.
+void RunVideo(ZQLoader &p_zqloader, const CommandLine &p_cmdline, const std::string &p_video)
+{
+    auto mode = p_cmdline.GetParameter("video_mode", "attributes");
+    VideoEncoder encoder;
+    encoder.SetMode(mode == "screen"           ? VideoEncoder::Mode::screen :
+                    mode == "attributes_32x48" ? VideoEncoder::Mode::attributes_32x48 :
+                                                 VideoEncoder::Mode::attributes_64x24).
+            SetSourceFps(p_cmdline.GetParameter("video_fps", 25.0)).
+            SetTargetFps(p_cmdline.GetParameter("target_fps", 0.0)).
+            SetTemporalThreshold(p_cmdline.GetParameter("video_threshold", TemporalQuantizer::default_threshold));
+    if(p_video == "-")
+    {
+#ifdef _WIN32
+        _setmode(_fileno(stdin), _O_BINARY);
+#endif
+        encoder.SetInput(std::cin, p_cmdline.GetParameter("video_width", 256), p_cmdline.GetParameter("video_height", 192));
+    }
+    else
+    {
+        encoder.SetInput(fs::path(p_video));
+    }
+    p_zqloader.SetNormalFilename(p_cmdline.GetParameter("filename", ""));
+    encoder.Run(p_zqloader);
+}
+
+
+
 void Help()
 {
     ZQLoader::Version();
@@ -129,6 +161,25 @@ More options can be given with syntax: option=value, or just 'option value' or o
                             valid 'one'; above this a timeout error will occur.
                             Not giving this (or 0) uses a default that worked for me (100)
                             This value can safely been made larger, does not affect speeds.
+    chain                   Only the first turbo block gets a full (200ms) pilot tone, blocks after 
+                            that a short resync right after the pause for the block before.
+                            Faster when there are many blocks (eg snapshots).
+    session="path/to/file"  Session mode to load multiple programs after each other without sending
+                            zqloader again. The file keeps track of zqloader being resident at the
+                            ZX Spectrum (created when not present). Zqloader stays resident when after
+                            loading it is not overwritten, and it either waits for the next program
+                            (see stay) or returned to BASIC (type RUN for the next program).
+                            Only when playing sound; parameters like zero_max must stay the same.
+    stay                    When done loading do not start the program but stay in the loader
+                            waiting for the next program. (Only when it is not overwritten.)
+    delta                   With session, when zqloader is resident: send only what changed
+                            compared to what was send before, eg a rebuild of your own program.
+                            Zqloader then stays resident also when the program was started, which
+                            should return to BASIC (then type RUN) leaving BASIC alone.
+                            Memory changed by the program itself while running is not send again.
+    returned                With delta: confirm the program started last time returned to BASIC
+                            without overwriting zqloader or memory as send (nothing checks that
+                            at the ZX Spectrum). Without it all is send again.
 
 
     outputfile="path/to/filename.wav"
@@ -140,6 +191,47 @@ More options can be given with syntax: option=value, or just 'option value' or o
     tzx or -t               Write a tzx file as above with same as turbo (2nd) filename but with tzx extension. **
     overwrite or -o         When given allows overwriting above output file when already exists, else gives
                             error in that case. Eg: -wo create wav file, overwrite previous one.
+    optimize                Search the fastest zero_tstates, one_tstates and zero_max that
+                            still load every bit with a safety margin, at given samplerate (and clock).
+                            Uses and shows these as options to be used next time.
+    safety_margin = value   T-states each edge must at least be away from being read wrong. Used by
+                            optimize. Default 10.
+    verify                  Instead of playing sound render it (in memory) as a wav, then decode that using a
+                            model of the zqloader turbo loader. Shows the blocks found, their checksums and
+                            timing margins (in T-states). Uses samplerate, zero_max, bit_loop_max etc as given.
+    verifywav="path/to/filename.wav"
+                            Same as above for an existing wav file. No other files needed.
+    emulate                 Instead of playing sound render it (in memory) as a wav, then load that at an
+                            emulated ZX Spectrum (Z80 without contention). Shows exact load times (in T-states),
+                            loader errors (eg CRC ERROR) and compares memory with the given turbo file.
+    rom="path/to/48.rom"    ROM image to use with emulate: 16K for 48K, 32K (ROM 0 + ROM 1) for 128K.
+                            Then boots and types LOAD "". Without it, the normal speed blocks are decoded
+                            at the host and zqloader is started directly.
+    capture                 For a tap/tzx turbo file with a custom loader, headerless blocks or loading
+                            after USR: first load it at an emulated ZX Spectrum (needs rom=...) as from tape,
+                            with the timings as at the file, until the game started, write that as
+                            path/to/name_capture.sna, then turbo load that.
+    capture_pc=xxxx         Game started when the PC reaches this address.
+    capture_time=ms         Without capture_pc: game started this long after the end of the tape. Default 2000.
+                            Fails when then the PC is at ROM, or a loader is still waiting for the tape.
+
+    video="path/to/dir"     Video fun, without user interface: write a wav or tzx file (needs outputfile) that
+                            preloads zqloader, then shows given images one after the other at the ZX Spectrum.
+                            Images are binary PPM (P6) files at given directory, in order of name.
+                            Eg: ffmpeg -i video.mp4 -r 10 path/to/dir/%05d.ppm
+    video=-                 Same, reading raw RGB frames (3 bytes per pixel) from standard input.
+                            Eg: ffmpeg -i video.mp4 -f rawvideo -pix_fmt rgb24 -s 256x192 - | zqloader video=- ...
+    video_width = value
+    video_height = value    Size of frames read from standard input. Default 256x192.
+    video_fps = value       Frames per second of the source (images: each is shown 1/value seconds). Default 25.
+    video_mode = value      attributes (default): attributes only, 64x24 with bars; attributes_32x48;
+                            or screen: full screen including pixels.
+    target_fps = value      Frames per second to send at most; when needed only part of what changed is send
+                            with each frame (screen mode: the 8x8 cells that differ most from what is shown).
+                            Default 0: each frame as fast as what changed can be send.
+    video_threshold = value Attribute modes: how much a new attribute must be nearer to the image (squared
+                            rgb distance, summed over frames) before a cell changes. Prevents flicker.
+                            Default 3000; 0: each frame as converted.
 
     key = yes/no/error      When done wait for key: yes=always, no=never or only when an error
                             occurred (which is the default).
@@ -209,6 +301,20 @@ int main(int argc, char** argv)
         {
             zqloader.SetAction(ZQLoader::Action::write_tzx);
         }
+        else if(cmdline.HasParameter("verify"))
+        {
+            zqloader.SetAction(ZQLoader::Action::verify);
+        }
+        else if(cmdline.HasParameter("emulate"))
+        {
+            zqloader.SetAction(ZQLoader::Action::emulate);
+        }
+        zqloader.SetRomFilename(cmdline.GetParameter("rom", ""));
+        if(cmdline.HasParameter("capture"))
+        {
+            zqloader.SetCapture(cmdline.GetParameter<uint16_t>("capture_pc", 0),
+                                std::chrono::milliseconds(cmdline.GetParameter("capture_time", 2000)));
+        }
 
         zqloader.SetBitLoopMax(cmdline.GetParameter<int>("bit_loop_max", 0)).
                     SetZeroMax(cmdline.GetParameter<int>("zero_max", 0)).
@@ -216,8 +322,22 @@ int main(int argc, char** argv)
                                cmdline.GetParameter("one_tstates", 0),
                                cmdline.GetParameter("end_of_byte_delay", loader_defaults::end_of_byte_delay));
 
+        zqloader.SetSkipPilots(cmdline.HasParameter("chain"));
+        zqloader.SetWhenDoneStayInLoader(cmdline.HasParameter("stay"));
+        zqloader.SetDelta(cmdline.HasParameter("delta"));
+        zqloader.SetReturnedToBasic(cmdline.HasParameter("returned"));
+        if(cmdline.HasParameter("session"))
+        {
+            zqloader.SetSessionFilename(cmdline.GetParameter("session", ""));
+        }
+
         zqloader.SetVolume(cmdline.GetParameter("volume_left",  loader_defaults::volume_left),
                            cmdline.GetParameter("volume_right", loader_defaults::volume_right));
+        zqloader.SetSampleRate(cmdline.GetParameter<uint32_t>("samplerate", loader_defaults::sample_rate));
+        if(cmdline.HasParameter("optimize"))
+        {
+            zqloader.OptimizeTimings(cmdline.GetParameter("safety_margin", loader_defaults::timing_safety_margin));
+        }
         // zqloader.SetCompressionType(CompressionType::none); // @DEBUG
 
         if(cmdline.HasParameter("usescreen") || cmdline.HasParameter("s"))
@@ -229,10 +349,22 @@ int main(int argc, char** argv)
             zqloader.SetLoaderCopyTarget(cmdline.GetParameter<uint16_t>("new_loader_location", 0));
         }
 
-        zqloader.SetNormalFilename(filename).SetTurboFilename(filename2);
-
-        
-        zqloader.Run();
+        fs::path verify_wav = cmdline.GetParameter("verifywav", "");
+        std::string video   = cmdline.GetParameter("video", "");
+        bool only_optimize  = cmdline.HasParameter("optimize") && !filename.has_extension() && !filename2.has_extension();  // no files given
+        if(!verify_wav.empty())
+        {
+            zqloader.VerifyWavFile(verify_wav);
+        }
+        else if(!video.empty())
+        {
+            RunVideo(zqloader, cmdline, video);
+        }
+        else if(!only_optimize)
+        {
+            zqloader.SetNormalFilename(filename).SetTurboFilename(filename2);
+            zqloader.Run();
+        }
       //  std::cout << "Edge = " << spectrumloader.GetLastEdge() << std::endl;
         er = 0;
     }
@@ -10,11 +10,16 @@
 #pragma once
 
 #include "datablock.h"
+#include "types.h"         // CompressionType
 #include <list>
-#include <algorithm>       // clamp
+#include <vector>
+#include <set>
+#include <tuple>
+#include <algorithm>       // clamp, sort, find_if
 
 // Stores a DataBlock + (spectrum compatible) start (destination) address
-// Also bank number.
+// Also bank number, and compression type when decided per block (see BlockPlanner).
+// The data is a (shared) DataBlockView, so splitting does not copy.
 struct MemoryBlock
 {
     int GetStartAddress() const
@@ -29,145 +34,135 @@ struct MemoryBlock
     {
         return  m_address + int(m_datablock.size());
     }
-    DataBlock m_datablock;
+    DataBlockView m_datablock;
     int m_address{};
     int m_bank = -1;        // <0: no back set eg 48k ZX Spectrum
+    CompressionType m_compression_type = CompressionType::automatic;    // automatic: use the one set at TurboBlocks
 };
 
 using MemoryBlocks = std::list<MemoryBlock>;
 
 
 
-// Find next start or end address in all given blocks - starting at p_search_from.
-// return address plus a counter giving the balance/difference between start and and address found *at that* location.
-// counter 1: found single begin addres; -1 found single end addres.
-// Return <0 for address when not found (p_search_from reached end)
-// (when there is overlap)
-inline std::pair<int, int> FindNextAddress(const MemoryBlocks &p_memory_blocks, int p_search_from)
-{
-    int lowest_adr = -1;
-    int how_much = 0;       // balance counter
-    auto UpdateLowest=[&](int adr, int to_add)
-    {
-            if( adr >= p_search_from)
-            {
-                // found an address less than lowest, or first
-                if(adr < lowest_adr || lowest_adr < 0)
-                {
-                    lowest_adr = adr;
-                    how_much = to_add;
-                }
-                else if(adr == lowest_adr)
-                {
-                    how_much += to_add;
-                }
-            }
-    };
-    for(const auto &block: p_memory_blocks)
-    {
-        if(block.m_bank < 0)
-        {
-            UpdateLowest(block.GetStartAddress(), 1);
-            UpdateLowest(block.GetEndAddress(), -1);
-        }
-    }
-    return {lowest_adr, how_much};
-}
-
-
 // Compact/simplifies given memory blocks.
 // Combines directly adjacent memory blocks into one.
 // Combines overlapping memory blocks, content of last has highest priority.
-// Result is sorted form low address to high address.
+// Same for 128K bank blocks, but only with blocks at the same bank.
+// Result is sorted on (bank, address), so blocks without bank (<0) first from low
+// to high address, then the 128K banks.
+// Sort-and-sweep: blocks are sorted on (bank, start address) and swept once to find
+// runs of overlapping or adjacent blocks. A run of one block is moved as is (not copied);
+// else each byte of the run is copied once from the block loaded last at that address.
 inline MemoryBlocks Compact(MemoryBlocks p_memory_blocks)
 {
-    MemoryBlocks retval;
-    DataBlock mem_combined;
-    mem_combined.resize(64*1024);
-    // dump in *loading* order at mem_combined thus taking care of overlaps.
-    for(const auto &block: p_memory_blocks)
+    std::vector<MemoryBlock> blocks;            // in *loading* order
+    blocks.reserve(p_memory_blocks.size());
+    for(auto &block: p_memory_blocks)
     {
-        if(block.m_bank < 0)        // 128K bank switch block. See end.
+        if(block.size() != 0)
         {
-            mem_combined.resize(std::max(size_t(block.m_address + block.size()), mem_combined.size()));        // can only grow
-            // cpy datablock->mem_combined
-            std::copy( block.m_datablock.begin(), block.m_datablock.end(), mem_combined.begin() + block.m_address);
+            blocks.push_back(std::move(block));
         }
     }
-    
-    int counter = 0;
-    int search_from = 0;
-    int found_start{};
-    while(true)
+    std::vector<size_t> sorted(blocks.size());
+    for(size_t n = 0; n < sorted.size(); n++)
+    {
+        sorted[n] = n;
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), [&](size_t p_1, size_t p_2)
     {
-        auto [found_address, how_much] = FindNextAddress(p_memory_blocks, search_from);
-        //std::cout << "how_much = " << how_much << " counter = " << counter << " newcounter = " << counter+how_much << " found_address = " << found_address << " search_from = " << search_from <<   std::endl;
-        if(found_address < 0)
+        return std::pair(blocks[p_1].m_bank, blocks[p_1].GetStartAddress()) < std::pair(blocks[p_2].m_bank, blocks[p_2].GetStartAddress());
+    });
+
+    MemoryBlocks retval;
+    for(size_t run_begin = 0; run_begin < sorted.size(); )
+    {
+        // Find run: [run_begin, run_end) at sorted, same bank, overlapping or adjacent.
+        const MemoryBlock &first = blocks[sorted[run_begin]];
+        int run_start = first.GetStartAddress();
+        int run_stop  = first.GetEndAddress();
+        size_t run_end = run_begin + 1;
+        while(run_end < sorted.size() &&
+              blocks[sorted[run_end]].m_bank == first.m_bank &&
+              blocks[sorted[run_end]].GetStartAddress() <= run_stop)
         {
-            break;      // done
+            run_stop = std::max(run_stop, blocks[sorted[run_end]].GetEndAddress());
+            run_end++;
         }
-        if(how_much > 0)        // found start address
+
+        MemoryBlock combined;
+        combined.m_address = run_start;
+        combined.m_bank    = first.m_bank;
+        if(run_end - run_begin == 1)
         {
-            if(counter == 0)
-            {
-                found_start = uint16_t(found_address);
-            }
+            combined.m_datablock = std::move(blocks[sorted[run_begin]].m_datablock);   // nothing to combine
         }
-        counter += how_much;
-        if(how_much < 0)
+        else
         {
-            if(counter < 0)
+            // Sweep over start/end addresses; at each piece between two addresses
+            // take the block loaded last (highest index) that covers it.
+            std::vector<std::tuple<int, bool, size_t>> events;     // address, is start, index
+            for(size_t n = run_begin; n < run_end; n++)
             {
-                throw std::runtime_error("Found end address before start address");
+                const MemoryBlock &block = blocks[sorted[n]];
+                events.emplace_back(block.GetStartAddress(), true, sorted[n]);
+                events.emplace_back(block.GetEndAddress(), false, sorted[n]);
             }
-            else if(counter == 0)
+            std::sort(events.begin(), events.end());
+            DataBlock data;
+            data.reserve(size_t(run_stop - run_start));
+            std::set<size_t> active;
+            for(size_t n = 0; n < events.size(); n++)
             {
-                MemoryBlock b;
-                b.m_address = found_start;
-                b.m_datablock.resize(found_address - found_start);
-                //std::cout << "found_start = " << found_start << " found_address(end) = " << found_address << " len = " << found_address - found_start << std::endl;
-                // cpy mem_combined -> m_datablock
-                std::copy(mem_combined.begin() + found_start, mem_combined.begin() + found_address, b.m_datablock.begin());
-                retval.push_back(std::move(b));
+                auto [address, is_start, index] = events[n];
+                if(is_start)
+                {
+                    active.insert(index);
+                }
+                else
+                {
+                    active.erase(index);
+                }
+                if(!active.empty() && n + 1 < events.size())
+                {
+                    int next = std::get<0>(events[n + 1]);
+                    const MemoryBlock &owner = blocks[*active.rbegin()];
+                    auto from = owner.m_datablock.begin() + (address - owner.GetStartAddress());
+                    data.insert(data.end(), from, from + (next - address));
+                }
             }
+            combined.m_datablock = std::move(data);
         }
-        search_from = found_address + 1;
-    }
-    // Add 128K banks at end.
-    for(auto &block: p_memory_blocks)
-    {
-        if(block.m_bank >= 0)
-        {
-            retval.push_back(std::move(block));
-        }
+        retval.push_back(std::move(combined));
+        run_begin = run_end;
     }
     return retval;
 }
 
-// Split DataBlock in two
-inline std::pair<DataBlock, DataBlock> SplitBlock(const DataBlock& p_data, size_t p_start)
+// Split DataBlock(View) in two; shares data.
+inline std::pair<DataBlockView, DataBlockView> SplitBlock(const DataBlockView& p_data, size_t p_start)
 {
     p_start = std::min(p_start, p_data.size());
-    DataBlock first(p_data.begin(), p_data.begin() + p_start);
-    DataBlock second(p_data.begin() + p_start, p_data.end());
+    DataBlockView first(p_data, 0, p_start);
+    DataBlockView second(p_data, p_start, p_data.size() - p_start);
     return {std::move(first), std::move(second)};
 }
 
-// Split DataBlock in three
-inline std::tuple<DataBlock, DataBlock, DataBlock> SplitBlock3(const DataBlock& p_data, size_t p_start, size_t p_end)
+// Split DataBlock(View) in three; shares data.
+inline std::tuple<DataBlockView, DataBlockView, DataBlockView> SplitBlock3(const DataBlockView& p_data, size_t p_start, size_t p_end)
 {
     // Clamp indices to valid range
     p_start = std::min(p_start, p_data.size());
-    p_end = std::min(p_end, p_data.size());
+    p_end = std::clamp(p_end, p_start, p_data.size());
 
-    DataBlock first(p_data.begin(), p_data.begin() + p_start);
-    DataBlock second(p_data.begin() + p_start, p_data.begin() + p_end);
-    DataBlock third(p_data.begin() + p_end, p_data.end());
+    DataBlockView first(p_data, 0, p_start);
+    DataBlockView second(p_data, p_start, p_end - p_start);
+    DataBlockView third(p_data, p_end, p_data.size() - p_end);
 
     return {std::move(first), std::move(second), std::move(third)};
 }
 
-// Split MemoryBlock in two
+// Split MemoryBlock in two; shares data.
 inline std::pair<MemoryBlock, MemoryBlock> SplitBlock(const MemoryBlock& p_data, int p_start)
 {
     // adjust, now from DataBlock start; also check.
@@ -177,11 +172,13 @@ inline std::pair<MemoryBlock, MemoryBlock> SplitBlock(const MemoryBlock& p_data,
     std::tie(first.m_datablock, second.m_datablock) = SplitBlock(p_data.m_datablock, start);
     first.m_address  = p_data.m_address;
     second.m_address = p_start;
+    first.m_bank     = p_data.m_bank;
+    second.m_bank    = p_data.m_bank;
     return {std::move(first), std::move(second)};
 }
 
 
-// Split MemoryBlock in three
+// Split MemoryBlock in three; shares data.
 inline std::tuple<MemoryBlock, MemoryBlock, MemoryBlock> SplitBlock3(const MemoryBlock& p_data, int p_start, int p_end)
 {
     // adjust, now from DataBlock start; also check.
@@ -194,6 +191,9 @@ inline std::tuple<MemoryBlock, MemoryBlock, MemoryBlock> SplitBlock3(const Memor
     first.m_address  = p_data.m_address;
     second.m_address = p_start;
     third.m_address  = p_end;
+    first.m_bank     = p_data.m_bank;
+    second.m_bank    = p_data.m_bank;
+    third.m_bank     = p_data.m_bank;
     return {std::move(first), std::move(second), std::move(third)};
 }
 
@@ -219,3 +219,37 @@ inline bool Overlaps(const MemoryBlock &p_block1, const MemoryBlock &p_block2)
 {
     return Overlaps(p_block1.GetStartAddress(), p_block1.GetEndAddress(),p_block2.GetStartAddress(), p_block2.GetEndAddress() );
 }
+
+
+// Take given blocks, starting at the first one ending after p_resume_address (wrapping
+// around: blocks before it go last), as long as they fit in p_max_size bytes, counting
+// p_max_gap extra for each block. Last one can be partial. At least one byte.
+// Continue from the end address of the last one taken to give all blocks their turn.
+// (Eg video frames, see TurboBlocks::AddFrameAsTurboBlocks)
+inline MemoryBlocks LimitBlocks(MemoryBlocks p_blocks, int p_max_size, int p_max_gap, int p_resume_address)
+{
+    auto resume = std::find_if(p_blocks.begin(), p_blocks.end(), [p_resume_address](const MemoryBlock& p_block)
+    {
+        return p_block.GetEndAddress() > p_resume_address;
+    });
+    p_blocks.splice(p_blocks.end(), p_blocks, p_blocks.begin(), resume);      // rotate
+    MemoryBlocks retval;
+    int size = 0;
+    for (auto& block : p_blocks)
+    {
+        int room = p_max_size - size - p_max_gap;          // for data of this block
+        if (room <= 0 && !retval.empty())
+        {
+            break;
+        }
+        int take = std::clamp(room, 1, block.size());
+        size += p_max_gap + take;
+        if (take < block.size())
+        {
+            retval.push_back(std::get<0>(SplitBlock(block, block.GetStartAddress() + take)));
+            break;
+        }
+        retval.push_back(std::move(block));
+    }
+    return retval;
+}
@@ -0,0 +1,165 @@
+// ==============================================================================
+// PROJECT:         zqloader
+// FILE:            memoryimage.cpp
+// DESCRIPTION:     Implementation of class MemoryImage
+//
+// Copyright (c) 2025 Daan Scherft [Oxidaan]
+// This project uses the MIT license. See LICENSE.txt for details.
+// ==============================================================================
+
+#include "memoryimage.h"
+#include "byte_tools.h"             // 0_byte
+#include <algorithm>                // std::fill
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+
+
+MemoryImage::MemoryImage() :
+    m_memory(memory_size),
+    m_known(memory_size, false)
+{}
+
+
+
+MemoryImage& MemoryImage::Clear()
+{
+    std::fill(m_known.begin(), m_known.end(), false);
+    return *this;
+}
+
+
+
+bool MemoryImage::IsEmpty() const
+{
+    return std::find(m_known.begin(), m_known.end(), true) == m_known.end();
+}
+
+
+
+MemoryImage& MemoryImage::Apply(const MemoryBlocks &p_memory_blocks)
+{
+    for (const auto &block : p_memory_blocks)
+    {
+        if (block.m_bank >= 0)
+        {
+            continue;
+        }
+        for (int n = 0; n < block.size() && block.GetStartAddress() + n < memory_size; n++)
+        {
+            m_memory[block.GetStartAddress() + n] = block.m_datablock[n];
+            m_known[block.GetStartAddress() + n]  = true;
+        }
+    }
+    return *this;
+}
+
+
+
+bool MemoryImage::IsKnown(int p_address, int p_size) const
+{
+    return p_address + p_size <= memory_size &&
+           std::find(m_known.begin() + p_address, m_known.begin() + p_address + p_size, false) == m_known.begin() + p_address + p_size;
+}
+
+
+
+DataBlock MemoryImage::Get(int p_address, int p_size) const
+{
+    DataBlock retval(static_cast<size_t>(p_size));
+    for (int n = 0; n < p_size && p_address + n < memory_size; n++)
+    {
+        retval[n] = m_known[p_address + n] ? m_memory[p_address + n] : 0_byte;
+    }
+    return retval;
+}
+
+
+
+/// Walks each block once; a changed part ends after more than p_max_gap unchanged bytes.
+MemoryBlocks MemoryImage::GetChanged(const MemoryBlocks &p_memory_blocks, int p_max_gap) const
+{
+    MemoryBlocks retval;
+    for (const auto &block : p_memory_blocks)
+    {
+        if (block.m_bank >= 0)
+        {
+            retval.push_back(block);
+            continue;
+        }
+        auto IsChanged = [&](int p_offset)
+        {
+            int address = block.GetStartAddress() + p_offset;
+            return address >= memory_size || !m_known[address] || m_memory[address] != block.m_datablock[p_offset];
+        };
+        int begin = -1;         // start of current changed part, -1 when none
+        int end   = 0;          // after last changed byte of it
+        auto AddPart = [&]
+        {
+            MemoryBlock part;
+            part.m_address          = block.m_address + begin;
+            part.m_bank             = block.m_bank;
+            part.m_compression_type = block.m_compression_type;
+            part.m_datablock        = DataBlockView(block.m_datablock, size_t(begin), size_t(end - begin));
+            retval.push_back(std::move(part));
+        };
+        for (int n = 0; n < block.size(); n++)
+        {
+            if (IsChanged(n))
+            {
+                if (begin >= 0 && n - end > p_max_gap)
+                {
+                    AddPart();
+                    begin = -1;
+                }
+                if (begin < 0)
+                {
+                    begin = n;
+                }
+                end = n + 1;
+            }
+        }
+        if (begin >= 0)
+        {
+            AddPart();
+        }
+    }
+    return retval;
+}
+
+
+
+MemoryImage& MemoryImage::Load(const fs::path &p_filename)
+{
+    Clear();
+    if (!fs::exists(p_filename))
+    {
+        return *this;
+    }
+    DataBlock data = LoadFromFile(p_filename);
+    if (data.size() != 2 * memory_size)
+    {
+        throw std::runtime_error("Memory image " + p_filename.string() + " has wrong size");
+    }
+    std::copy(data.begin(), data.begin() + memory_size, m_memory.begin());
+    for (int n = 0; n < memory_size; n++)
+    {
+        m_known[n] = data[memory_size + n] != 0_byte;
+    }
+    return *this;
+}
+
+
+
+const MemoryImage& MemoryImage::Save(const fs::path &p_filename) const
+{
+    DataBlock data = m_memory.Clone();
+    data.reserve(2 * memory_size);
+    for (bool known : m_known)
+    {
+        data.push_back(known ? 1_byte : 0_byte);
+    }
+    SaveToFile(data, p_filename);
+    return *this;
+}
@@ -0,0 +1,78 @@
+// ==============================================================================
+// PROJECT:         zqloader
+// FILE:            memoryimage.h
+// DESCRIPTION:     Definition of class MemoryImage
+//
+// Copyright (c) 2025 Daan Scherft [Oxidaan]
+// This project uses the MIT license. See LICENSE.txt for details.
+// ==============================================================================
+
+#pragma once
+
+#include <filesystem>
+#include <vector>
+#include "datablock.h"
+#include "memoryblock.h"    // MemoryBlocks
+
+
+/// The 64K memory of the ZX Spectrum as last send to it, as far as known.
+/// Used to send only what changed (delta) to a resident zqloader, see LoaderSession.
+/// 128K banked blocks (m_bank >= 0) are not kept, so are always send.
+class MemoryImage
+{
+public:
+
+    static constexpr int memory_size = 64 * 1024;
+
+    MemoryImage();
+    MemoryImage(MemoryImage &&) noexcept = default;
+    MemoryImage & operator = (MemoryImage &&) noexcept = default;
+
+    /// Copies (deep) the memory.
+    MemoryImage(const MemoryImage &p_other) :
+        m_memory(p_other.m_memory.Clone()),
+        m_known(p_other.m_known)
+    {}
+
+    /// Copies (deep) the memory.
+    MemoryImage & operator = (const MemoryImage &p_other)
+    {
+        m_memory = p_other.m_memory.Clone();
+        m_known  = p_other.m_known;
+        return *this;
+    }
+
+    /// Forget all, nothing is known.
+    MemoryImage& Clear();
+
+    /// Nothing known?
+    bool IsEmpty() const;
+
+    /// Given blocks were loaded: remember their content.
+    MemoryImage& Apply(const MemoryBlocks &p_memory_blocks);
+
+    /// Is all memory from given address, given number of bytes, known?
+    bool IsKnown(int p_address, int p_size) const;
+
+    /// Get memory from given address, given number of bytes. Unknown bytes are 0.
+    DataBlock Get(int p_address, int p_size) const;
+
+    /// Get the parts of given blocks that differ from (or are not at) this image.
+    /// Changed parts less than p_max_gap bytes apart are combined: a block of its own
+    /// takes longer than sending the unchanged bytes in between.
+    /// Parts are views at given blocks, no data is copied.
+    MemoryBlocks GetChanged(const MemoryBlocks &p_memory_blocks, int p_max_gap) const;
+
+    /// Read from file (as written by Save). Nothing known when it does not exist.
+    /// Throws when it exists but could not be read.
+    MemoryImage& Load(const std::filesystem::path &p_filename);
+
+    /// Write to file: the memory, followed by a byte (0/1) per address whether known.
+    /// Throws when it could not be written.
+    const MemoryImage& Save(const std::filesystem::path &p_filename) const;
+
+private:
+
+    DataBlock          m_memory;
+    std::vector<bool>  m_known;
+}; // class MemoryImage
@@ -10,6 +10,10 @@
 
 
 #include "pulsers.h"
+#include <algorithm>          // std::max
+#include <map>
+#include <mutex>
+#include <tuple>
 
 
 
@@ -54,19 +58,114 @@ TonePulser& TonePulser::SetLength(std::chrono::milliseconds p_duration)
 /// Get total duration for this pulser in TStates.
 int DataPulser::GetDurationInTStates() const
 {
-    auto bitnumb4 = m_bitnum;
-    auto pulsnumb4 = m_pulsnum;
+    auto table = m_table ? m_table : GetEdgeTable();
     int tstates = 0;
-    auto me = const_cast<DataPulser *>(this);
-    me->m_bitnum = 0;
-    me->m_pulsnum = 0;
-    do
+    for (size_t n = 0; n < GetTotalSize(); n++)
     {
-        tstates += GetTstate();
+        auto index = GetTableIndex(n);
+        for (auto pos = table->m_byte_begin[index]; pos < table->m_byte_begin[index + 1]; pos++)
+        {
+            tstates += table->m_edge_tstates[pos];
+        }
     }
-    while(!me -> Next());
-    me->m_bitnum = bitnumb4;
-    me->m_pulsnum = pulsnumb4;
     return tstates;
 }
 
+
+
+/// Get the edge table, then start at the first byte.
+void DataPulser::Compile()
+{
+    m_table   = GetEdgeTable();
+    m_bytenum = 0;
+    StartByte();
+}
+
+
+
+/// Expand each possible byte value to the T-states of its edges, so sending
+/// an edge is just a table read instead of finding the bit, pattern and delay.
+/// The end of byte delay is at the first edge of each byte except the very first,
+/// so each byte value is there twice: with and without the delay.
+/// Tables are kept while a DataPulser uses them; all turbo blocks share one.
+std::shared_ptr<const DataPulser::EdgeTable> DataPulser::GetEdgeTable() const
+{
+    using Key = std::tuple<std::vector<int>, std::vector<int>, int, int, int, int, bool>;
+    static std::map<Key, std::weak_ptr<const EdgeTable>> tables;
+    static std::mutex mutex;
+    Key key{ m_zero_pattern, m_one_pattern, m_delay_duration, m_puls_duration, m_start_duration, m_stop_duration, m_start_bit };
+    std::unique_lock lock(mutex);
+    auto &cached = tables[std::move(key)];
+    auto retval  = cached.lock();
+    if (!retval)
+    {
+        auto table = std::make_shared<EdgeTable>();
+        for (int value = 0; value < 512; value++)
+        {
+            table->m_byte_begin.push_back(unsigned(table->m_edge_tstates.size()));
+            if (IsPulseMode())
+            {
+                CompilePulseModeByte(*table, std::byte(value));
+            }
+            else
+            {
+                CompileByte(*table, std::byte(value), value < 256 ? m_delay_duration : 0);
+            }
+        }
+        table->m_byte_begin.push_back(unsigned(table->m_edge_tstates.size()));
+        retval = table;
+        cached = retval;
+    }
+    return retval;
+}
+
+
+
+// Normal mode: each bit is the one or zero pattern.
+void DataPulser::CompileByte(EdgeTable &p_table, std::byte p_value, int p_delay) const
+{
+    for (int bitnum = 7; bitnum >= 0; bitnum--)       // spectrum saves most sign bit first
+    {
+        bool bit = bool(( p_value >> bitnum ) & 0x1_byte);
+        for (int tstates : bit ? m_one_pattern : m_zero_pattern)
+        {
+            p_table.m_edge_tstates.push_back(tstates + p_delay);
+            p_delay = 0;
+        }
+    }
+}
+
+
+
+// 'Pulse mode' (rs232): start bit, 8 data bits, stop bit; # pulses for each bit
+// as one/zero pattern size but fixed length, level is the bit value.
+// Needs start and stop bit for synchronisation.
+void DataPulser::CompilePulseModeByte(EdgeTable &p_table, std::byte p_value) const
+{
+    for (int bitnum = 0; bitnum < 10; bitnum++)
+    {
+        bool bit;
+        int tstates = m_puls_duration;
+        if (bitnum == 0)
+        {
+            bit     = m_start_bit;
+            tstates = m_start_duration;
+        }
+        else if (bitnum == 9)
+        {
+            bit     = !m_start_bit;
+            tstates = m_stop_duration;
+        }
+        else
+        {
+            bit = bool(( p_value >> (8 - bitnum) ) & 0x1_byte);     // most sign bit first
+        }
+        auto pulses = std::max<size_t>(1, bit ? m_one_pattern.size() : m_zero_pattern.size());
+        for (size_t n = 0; n < pulses; n++)
+        {
+            p_table.m_edge_tstates.push_back(tstates);
+            p_table.m_edge_levels.push_back(bit ? Edge::one : Edge::zero);
+        }
+    }
+}
+
@@ -14,6 +14,8 @@
 #include "datablock.h"              // DataBlock
 #include "byte_tools.h"             // eg literal for std::byte
 #include <ostream>                  // std::ostream
+#include <variant>
+#include <memory>                   // std::shared_ptr
 
 
 
@@ -85,7 +87,7 @@ protected:
 /// A pulser that when inserted causes a silence of given duration.
 /// Does not need data.
 /// Does not pulse, although can change pulse/edge output at first call (after wait).
-class PausePulser : public Pulser
+class PausePulser final : public Pulser
 {
     PausePulser(const PausePulser&) = delete;
     using Clock = std::chrono::system_clock;
@@ -190,7 +192,7 @@ private:
 /// A pulser that when inserted can be used to create a tone or pulse sequence
 /// with a certain pattern. Eg a leader tone.
 /// Does not need data.
-class TonePulser : public Pulser
+class TonePulser final : public Pulser
 {
     TonePulser(const TonePulser&) = delete;
     using Clock = std::chrono::system_clock;
@@ -318,7 +320,7 @@ private:
 /// A pulser that when inserted generated pulses based on the data attached.
 /// So needs data attached.
 /// Can optionally use 'pulse mode' having fixed length pulses like RS-232.
-class DataPulser : public Pulser
+class DataPulser final : public Pulser
 {
     DataPulser(const DataPulser&) = delete;
 
@@ -411,7 +413,8 @@ public:
 
 
     /// Set the data to be pulsed.
-    DataPulser& SetData(DataBlock p_data)
+    /// Also takes a DataBlock (moved), or a DataBlockView sharing data without copying.
+    DataPulser& SetData(DataBlockView p_data)
     {
         m_data = std::move(p_data);
         return *this;
@@ -420,9 +423,11 @@ public:
 
 
     /// Move this to given loader
+    /// Compiles the edge table first, see Compile.
     template<class TLoader>
     void MoveToLoader(TLoader& p_loader)
     {
+        Compile();
         p_loader.AddPulser(std::move(*this));
     }
 
@@ -435,26 +440,18 @@ public:
             return Edge::toggle;
         }
         // Here in 'pulse mode' (rs232 like)
-        if (GetCurrentBit())
-        {
-            return Edge::one;
-        }
-        else
-        {
-            return Edge::zero;
-        }
-
+        return m_table->m_edge_levels[m_edge_pos];
     }
 
 
 
     bool Next() override
     {
-        m_pulsnum++;
-        if (m_pulsnum >= GetMaxPuls())
+        m_edge_pos++;
+        if (m_edge_pos >= m_edge_end)
         {
-            m_pulsnum = 0;
-            m_bitnum++;
+            m_bytenum++;
+            StartByte();
         }
         return AtEnd();
     }
@@ -477,31 +474,7 @@ protected:
     /// Get # TStates to wait now
     int GetTstate() const override
     {
-        if (!IsPulseMode())       // not in 'pulse mode' (so normal)
-        {
-            if (GetCurrentBit())
-            {
-                return m_one_pattern[m_pulsnum] + GetExtraDelay();
-            }
-            else
-            {
-                return m_zero_pattern[m_pulsnum] + GetExtraDelay();
-            }
-        }
-        else
-        {
-            // Here in 'pulse mode' (so rs232 like)
-            auto bitnum = m_bitnum % 10;    // 0 -> 9
-            if (bitnum == 0)
-            {
-                return m_start_duration;
-            }
-            else if (bitnum == 9)
-            {
-                return m_stop_duration;
-            }
-            return m_puls_duration;
-        }
+        return m_table->m_edge_tstates[m_edge_pos];
     }
 
 
@@ -517,21 +490,6 @@ private:
     }
 
 
-
-    // Get delay ZX spectrum needs at end of byte to store it.
-    // Extra delay before each byte except first.
-    int GetExtraDelay() const
-    {
-        if(  ( m_bitnum % 8 ) == 0 &&          // before first bit of all bytes except
-             m_bitnum != 0 &&                  // very first bit
-             m_pulsnum == 0)                   // also only before first pulse of first bit pattern
-        {
-            return m_delay_duration;
-        }
-        return 0;
-    }
-
-
     void SetOnePattern()
     {
     }
@@ -542,80 +500,56 @@ private:
     }
 
 
-    void SetSize(size_t p_size)
-    {
-        m_data.resize(p_size);
-    }
-
-
-    std::byte* GetDataPtr()
+    bool AtEnd() const
     {
-        return m_data.data();
+        return m_bytenum >= GetTotalSize();
     }
 
 
-    bool AtEnd() const
+    // Index at EdgeTable::m_byte_begin for given byte at m_data.
+    // The first byte has no end of byte delay before it.
+    unsigned GetTableIndex(size_t p_bytenum) const
     {
-        return ( m_bitnum / 8 ) >= GetTotalSize();
+        return (p_bytenum == 0 ? 256u : 0u) + unsigned(GetByte(unsigned(p_bytenum)));
     }
 
 
-    // # pulses(=edges) a single bit either 1 or zero needs.
-    // At Spectrum typically 2 (2 edges per bit) (but ZX81 has higher)
-    // Our turboloader typically 1.
-    unsigned GetMaxPuls() const
+    // Set m_edge_pos and m_edge_end at edges for byte m_bytenum.
+    void StartByte()
     {
-        if (GetCurrentBit())
-        {
-            return unsigned(m_one_pattern.size());
-        }
-        else
+        if (!AtEnd())
         {
-            return unsigned(m_zero_pattern.size());
+            auto index = GetTableIndex(m_bytenum);
+            m_edge_pos = m_table->m_byte_begin[index];
+            m_edge_end = m_table->m_byte_begin[index + 1];
         }
     }
 
-
-    // Get current bit, based on m_bitnum
-    bool GetCurrentBit() const
+    // Edges for all byte values, so each edge is just a table read. See GetEdgeTable.
+    struct EdgeTable
     {
-        if (!IsPulseMode())
-        {
-            // normal mode.
-            auto bytenum          = m_bitnum / 8;
-            auto bitnum           = m_bitnum % 8; // 0 -> 7
-            bitnum = 7 - bitnum;                  // 8 -> 0 spectrum saves most sign bit first
-            const std::byte& byte = GetByte(bytenum);
-            bool retval           = bool(( byte >> bitnum ) & 0x1_byte);
-            return retval;
-        }
-        else
-        {
-            // in puls mode (rs232) needs start and stop bit for synchronisation
-            auto bytenum = m_bitnum / 10;
-            auto bitnum  = m_bitnum % 10;   // 0 -> 9
-            if (bitnum == 0)
-            {
-                return m_start_bit;
-            }
-            else if (bitnum == 9)
-            {
-                return !m_start_bit;
-            }
-            else
-            {
-                bitnum = 8 - bitnum;            // 8 -> 0 spectrum saves most sign bit first
-                const std::byte& byte = GetByte(bytenum);
-                bool retval           = bool(( byte >> bitnum ) & 0x1_byte);
-                return retval;
-            }
-        }
-    }
+        std::vector<int>      m_edge_tstates;   // T-states of all edges of all byte values (incl. end of byte delay)
+        std::vector<Edge>     m_edge_levels;    // 'pulse mode' only: level for each edge at m_edge_tstates
+        std::vector<unsigned> m_byte_begin;     // [byte value] -> first edge at m_edge_tstates; [256 + byte value]: same
+                                                // without end of byte delay (first byte); [512]: end
+    };
+
+    // Get edge table, then start at first byte.
+    void Compile();
+
+    // Get (make when first asked) edge table for the patterns, delay and 'pulse mode' settings as set.
+    // Shared by all DataPulsers using the same; read only so can be used at the miniaudio thread.
+    std::shared_ptr<const EdgeTable> GetEdgeTable() const;
+
+    // Add edges for a byte in normal mode to given edge table, p_delay at first edge.
+    void CompileByte(EdgeTable &p_table, std::byte p_value, int p_delay) const;
+
+    // Add edges for a byte in 'pulse mode' (rs232 like) to given edge table.
+    void CompilePulseModeByte(EdgeTable &p_table, std::byte p_value) const;
 
 private:
 
-    unsigned           m_bitnum = 0; // bitnum from start in block to be send (runs to total # bits of data)
-    DataBlock          m_data;
+    DataBlockView      m_data;                  // shared, see TurboBlock::MoveToLoader
 
     std::vector<int>   m_zero_pattern;
     std::vector<int>   m_one_pattern;
@@ -626,6 +560,11 @@ private:
     bool               m_start_bit      = true; // value for start bit. Stopbit is always !m_start_bit
     // and m_start_bit should also be true, see table at zqloader.asm.
     // this means sync should end with 0!
+
+    std::shared_ptr<const EdgeTable> m_table;   // see Compile
+    size_t             m_bytenum  = 0;          // byte at m_data being send
+    unsigned           m_edge_pos = 0;          // edge at m_edge_tstates being send
+    unsigned           m_edge_end = 0;          // end of edges of byte being send
 }; // class DataPulser
 
 
@@ -634,7 +573,7 @@ private:
 /// A pulser that when inserted can be used to show debug output.
 /// To debug only.
 /// Does not need data, neither pulses, so has no effect.
-class DebugPulser : public Pulser
+class DebugPulser final : public Pulser
 {
     DebugPulser(const DebugPulser&) = delete;
     using Clock = std::chrono::system_clock;
@@ -661,8 +600,6 @@ public:
         return 0;
     }
 
-protected:
-
     bool Next() override
     {
         return true;
@@ -684,3 +621,12 @@ protected:
 private:
 };
 
+
+// ============================================================================
+
+/// Any of the pulsers above, by value.
+/// Lets SpectrumLoader store pulsers contiguously (no heap allocation per pulser)
+/// and use std::visit / std::get_if instead of virtual calls and dynamic_cast.
+/// The concrete pulsers are final so calls through them are resolved at compile time.
+using AnyPulser = std::variant<TonePulser, PausePulser, DataPulser, DebugPulser>;
+
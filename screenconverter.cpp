@@ -0,0 +1,453 @@
+// ==============================================================================
+// PROJECT:         zqloader
+// FILE:            screenconverter.cpp
+// DESCRIPTION:     Implementation of class ScreenConverter
+//
+// Copyright (c) 2026 Daan Scherft [Oxidaan]
+// This project uses the MIT license. See LICENSE.txt for details.
+// ==============================================================================
+
+#include "screenconverter.h"
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <functional>
+
+
+using namespace spectrum::screen;
+
+
+/// Nearest color tables as used to determine attributes.
+/// Fetched once per conversion: GetNearestColorTable locks.
+struct ScreenConverter::ColorTables
+{
+    ColorTables(const ScreenConverter &p_converter)
+    {
+        constexpr int black_colors[]       = { black };
+        constexpr int white_colors[]       = { white, br_white };
+        constexpr int gray_normal_colors[] = { black, white };
+        constexpr int gray_bright_colors[] = { br_black, br_white };
+        constexpr int normal_colors[]      = { black, blue, red, magenta, green, cyan, yellow, white };
+        constexpr int bright_colors[]      = { br_black, br_blue, br_red, br_magenta, br_green, br_cyan, br_yellow, br_white };
+        auto metric  = p_converter.m_color_metric;
+        m_black       = &GetNearestColorTable(palette, black_colors, metric);
+        m_white       = &GetNearestColorTable(palette, white_colors, metric);
+        m_dark        = &GetNearestColorTable(palette, p_converter.m_dark_colors, metric);
+        m_light       = &GetNearestColorTable(palette, p_converter.m_light_colors, metric);
+        m_all         = &GetNearestColorTable(palette, {}, metric);
+        m_gray_normal = &GetNearestColorTable(palette, gray_normal_colors, metric);
+        m_gray_bright = &GetNearestColorTable(palette, gray_bright_colors, metric);
+        m_normal      = &GetNearestColorTable(palette, normal_colors, metric);
+        m_bright      = &GetNearestColorTable(palette, bright_colors, metric);
+    }
+    const NearestColorTable *m_black;
+    const NearestColorTable *m_white;
+    const NearestColorTable *m_dark;
+    const NearestColorTable *m_light;
+    const NearestColorTable *m_all;
+    const NearestColorTable *m_gray_normal;
+    const NearestColorTable *m_gray_bright;
+    const NearestColorTable *m_normal;
+    const NearestColorTable *m_bright;
+};
+
+
+
+namespace
+{
+
+// Bayer 8x8 ordered dither matrix, 0..63.
+constexpr int bayer8x8[8][8] =
+{
+    {  0, 32,  8, 40,  2, 34, 10, 42 },
+    { 48, 16, 56, 24, 50, 18, 58, 26 },
+    { 12, 44,  4, 36, 14, 46,  6, 38 },
+    { 60, 28, 52, 20, 62, 30, 54, 22 },
+    {  3, 35, 11, 43,  1, 33,  9, 41 },
+    { 51, 19, 59, 27, 49, 17, 57, 25 },
+    { 15, 47,  7, 39, 13, 45,  5, 37 },
+    { 63, 31, 55, 23, 61, 29, 53, 21 },
+};
+
+// Rows behind row above when running Floyd-Steinberg in a wavefront:
+// pixel x gets error from x-1, x and x+1 above, and x+2 above also
+// writes (x+1) at this row, which this row writes too when at x.
+constexpr int wavefront_lag = 3;
+
+
+// Call p_function(i) for i = 0 .. p_count-1, using given number of threads.
+void ParallelFor(int p_count, int p_thread_count, const std::function<void(int)> &p_function)
+{
+    p_thread_count = std::min(p_thread_count, p_count);
+    if (p_thread_count <= 1)
+    {
+        for (int i = 0; i < p_count; i++)
+        {
+            p_function(i);
+        }
+        return;
+    }
+    std::atomic<int> next = 0;
+    auto Worker = [&]()
+    {
+        for (int i = next++; i < p_count; i = next++)
+        {
+            p_function(i);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (int n = 1; n < p_thread_count; n++)
+    {
+        threads.emplace_back(Worker);
+    }
+    Worker();
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+}
+
+
+
+// Index of highest value, and of second highest.
+std::pair<int, int> FindMax(const int p_values[16])
+{
+    int idx_max    = 0;
+    int idx_2ndmax = -1;
+
+    for (int i = 1; i < 16; i++)
+    {
+        if (p_values[i] >= p_values[idx_max])
+        {
+            idx_2ndmax = idx_max;
+            idx_max    = i;
+        }
+        else if (idx_2ndmax == -1 || p_values[i] > p_values[idx_2ndmax])
+        {
+            idx_2ndmax = i;
+        }
+    }
+    return { idx_max, idx_2ndmax };
+}
+
+
+
+// Weight of a pixel for the color found, lower distance counts heavier.
+inline int Weight(int p_dist)
+{
+    return ( 256 * 256 * 3 ) - p_dist;
+}
+
+
+
+// Ink (true) or paper for given color, given dither.
+// p_threshold: Bayer value 0..63 when ordered dithering.
+inline bool IsInk(Rgb p_color, Rgb p_ink, Rgb p_paper, ScreenConverter::Dither p_dither, int p_threshold)
+{
+    if (p_dither != ScreenConverter::Dither::ordered)
+    {
+        return ColorDistanceRgb(p_color, p_ink) < ColorDistanceRgb(p_color, p_paper);
+    }
+    // Position t of color projected at the line from ink (0) to paper (1); ink when t < (threshold + 0.5) / 64.
+    int dr  = RgbRed(p_paper)   - RgbRed(p_ink);
+    int dg  = RgbGreen(p_paper) - RgbGreen(p_ink);
+    int db  = RgbBlue(p_paper)  - RgbBlue(p_ink);
+    int num = ( RgbRed(p_color) - RgbRed(p_ink) ) * dr + ( RgbGreen(p_color) - RgbGreen(p_ink) ) * dg + ( RgbBlue(p_color) - RgbBlue(p_ink) ) * db;
+    int den = dr * dr + dg * dg + db * db;
+    return int64_t(128) * num < int64_t(2 * p_threshold + 1) * den;
+}
+
+}   // namespace
+
+
+
+/// Convert given 256x192 image to spectrum screen.
+/// First all attributes (cell parallel), then pixels, which may need the attributes.
+Screen ScreenConverter::Run(const Rgb *p_pixels, int p_stride) const
+{
+    Screen screen;
+    ColorTables tables(*this);
+    constexpr int columns = SCREEN_WIDTH / 8;
+    constexpr int rows    = SCREEN_HEIGHT / 8;
+    ParallelFor(columns * rows, GetThreadCount(), [&](int p_cell)
+    {
+        int attr_x = p_cell % columns;
+        int attr_y = p_cell / columns;
+        screen.SetAttribute(attr_x, attr_y, GetAttributeForCell(tables, p_pixels, p_stride, attr_x, attr_y));
+    });
+    if (m_dither == Dither::floyd_steinberg)
+    {
+        QuantizeFloydSteinberg(p_pixels, p_stride, screen);
+    }
+    else
+    {
+        QuantizeRows(p_pixels, p_stride, screen);
+    }
+    return screen;
+}
+
+
+
+/// Determine attribute of one 8x8 cell at given attribute (32x24) coordinates.
+Attr ScreenConverter::GetAttributeForCell(const Rgb *p_pixels, int p_stride, int p_attr_x, int p_attr_y) const
+{
+    return GetAttributeForCell(ColorTables(*this), p_pixels, p_stride, p_attr_x, p_attr_y);
+}
+
+
+
+/// For each cell pair of pixels (paper, ink): nearest normal colors, or nearest bright
+/// colors when those are nearer together.
+std::vector<Attr> ScreenConverter::RunBars(const Rgb *p_pixels, int p_width, int p_height, int p_stride) const
+{
+    ColorTables tables(*this);
+    bool vertical = p_height == 2 * SCREEN_HEIGHT / 8;
+    std::vector<Attr> retval;
+    for (int y = 0; y < p_height; y += vertical ? 2 : 1)
+    {
+        for (int x = 0; x < p_width; x += vertical ? 1 : 2)
+        {
+            Rgb paper = p_pixels[y * p_stride + x];
+            Rgb ink   = vertical ? p_pixels[(y + 1) * p_stride + x] : p_pixels[y * p_stride + x + 1];
+            auto [dist_normal_paper, normal_paper] = tables.m_normal->GetNearest(paper);
+            auto [dist_bright_paper, bright_paper] = tables.m_bright->GetNearest(paper);
+            auto [dist_normal_ink,   normal_ink]   = tables.m_normal->GetNearest(ink);
+            auto [dist_bright_ink,   bright_ink]   = tables.m_bright->GetNearest(ink);
+            bool use_bright = dist_bright_paper + dist_bright_ink < dist_normal_paper + dist_normal_ink;
+            Attr attr{};
+            attr.attr.bright = use_bright;
+            attr.attr.paper  = static_cast<Attr::Color>(use_bright ? bright_paper - 8 : normal_paper);
+            attr.attr.ink    = static_cast<Attr::Color>(use_bright ? bright_ink - 8 : normal_ink);
+            retval.push_back(attr);
+        }
+    }
+    return retval;
+}
+
+
+
+Attr ScreenConverter::GetAttributeForCell(const ColorTables &p_tables, const Rgb *p_pixels, int p_stride, int p_attr_x, int p_attr_y) const
+{
+    const Rgb *cell = p_pixels + p_attr_y * 8 * p_stride + p_attr_x * 8;
+    return m_attribute_method == AttributeMethod::bright_first ? GetAttributeForCellBrightFirst(p_tables, cell, p_stride) :
+                                                                 GetAttributeForCellDarkLight(p_tables, cell, p_stride);
+}
+
+
+
+/// For each 8x8 (=64) pixels of the cell (p_cell is its top left pixel) determine:
+/// nearest spectrum color considered dark and nearest spectrum color considered light
+/// and count them both. Lower distances to nearest color count heavier.
+/// Then find the indexes for the most used spectrum color considered dark and light,
+/// return those as spectrum attibute: dark for ink and light for paper.
+/// The used the light color also determines bright flag.
+/// (At spectrum bright flag has barely effect on dark colors).
+Attr ScreenConverter::GetAttributeForCellDarkLight(const ColorTables &p_tables, const Rgb *p_cell, int p_stride) const
+{
+    int count_dark[16]{};
+    int count_light[16]{};
+    for (int y = 0; y < 8; y++)
+    {
+        const Rgb *row = p_cell + y * p_stride;
+        for (int x = 0; x < 8; x++)
+        {
+            Rgb rgb = row[x];
+            const NearestColorTable *dark_table  = p_tables.m_dark;
+            const NearestColorTable *light_table = p_tables.m_light;
+            if (IsAlmostGray(rgb))
+            {
+                dark_table  = p_tables.m_black;
+                light_table = p_tables.m_white;
+            }
+            else if (IsAlmostSkin(rgb))
+            {
+                light_table = p_tables.m_white;
+            }
+            auto [dist_dark,  index_dark]  = dark_table->GetNearest(rgb);
+            auto [dist_light, index_light] = light_table->GetNearest(rgb);
+            count_dark [index_dark]       += Weight(dist_dark);
+            count_light[index_light]      += Weight(dist_light);
+        }
+    }
+    auto dark_color  = FindMax(count_dark).first;     // black, blue, red so 0, 1 or 2
+    auto light_color = FindMax(count_light).first;    // so magenta(3) -- bright white (15)
+    Attr attr{};
+    attr.attr.ink    = static_cast<Attr::Color>(dark_color % 8);
+    attr.attr.paper  = static_cast<Attr::Color>(light_color % 8);
+    attr.attr.bright = light_color > 8;
+    return attr;
+}
+
+
+
+/// First determine bright: when more than half of the pixels of the cell
+/// (p_cell is its top left pixel) are nearest to a bright color.
+/// Then count nearest (bright or normal) colors, lower distances count heavier;
+/// most used is ink, second most used is paper.
+Attr ScreenConverter::GetAttributeForCellBrightFirst(const ColorTables &p_tables, const Rgb *p_cell, int p_stride) const
+{
+    int count_all[16]{};
+    int cnt_bright = 0;
+    for (int y = 0; y < 8; y++)
+    {
+        const Rgb *row = p_cell + y * p_stride;
+        for (int x = 0; x < 8; x++)
+        {
+            auto index = p_tables.m_all->GetNearest(row[x]).second;
+            if (index >= br_black)
+            {
+                cnt_bright++;
+            }
+        }
+    }
+    bool is_bright = cnt_bright > 32;   // more than half
+    const auto &gray_table  = is_bright ? *p_tables.m_gray_bright : *p_tables.m_gray_normal;
+    const auto &color_table = is_bright ? *p_tables.m_bright : *p_tables.m_normal;
+    for (int y = 0; y < 8; y++)
+    {
+        const Rgb *row = p_cell + y * p_stride;
+        for (int x = 0; x < 8; x++)
+        {
+            Rgb rgb = row[x];
+            auto [dist_all, index_all] = IsAlmostGray(rgb) ? gray_table.GetNearest(rgb) : color_table.GetNearest(rgb);
+            count_all[index_all] += Weight(dist_all);
+        }
+    }
+    auto [dark_color, light_color] = FindMax(count_all);
+    Attr attr{};
+    attr.attr.ink    = static_cast<Attr::Color>(dark_color % 8);
+    attr.attr.paper  = static_cast<Attr::Color>(light_color % 8);
+    attr.attr.bright = is_bright;
+    return attr;
+}
+
+
+
+/// Pixels without error diffusion (none or ordered): each pixel only depends on itself,
+/// so rows are independent.
+void ScreenConverter::QuantizeRows(const Rgb *p_pixels, int p_stride, Screen &p_screen) const
+{
+    ParallelFor(SCREEN_HEIGHT, GetThreadCount(), [&](int y)
+    {
+        const Rgb *row = p_pixels + y * p_stride;
+        for (int x = 0; x < SCREEN_WIDTH; x++)
+        {
+            Rgb ink, paper;
+            GetInkPaper(p_screen, x, y, ink, paper);
+            Rgb color = m_use_distance_to_black_white ? MakeRgb(RgbGray(row[x]), RgbGray(row[x]), RgbGray(row[x])) : row[x];
+            p_screen.SetPixel(x, y, IsInk(color, ink, paper, m_dither, bayer8x8[y % 8][x % 8]));
+        }
+    });
+}
+
+
+
+/// Pixels with Floyd-Steinberg error diffusion (7/16 right, 3/16 left below, 5/16 below, 1/16 right below).
+/// Error is accumulated at a working copy (r, g, b as int per pixel).
+/// Rows run in a wavefront: each row handled by one thread, at most wavefront_lag
+/// pixels behind the row above, so the result is the same as done serially.
+void ScreenConverter::QuantizeFloydSteinberg(const Rgb *p_pixels, int p_stride, Screen &p_screen) const
+{
+    constexpr int width  = SCREEN_WIDTH;
+    constexpr int height = SCREEN_HEIGHT;
+    std::vector<int> work(3 * width * height);
+    ParallelFor(height, GetThreadCount(), [&](int y)
+    {
+        const Rgb *row = p_pixels + y * p_stride;
+        int *out = work.data() + 3 * width * y;
+        for (int x = 0; x < width; x++)
+        {
+            Rgb color = row[x];
+            if (m_use_distance_to_black_white)
+            {
+                int gray = RgbGray(color);
+                out[3 * x] = out[3 * x + 1] = out[3 * x + 2] = gray;
+            }
+            else
+            {
+                out[3 * x]     = RgbRed(color);
+                out[3 * x + 1] = RgbGreen(color);
+                out[3 * x + 2] = RgbBlue(color);
+            }
+        }
+    });
+
+    std::vector<std::atomic<int>> progress(height);         // per row: pixels done
+    auto Diffuse = [&](int x, int y, const int p_error[3], int p_factor)
+    {
+        if (x >= 0 && x < width && y < height)
+        {
+            int *sample = work.data() + 3 * ( y * width + x );
+            for (int c = 0; c < 3; c++)
+            {
+                sample[c] += ( p_error[c] * p_factor ) / 16;
+            }
+        }
+    };
+    auto DoRow = [&](int y)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            if (y > 0)
+            {
+                int needed = std::min(width, x + wavefront_lag);
+                while (progress[y - 1].load(std::memory_order_acquire) < needed)
+                {
+                    std::this_thread::yield();
+                }
+            }
+            const int *sample = work.data() + 3 * ( y * width + x );
+            Rgb oldcolor = MakeRgb(std::clamp(sample[0], 0, 255), std::clamp(sample[1], 0, 255), std::clamp(sample[2], 0, 255));
+            Rgb ink, paper;
+            GetInkPaper(p_screen, x, y, ink, paper);
+            bool is_ink   = IsInk(oldcolor, ink, paper, Dither::floyd_steinberg, 0);
+            Rgb  newcolor = is_ink ? ink : paper;
+            int  error[3] = { RgbRed(oldcolor)   - RgbRed(newcolor),
+                              RgbGreen(oldcolor) - RgbGreen(newcolor),
+                              RgbBlue(oldcolor)  - RgbBlue(newcolor) };
+            Diffuse(x + 1, y,     error, 7);      // right
+            Diffuse(x - 1, y + 1, error, 3);      // left below
+            Diffuse(x,     y + 1, error, 5);      // below
+            Diffuse(x + 1, y + 1, error, 1);      // below right
+            p_screen.SetPixel(x, y, is_ink);
+            progress[y].store(x + 1, std::memory_order_release);
+        }
+    };
+    // Thread n does rows n, n + thread count, ...: all rows above any row are
+    // handled before it at their threads, so it always gets there.
+    int thread_count = std::min(GetThreadCount(), height);
+    ParallelFor(thread_count, thread_count, [&](int p_thread)
+    {
+        for (int y = p_thread; y < height; y += thread_count)
+        {
+            DoRow(y);
+        }
+    });
+}
+
+
+
+/// Ink and paper colors to choose from for pixel at given coordinate.
+void ScreenConverter::GetInkPaper(const Screen &p_screen, int x, int y, Rgb &out_ink, Rgb &out_paper) const
+{
+    if (m_use_distance_to_black_white)
+    {
+        // using distance to black/white
+        out_ink   = 0x000000;
+        out_paper = 0xffffff;
+    }
+    else
+    {
+        // using distance to (earlier determined) attribute colors
+        auto attr = p_screen.GetAttribute(x / 8, y / 8);
+        out_ink   = AttrInkToRgbColor(attr);
+        out_paper = AttrPaperToRgbColor(attr);
+    }
+}
+
+
+
+int ScreenConverter::GetThreadCount() const
+{
+    return m_thread_count > 0 ? m_thread_count : std::max(1, int(std::thread::hardware_concurrency()));
+}
@@ -0,0 +1,133 @@
+// ==============================================================================
+// PROJECT:         zqloader
+// FILE:            screenconverter.h
+// DESCRIPTION:     Definition of class ScreenConverter
+//
+// Copyright (c) 2026 Daan Scherft [Oxidaan]
+// This project uses the MIT license. See LICENSE.txt for details.
+// ==============================================================================
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <span>
+#include "zqloader.h"           // LIB_API
+#include "spectrum_screen.h"
+#include "color_distance.h"     // Rgb, ColorMetric
+
+
+/// Converts a 256x192 true color image to a ZX Spectrum screen (pixels plus attributes).
+/// Image is given as raw scanlines of 0xAARRGGBB pixels (eg QImage::Format_RGB32),
+/// so no Qt needed.
+/// Runs in parallel, using given number of threads:
+/// - attributes: per 8x8 cell, cells are independent.
+/// - pixels: per row, ink or paper for each pixel. When dithering with
+///   Floyd-Steinberg a row can only proceed where the row above has passed
+///   (it receives error from it), so rows run in a wavefront, each a few pixels
+///   behind the row above. Ordered dithering (Bayer 8x8) has no such dependency.
+/// Const, so one converter can be used from multiple threads.
+class LIB_API ScreenConverter
+{
+public:
+
+    /// How to choose between ink and paper for each pixel.
+    enum class Dither
+    {
+        none,               // nearest
+        floyd_steinberg,    // error diffusion, wavefront
+        ordered,            // Bayer 8x8 threshold
+    };
+
+    /// How to determine the attribute of each 8x8 cell.
+    enum class AttributeMethod
+    {
+        dark_light,         // most used dark color is ink, most used light color is paper (and bright)
+        bright_first,       // first decide bright (most pixels), then two most used colors
+    };
+
+    /// Use given number of threads; 0 (default) is number of cores.
+    ScreenConverter& SetThreadCount(int p_count)
+    {
+        m_thread_count = p_count;
+        return *this;
+    }
+
+    /// Set dither type, default Floyd-Steinberg.
+    ScreenConverter& SetDither(Dither p_dither)
+    {
+        m_dither = p_dither;
+        return *this;
+    }
+
+    /// Set how attributes are determined.
+    ScreenConverter& SetAttributeMethod(AttributeMethod p_method)
+    {
+        m_attribute_method = p_method;
+        return *this;
+    }
+
+    /// When set (default) pixels are chosen by distance of their gray value to black/white,
+    /// else by distance to ink and paper colors of their cell.
+    ScreenConverter& SetUseDistanceToBlackWhite(bool p_to_what)
+    {
+        m_use_distance_to_black_white = p_to_what;
+        return *this;
+    }
+
+    /// Set distance used to find nearest spectrum color (attributes).
+    ScreenConverter& SetColorMetric(ColorMetric p_metric)
+    {
+        m_color_metric = p_metric;
+        return *this;
+    }
+
+    /// Set spectrum colors (index at spectrum::screen::palette) considered dark, used as ink.
+    ScreenConverter& SetDarkColors(std::span<const int> p_colors)
+    {
+        m_dark_colors.assign(p_colors.begin(), p_colors.end());
+        return *this;
+    }
+
+    /// Set spectrum colors (index at spectrum::screen::palette) considered light, used as paper.
+    ScreenConverter& SetLightColors(std::span<const int> p_colors)
+    {
+        m_light_colors.assign(p_colors.begin(), p_colors.end());
+        return *this;
+    }
+
+    /// Convert given 256x192 image to spectrum screen.
+    /// p_stride: distance between rows, in pixels (eg QImage::bytesPerLine() / 4).
+    spectrum::screen::Screen Run(const Rgb *p_pixels, int p_stride) const;
+
+    /// Determine attribute of one 8x8 cell at given attribute (32x24) coordinates.
+    spectrum::screen::Attr GetAttributeForCell(const Rgb *p_pixels, int p_stride, int p_attr_x, int p_attr_y) const;
+
+    /// Convert given low resolution image to attributes only (32x24), to be shown on
+    /// a screen with bars: each cell half paper, half ink (eg video fun).
+    /// Image is 64x24: paper left, ink right; or 32x48: paper top, ink bottom.
+    std::vector<spectrum::screen::Attr> RunBars(const Rgb *p_pixels, int p_width, int p_height, int p_stride) const;
+
+private:
+
+    struct ColorTables;
+
+    spectrum::screen::Attr GetAttributeForCell(const ColorTables &p_tables, const Rgb *p_pixels, int p_stride, int p_attr_x, int p_attr_y) const;
+    spectrum::screen::Attr GetAttributeForCellDarkLight(const ColorTables &p_tables, const Rgb *p_cell, int p_stride) const;
+    spectrum::screen::Attr GetAttributeForCellBrightFirst(const ColorTables &p_tables, const Rgb *p_cell, int p_stride) const;
+    void QuantizeRows(const Rgb *p_pixels, int p_stride, spectrum::screen::Screen &p_screen) const;
+    void QuantizeFloydSteinberg(const Rgb *p_pixels, int p_stride, spectrum::screen::Screen &p_screen) const;
+    void GetInkPaper(const spectrum::screen::Screen &p_screen, int x, int y, Rgb &out_ink, Rgb &out_paper) const;
+    int GetThreadCount() const;
+
+private:
+
+    int              m_thread_count                = 0;
+    Dither           m_dither                      = Dither::floyd_steinberg;
+    AttributeMethod  m_attribute_method            = AttributeMethod::dark_light;
+    bool             m_use_distance_to_black_white = true;
+    ColorMetric      m_color_metric                = ColorMetric::rgb;
+    std::vector<int> m_dark_colors                 = { spectrum::screen::black, spectrum::screen::blue, spectrum::screen::red };
+    std::vector<int> m_light_colors                = { spectrum::screen::green, spectrum::screen::cyan, spectrum::screen::yellow, spectrum::screen::white,
+                                                       spectrum::screen::br_green, spectrum::screen::br_cyan, spectrum::screen::br_yellow, spectrum::screen::br_white };
+}; // class ScreenConverter
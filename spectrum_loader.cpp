@@ -9,7 +9,6 @@
 
 #include "spectrum_loader.h"
 #include "loadbinary.h"
-#include "pulsers.h"
 //#include "tzxloader.h"
 #include "tzxwriter.h"
 
@@ -26,7 +25,7 @@ inline void SpectrumLoader::StandbyToActive()
     std::unique_lock lock(m_mutex_standby_pulsers.mutex);
     m_active_pulsers = std::move(m_standby_pulsers);
     m_current_pulser = 0;
-   // m_time_estimated = 0ms;     // force recalc
+    m_duration_in_tstates = 0;     // force recalc (standby now empty)
 }
 
 
@@ -115,7 +114,7 @@ int SpectrumLoader::GetDurationInTStates() const
     {
         for(const auto &p : m_standby_pulsers)
         {
-            m_duration_in_tstates += p->GetDurationInTStates();
+            m_duration_in_tstates += std::visit([](const auto &p_pulser) { return p_pulser.GetDurationInTStates(); }, p);
         }
     }
     return m_duration_in_tstates;
@@ -127,8 +126,8 @@ int SpectrumLoader::GetDurationInTStates() const
 /// Move to next pulser. Return true when (completely) done.
 bool SpectrumLoader::Next()
 {
-    Pulser& current = GetCurrentPulser();
-    if (current.Next())     // true when at end of pulser
+    bool at_end = std::visit([](auto &p_pulser) { return p_pulser.Next(); }, GetCurrentPulser());
+    if (at_end)             // true when at end of pulser
     {
         m_current_pulser++;
         if (IsDone())       // all pulsers are done. Check for more (usually only at end)
@@ -145,8 +144,7 @@ bool SpectrumLoader::Next()
 /// Get duration to wait (in seconds)
 Doublesec SpectrumLoader::GetDurationWait() const
 {
-    Pulser& current = GetCurrentPulser();
-    return current.GetDurationWait();
+    return std::visit([](const auto &p_pulser) { return p_pulser.GetDurationWait(); }, GetCurrentPulser());
 }
 
 
@@ -157,8 +155,7 @@ Doublesec SpectrumLoader::GetDurationWait() const
 /// Eg a datapulser will return Edge::one when a 1 needs to be send etc.
 Edge SpectrumLoader::GetEdge() const
 {
-    Pulser& current = GetCurrentPulser();
-    return current.GetEdge();
+    return std::visit([](const auto &p_pulser) { return p_pulser.GetEdge(); }, GetCurrentPulser());
 }
 
 
@@ -11,15 +11,14 @@
 
 // #include <chrono>
 #include <vector>
-#include <memory>           // std::unique_ptr
 #include <functional>       // std::function
 #include "types.h"
 #include "datablock.h"      // Datablock used
 #include "spectrum_consts.h"
+#include "pulsers.h"        // AnyPulser
 #include <mutex>
 
 
-class Pulser;
 class SampleSender;
 
 // Not sure why std::mutex is not movable, really.
@@ -54,8 +53,7 @@ class SpectrumLoader
 {
 private:
 
-    using PulserPtr = std::unique_ptr<Pulser>;
-    using Pulsers   = std::vector<PulserPtr>;
+    using Pulsers   = std::vector<AnyPulser>;
     SpectrumLoader(const SpectrumLoader&)              = delete;
     SpectrumLoader & operator =(const SpectrumLoader&) = delete;
 
@@ -75,9 +73,8 @@ public:
     template <class TPulser, typename std::enable_if<std::is_base_of<Pulser, TPulser>::value, int>::type = 0>
     SpectrumLoader& AddPulser(TPulser p_pulser)
     {
-        PulserPtr ptr = std::make_unique< TPulser >(std::move(p_pulser));
         std::unique_lock lock(m_mutex_standby_pulsers.mutex);
-        m_standby_pulsers.push_back(std::move(ptr));
+        m_standby_pulsers.emplace_back(std::in_place_type<TPulser>, std::move(p_pulser));
         m_duration_in_tstates = 0;     // force recalc
         return *this;
     }
@@ -182,9 +179,13 @@ private:
     Edge GetEdge() const;
 
     // Get current pulser
-    Pulser& GetCurrentPulser() const
+    AnyPulser& GetCurrentPulser()
     {
-        return *(m_active_pulsers[m_current_pulser]);
+        return m_active_pulsers[m_current_pulser];
+    }
+    const AnyPulser& GetCurrentPulser() const
+    {
+        return m_active_pulsers[m_current_pulser];
     }
 
 
@@ -0,0 +1,625 @@
+// ==============================================================================
+// PROJECT:         zqloader
+// FILE:            spectrumemulator.cpp
+// DESCRIPTION:     Implementation of class SpectrumEmulator
+//
+// Copyright (c) 2025 Daan Scherft [Oxidaan]
+// This project uses the MIT license. See LICENSE.txt for details.
+// ==============================================================================
+
+#include "spectrumemulator.h"
+#include "spectrum_types.h"     // TapeHeader
+#include "byte_tools.h"         // _byte
+#include <iostream>
+#include <algorithm>
+#include <ostream>
+#include <stdexcept>
+
+
+namespace
+{
+constexpr uint16_t return_to_basic      = 0x2d2b;       // STACK-BC: return address USR pushes (48K ROM / 128K ROM 1)
+constexpr uint16_t rom_print            = 0x0010;       // RST 10h
+constexpr int      frame_48k            = 69888;        // T-states between interrupts
+constexpr int      frame_128k           = 70908;
+constexpr int      interrupt_length     = 32;           // T-states INT is active
+constexpr size_t   bank_size            = 16384;
+
+// Keyboard matrix: half row (port 0xfefe is row 0 .. 0x7ffe is row 7) and bit
+constexpr std::pair<int, int> key_enter        { 6, 0 };
+constexpr std::pair<int, int> key_j            { 6, 3 };   // LOAD at K mode
+constexpr std::pair<int, int> key_p            { 5, 0 };   // " with symbol shift
+constexpr std::pair<int, int> key_symbol_shift { 7, 1 };
+
+constexpr double boot_time_48k          = 2.5;          // sec before ROM waits for a key
+constexpr double boot_time_128k         = 4.0;          // sec before 128K menu is there
+constexpr double key_hold               = 0.1;          // sec
+constexpr double key_gap                = 0.15;         // sec
+constexpr double start_audio_delay      = 1.0;          // sec after last key
+constexpr double run_basic_delay        = 0.02;         // sec after last ROM block (no ROM)
+
+// Normal speed (ROM) pulse lengths in T-states, also for tstate_quick_zero.
+constexpr double rom_leader_min         = 1900;
+constexpr double rom_leader_max         = 2600;
+constexpr double rom_one_pair_min       = 2400;         // two pulses of a bit longer than this: one
+constexpr double rom_max_pulse          = 2400;         // longer: end of block
+constexpr int    rom_leader_min_pulses  = 256;
+
+constexpr uint8_t token_clear           = 0xfd;
+constexpr uint8_t token_usr             = 0xc0;
+constexpr uint8_t number_marker         = 0x0e;         // followed by 5 byte number
+
+
+// Find (small integer) number following given token at BASIC. 0 when not found.
+uint16_t FindNumberAfterToken(const DataBlock &p_basic, uint8_t p_token)
+{
+    for (size_t n = 0; n < p_basic.size(); n++)
+    {
+        if (uint8_t(p_basic[n]) == p_token)
+        {
+            for (size_t m = n + 1; m + 5 < p_basic.size(); m++)
+            {
+                if (uint8_t(p_basic[m]) == number_marker)
+                {
+                    return uint16_t(uint8_t(p_basic[m + 3]) | uint8_t(p_basic[m + 4]) << 8);
+                }
+            }
+        }
+    }
+    return 0;
+}
+}   // namespace
+
+
+
+SpectrumEmulator::SpectrumEmulator() :
+    m_cpu(*this)
+{}
+
+
+
+/// Set ROM image to use: 16K for 48K, 32K (ROM 0 followed by ROM 1) for 128K.
+/// When not set (or empty) loads without ROM.
+SpectrumEmulator& SpectrumEmulator::SetRom(const std::filesystem::path &p_filename)
+{
+    m_rom_filename = p_filename;
+    return *this;
+}
+
+
+
+/// Boot, feed the edges and run until done or timeout.
+SpectrumEmulator& SpectrumEmulator::Run()
+{
+    m_ram.assign(8 * bank_size, 0);
+    m_port_7ffd  = 0;
+    m_border     = 7;
+    m_edge_index = 0;
+    m_ear        = false;
+    m_ula_reads  = 0;
+    m_ula_reads_last_frame = 0;
+    m_key_events.clear();
+    m_key_index  = 0;
+    std::fill(std::begin(m_keyboard), std::end(m_keyboard), uint8_t(0));
+    m_time       = 0;
+    m_started    = false;
+    m_done       = false;
+    m_returned   = false;
+    m_printed.clear();
+    m_cpu.Reset();
+    if (m_rom_filename.empty())
+    {
+        BootWithoutRom();
+    }
+    else
+    {
+        BootWithRom();
+    }
+
+    const int frame         = m_is_128k ? frame_128k : frame_48k;
+    uint64_t next_interrupt = (m_time / frame + 1) * frame;
+    const uint64_t end_time = m_audio_start + uint64_t(m_edges.empty() ? 0.0 : m_edges.back()) +
+                              uint64_t(m_timeout.count() * m_spectrum_clock);
+    uint64_t next_frame     = next_interrupt;          // to count ULA reads per frame
+    auto &regs = m_cpu.GetRegisters();
+    while (m_time < end_time)
+    {
+        if (m_time >= next_frame)
+        {
+            m_ula_reads_last_frame = m_ula_reads;
+            m_ula_reads            = 0;
+            next_frame            += frame;
+        }
+        while (m_key_index < m_key_events.size() && m_key_events[m_key_index].m_time <= m_time)
+        {
+            const auto &key = m_key_events[m_key_index++];
+            if (key.m_pressed)
+            {
+                m_keyboard[key.m_row] |= uint8_t(1 << key.m_bit);
+            }
+            else
+            {
+                m_keyboard[key.m_row] &= uint8_t(~(1 << key.m_bit));
+            }
+        }
+        if (m_time >= next_interrupt)
+        {
+            if (m_time < next_interrupt + interrupt_length)
+            {
+                int tstates = m_cpu.Interrupt();
+                if (tstates)
+                {
+                    m_time         += tstates;
+                    next_interrupt += frame;
+                }
+            }
+            else
+            {
+                next_interrupt += frame;
+            }
+        }
+        const uint16_t pc = regs.pc;
+        if (!m_started && pc >= spectrum::PROG)     // (128K ROM uses RAM below PROG)
+        {
+            m_started      = true;
+            m_started_time = m_time;
+        }
+        if (m_started)
+        {
+            if (m_stop_address != 0 && pc == m_stop_address)
+            {
+                m_done = true;
+                break;
+            }
+            if (m_stop_at_basic && pc == return_to_basic && IsRom1Paged())
+            {
+                m_done     = true;
+                m_returned = true;
+                break;
+            }
+            if (pc == rom_print && IsRom1Paged() && Peek(uint16_t(regs.sp + 1)) >= 0x40)
+            {
+                m_printed += char(regs.a);          // called from RAM, so by our loader
+            }
+        }
+        m_time += m_cpu.Step();
+    }
+    m_done_time = m_time;
+    return *this;
+}
+
+
+
+/// Loading done as expected, and loader printed nothing (eg no CRC ERROR)?
+/// When not stopping at all (no stop address, not at BASIC) running until
+/// timeout is expected, eg loader waiting for the next program.
+bool SpectrumEmulator::IsOk() const
+{
+    if (m_stop_address == 0 && !m_stop_at_basic)
+    {
+        return m_started && m_printed.empty();
+    }
+    return m_done && m_printed.empty() && m_returned == (m_stop_address == 0);
+}
+
+
+
+uint8_t SpectrumEmulator::Peek(uint16_t p_address) const
+{
+    if (p_address < spectrum::RAM_START)
+    {
+        size_t offset = (m_is_128k && (m_port_7ffd & 0x10)) ? bank_size : 0;
+        return offset + p_address < m_rom.size() ? m_rom[offset + p_address] : 0xff;
+    }
+    return m_ram[GetBank(p_address) * bank_size + (p_address & 0x3fff)];
+}
+
+
+
+uint8_t SpectrumEmulator::PeekBank(int p_bank, uint16_t p_offset) const
+{
+    return m_ram[size_t(p_bank & 7) * bank_size + (p_offset & 0x3fff)];
+}
+
+
+
+/// Compare memory with given blocks (m_bank >= 0: at that 128K bank).
+/// Shows the ranges that differ at std::cout. Returns # bytes that differ.
+size_t SpectrumEmulator::CompareMemory(const MemoryBlocks &p_expected) const
+{
+    constexpr int max_ranges_to_show = 16;
+    size_t retval = 0;
+    int ranges    = 0;
+    for (const auto &block : p_expected)
+    {
+        int range_start = -1;
+        auto ShowRange = [&](int p_end)
+        {
+            if (range_start >= 0 && ++ranges <= max_ranges_to_show)
+            {
+                std::cout << "  Memory differs at " << range_start << " - " << p_end - 1;
+                if (block.m_bank >= 0)
+                {
+                    std::cout << " (bank " << block.m_bank << ")";
+                }
+                std::cout << " (" << p_end - range_start << " bytes)" << std::endl;
+            }
+            range_start = -1;
+        };
+        for (int n = 0; n < int(block.m_datablock.size()); n++)
+        {
+            int address    = block.m_address + n;
+            uint8_t actual = block.m_bank >= 0 ? PeekBank(block.m_bank, uint16_t(address)) :
+                                                 Peek(uint16_t(address));
+            if (actual != uint8_t(block.m_datablock[n]))
+            {
+                retval++;
+                if (range_start < 0)
+                {
+                    range_start = address;
+                }
+            }
+            else
+            {
+                ShowRange(address);
+            }
+        }
+        ShowRange(block.GetEndAddress());
+    }
+    if (ranges > max_ranges_to_show)
+    {
+        std::cout << "  (and " << ranges - max_ranges_to_show << " more ranges)" << std::endl;
+    }
+    std::cout << "Memory compare: " << retval << " bytes differ" << std::endl;
+    return retval;
+}
+
+
+
+/// Write current machine state as .sna snapshot (48K or 128K).
+/// See https://worldofspectrum.org/faq/reference/formats.htm
+/// At 48K the PC is pushed at the stack, as the format requires.
+void SpectrumEmulator::WriteSnapshot(std::ostream &p_stream) const
+{
+    const auto &regs = m_cpu.GetRegisters();
+    std::vector<uint8_t> ram(3 * bank_size);
+    for (size_t n = 0; n < ram.size(); n++)
+    {
+        ram[n] = Peek(uint16_t(spectrum::RAM_START + n));
+    }
+    uint16_t sp = regs.sp;
+    if (!m_is_128k)
+    {
+        sp = uint16_t(sp - 2);
+        if (sp < spectrum::RAM_START)
+        {
+            throw std::runtime_error("Can not write 48K snapshot: SP not in RAM");
+        }
+        ram[sp - spectrum::RAM_START] = uint8_t(regs.pc);
+        if (sp + 1 - spectrum::RAM_START < int(ram.size()))
+        {
+            ram[sp + 1 - spectrum::RAM_START] = uint8_t(regs.pc >> 8);
+        }
+    }
+    std::vector<uint8_t> header;
+    auto Add = [&](uint16_t p_value)
+    {
+        header.push_back(uint8_t(p_value));
+        header.push_back(uint8_t(p_value >> 8));
+    };
+    header.push_back(regs.i);
+    Add(uint16_t(regs.h_ << 8 | regs.l_));
+    Add(uint16_t(regs.d_ << 8 | regs.e_));
+    Add(uint16_t(regs.b_ << 8 | regs.c_));
+    Add(uint16_t(regs.a_ << 8 | regs.f_));
+    Add(regs.GetHL());
+    Add(regs.GetDE());
+    Add(regs.GetBC());
+    Add(regs.iy);
+    Add(regs.ix);
+    header.push_back(regs.iff2 ? 0x04 : 0x00);
+    header.push_back(regs.r);
+    Add(regs.GetAF());
+    Add(sp);
+    header.push_back(uint8_t(regs.im));
+    header.push_back(m_border);
+    p_stream.write(reinterpret_cast<const char*>(header.data()), std::streamsize(header.size()));
+    p_stream.write(reinterpret_cast<const char*>(ram.data()), std::streamsize(ram.size()));
+    if (m_is_128k)
+    {
+        header.clear();
+        Add(regs.pc);
+        header.push_back(m_port_7ffd);
+        header.push_back(0);                    // TR-DOS ROM not paged
+        p_stream.write(reinterpret_cast<const char*>(header.data()), std::streamsize(header.size()));
+        for (int bank : { 0, 1, 3, 4, 6, 7 })
+        {
+            if (bank != (m_port_7ffd & 0x7))    // 5, 2 and current bank are at the first 48K
+            {
+                p_stream.write(reinterpret_cast<const char*>(m_ram.data() + size_t(bank) * bank_size), std::streamsize(bank_size));
+            }
+        }
+    }
+    if (!p_stream)
+    {
+        throw std::runtime_error("Error writing snapshot");
+    }
+}
+
+
+
+/// Show result of Run at std::cout
+const SpectrumEmulator& SpectrumEmulator::DebugDump() const
+{
+    auto Seconds = [&](uint64_t p_tstates)
+    {
+        return double(p_tstates) / m_spectrum_clock;
+    };
+    std::cout << "Emulated ZX Spectrum " << (m_is_128k ? "128K" : "48K");
+    if (m_rom_filename.empty())
+    {
+        std::cout << " without ROM (normal speed blocks decoded at host; loader started directly)" << std::endl;
+    }
+    else
+    {
+        std::cout << " with ROM " << m_rom_filename << std::endl;
+    }
+    if (m_started)
+    {
+        std::cout << "Loader started at " << Seconds(m_started_time - m_audio_start) << "s (from start of audio)" << std::endl;
+    }
+    if (m_done)
+    {
+        std::cout << (m_returned ? "Returned to BASIC" : "Reached start address") << " at "
+                  << Seconds(GetLoadTStates()) << "s (" << GetLoadTStates() << " T states)";
+        if (m_started)
+        {
+            std::cout << "; loader took " << Seconds(m_done_time - m_started_time) << "s ("
+                      << m_done_time - m_started_time << " T states)";
+        }
+        std::cout << std::endl;
+        if (m_returned && m_stop_address != 0)
+        {
+            std::cout << "Expected to start at " << m_stop_address << " instead" << std::endl;
+        }
+    }
+    else if (m_stop_address == 0 && !m_stop_at_basic)
+    {
+        std::cout << "Stopped " << m_timeout.count() << "s after last edge (PC = "
+                  << m_cpu.GetRegisters().pc << ")" << std::endl;
+    }
+    else
+    {
+        std::cout << "Timeout: not done " << m_timeout.count() << "s after last edge (PC = "
+                  << m_cpu.GetRegisters().pc << ")" << std::endl;
+    }
+    if (!m_printed.empty())
+    {
+        std::string printed = m_printed;
+        std::replace(printed.begin(), printed.end(), '\r', ' ');
+        std::cout << "Loader printed: '" << printed << "'" << std::endl;
+    }
+    return *this;
+}
+
+
+
+uint8_t SpectrumEmulator::Read(uint16_t p_address)
+{
+    return Peek(p_address);
+}
+
+
+
+void SpectrumEmulator::Write(uint16_t p_address, uint8_t p_value)
+{
+    if (p_address >= spectrum::RAM_START)
+    {
+        m_ram[GetBank(p_address) * bank_size + (p_address & 0x3fff)] = p_value;
+    }
+}
+
+
+
+// ULA (port 0xfe): keyboard half rows selected by high byte at bits 0..4, EAR at bit 6.
+uint8_t SpectrumEmulator::In(uint16_t p_port)
+{
+    if (p_port & 1)
+    {
+        return 0xff;            // nothing there
+    }
+    m_ula_reads++;
+    while (m_edge_index < m_edges.size() && m_audio_start + m_edges[m_edge_index] <= double(m_time))
+    {
+        m_ear = !m_ear;
+        m_edge_index++;
+    }
+    uint8_t keys = 0x1f;
+    for (int row = 0; row < 8; row++)
+    {
+        if (!(p_port & (0x100 << row)))
+        {
+            keys &= uint8_t(~m_keyboard[row]);
+        }
+    }
+    return uint8_t(0xa0 | (m_ear ? 0x40 : 0) | keys);
+}
+
+
+
+// Border (for snapshots) and 128K paging; beeper is not needed.
+void SpectrumEmulator::Out(uint16_t p_port, uint8_t p_value)
+{
+    if (!(p_port & 1))
+    {
+        m_border = p_value & 0x7;
+    }
+    if (m_is_128k && !(p_port & 0x8002) && !(m_port_7ffd & 0x20))
+    {
+        m_port_7ffd = p_value;
+    }
+}
+
+
+
+// Reset, then type keys to start loading; sets m_audio_start.
+void SpectrumEmulator::BootWithRom()
+{
+    DataBlock rom = LoadFromFile(m_rom_filename);
+    if (rom.size() != bank_size && rom.size() != 2 * bank_size)
+    {
+        throw std::runtime_error("ROM file " + m_rom_filename.string() + " must be 16K (48K) or 32K (128K)");
+    }
+    if (m_is_128k && rom.size() != 2 * bank_size)
+    {
+        throw std::runtime_error("ROM file " + m_rom_filename.string() + " must be 32K for a 128K ZX Spectrum");
+    }
+    // 48K with a 32K image: take ROM 1 (48 BASIC)
+    auto begin = (!m_is_128k && rom.size() == 2 * bank_size) ? rom.begin() + bank_size : rom.begin();
+    m_rom.assign(reinterpret_cast<const uint8_t*>(&*begin), reinterpret_cast<const uint8_t*>(rom.data() + rom.size()));
+
+    double time;
+    if (m_is_128k)
+    {
+        time = TypeKeys(boot_time_128k * m_spectrum_clock, { key_enter });         // Tape Loader
+    }
+    else
+    {
+        time = TypeKeys(boot_time_48k * m_spectrum_clock, { key_j });             // LOAD
+        time = TypeKeys(time, { key_symbol_shift, key_p });                       // "
+        time = TypeKeys(time, { key_symbol_shift, key_p });                       // "
+        time = TypeKeys(time, { key_enter });
+    }
+    m_audio_start = uint64_t(time + start_audio_delay * m_spectrum_clock);
+}
+
+
+
+// Decode normal speed blocks from edges, put BASIC at PROG, start as PRINT USR would.
+// Only needs the ROM stub: RET everywhere.
+void SpectrumEmulator::BootWithoutRom()
+{
+    m_rom.assign(2 * bank_size, 0xc9);          // RET
+    for (size_t rom = 0; rom < m_rom.size(); rom += bank_size)
+    {
+        m_rom[rom + 0x00] = 0xf3;               // DI
+        m_rom[rom + 0x01] = 0x76;               // HALT
+        m_rom[rom + 0x38] = 0xfb;               // EI (RET follows)
+    }
+    m_port_7ffd   = 0x10;                       // ROM 1 as when at BASIC
+    m_audio_start = 0;
+
+    size_t index       = 0;
+    DataBlock header   = DecodeRomBlock(index, sizeof(spectrum::TapeHeader) + 2);
+    if (header.size() != sizeof(spectrum::TapeHeader) + 2 || header[0] != std::byte(spectrum::TapeBlockType::header))
+    {
+        throw std::runtime_error("Emulator (without ROM): no normal speed header found");
+    }
+    spectrum::TapeHeader tape_header;
+    std::copy(header.begin() + 1, header.end() - 1, reinterpret_cast<std::byte*>(&tape_header));
+    if (tape_header.m_type != spectrum::TapeHeader::Type::basic_program)
+    {
+        throw std::runtime_error("Emulator (without ROM): first block must be BASIC (zqloader.tap)");
+    }
+    DataBlock data = DecodeRomBlock(index, tape_header.m_length + 2u);
+    if (data.size() != tape_header.m_length + 2u || data[0] != std::byte(spectrum::TapeBlockType::data) ||
+        spectrum::CalculateChecksum(0_byte, data) != 0_byte)
+    {
+        throw std::runtime_error("Emulator (without ROM): normal speed data block not loaded correctly");
+    }
+    DataBlock basic(data.begin() + 1, data.end() - 1);
+    std::transform(basic.begin(), basic.end(), m_ram.begin() + GetBank(spectrum::PROG) * bank_size + (spectrum::PROG & 0x3fff),
+                   [](std::byte p_byte) { return uint8_t(p_byte); });
+
+    uint16_t clear = FindNumberAfterToken(basic, token_clear);
+    uint16_t usr   = FindNumberAfterToken(basic, token_usr);
+    if (usr == 0)
+    {
+        throw std::runtime_error("Emulator (without ROM): no USR found at BASIC");
+    }
+    auto &regs = m_cpu.GetRegisters();
+    regs.sp    = uint16_t((clear ? clear : 0xff58) - 2);
+    Write(regs.sp, uint8_t(return_to_basic & 0xff));
+    Write(uint16_t(regs.sp + 1), uint8_t(return_to_basic >> 8));
+    regs.iy    = 0x5c3a;                        // ERR-NR, ROM needs this
+    regs.i     = 0x3f;
+    regs.im    = 1;
+    regs.pc    = usr;
+    m_time     = uint64_t(m_edges[index - 1] + run_basic_delay * m_spectrum_clock);
+}
+
+
+
+// Decode one normal speed (ROM) block of given length (including flag and checksum)
+// starting at edge p_index. p_index is moved to the edge after the block.
+// Returns less when not found or a pause came first.
+DataBlock SpectrumEmulator::DecodeRomBlock(size_t &p_index, size_t p_length) const
+{
+    auto Pulse = [&](size_t p_edge)
+    {
+        return m_edges[p_edge + 1] - m_edges[p_edge];
+    };
+    auto IsLeader = [&](size_t p_edge)
+    {
+        return Pulse(p_edge) >= rom_leader_min && Pulse(p_edge) <= rom_leader_max;
+    };
+    DataBlock retval;
+    int count = 0;
+    while (p_index + 1 < m_edges.size() && count < rom_leader_min_pulses)
+    {
+        count = IsLeader(p_index++) ? count + 1 : 0;
+    }
+    while (p_index + 1 < m_edges.size() && IsLeader(p_index))
+    {
+        p_index++;
+    }
+    p_index += 2;                               // sync
+    uint8_t byte = 0;
+    int bits     = 0;
+    while (p_index + 2 < m_edges.size() && retval.size() < p_length &&
+           Pulse(p_index) < rom_max_pulse && Pulse(p_index + 1) < rom_max_pulse)
+    {
+        byte     = uint8_t(byte << 1 | (m_edges[p_index + 2] - m_edges[p_index] > rom_one_pair_min ? 1 : 0));
+        p_index += 2;
+        if (++bits == 8)
+        {
+            retval.push_back(std::byte(byte));
+            bits = 0;
+        }
+    }
+    return retval;
+}
+
+
+
+void SpectrumEmulator::AddKey(double p_time, int p_row, int p_bit, bool p_pressed)
+{
+    m_key_events.push_back({ p_time, p_row, p_bit, p_pressed });
+}
+
+
+
+// Press then release given keys (same time) starting at given time.
+// Returns time for next key.
+double SpectrumEmulator::TypeKeys(double p_time, std::initializer_list<std::pair<int, int>> p_keys)
+{
+    for (const auto &[row, bit] : p_keys)
+    {
+        AddKey(p_time, row, bit, true);
+    }
+    for (const auto &[row, bit] : p_keys)
+    {
+        AddKey(p_time + key_hold * m_spectrum_clock, row, bit, false);
+    }
+    return p_time + (key_hold + key_gap) * m_spectrum_clock;
+}
+
+
+
+// Current memory bank at given address (RAM only).
+int SpectrumEmulator::GetBank(uint16_t p_address) const
+{
+    return p_address < 0x8000 ? 5 :
+           p_address < 0xc000 ? 2 :
+           m_is_128k ? (m_port_7ffd & 7) : 0;
+}
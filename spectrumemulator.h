@@ -0,0 +1,219 @@
+// ==============================================================================
+// PROJECT:         zqloader
+// FILE:            spectrumemulator.h
+// DESCRIPTION:     Definition of class SpectrumEmulator
+//
+// Copyright (c) 2025 Daan Scherft [Oxidaan]
+// This project uses the MIT license. See LICENSE.txt for details.
+// ==============================================================================
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <filesystem>
+#include <iosfwd>
+#include <initializer_list>
+#include <utility>
+#include <cstdint>
+#include "types.h"              // Doublesec
+#include "spectrum_consts.h"
+#include "datablock.h"
+#include "memoryblock.h"        // MemoryBlocks
+#include "z80cpu.h"
+
+
+/// A ZX Spectrum 48K/128K (Z80, memory, paging, keyboard, EAR input) to test loading
+/// on a host without a ZX Spectrum or sound card.
+/// EAR input is driven by edges, eg as found by TurboDemodulator::LoadWav at the audio
+/// that SpectrumLoader produces.
+/// With a ROM image: boots, types LOAD "" (48K) or selects Tape Loader (128K) then the
+/// ROM loads zqloader.tap normally, followed by the turbo blocks.
+/// Without a ROM image: the normal speed blocks are decoded at the host, the BASIC is put
+/// at PROG and the loader is started as PRINT USR would. A stub ROM handles the
+/// calls zqloader does to the ROM (CLS, RST 10h).
+/// Memory and IO contention are not emulated; zqloader runs from uncontended memory anyway.
+/// Loading is done when the PC reaches the stop address (as in RANDOMIZE USR xxxxx),
+/// or when the loader returns to BASIC.
+class SpectrumEmulator : private Z80Cpu::Bus
+{
+public:
+
+    SpectrumEmulator();
+    SpectrumEmulator(const SpectrumEmulator &) = delete;
+    SpectrumEmulator & operator = (const SpectrumEmulator &) = delete;
+
+
+    /// Set ROM image to use: 16K for 48K, 32K (ROM 0 followed by ROM 1) for 128K.
+    /// When not set (or empty) loads without ROM, see class description.
+    SpectrumEmulator& SetRom(const std::filesystem::path &p_filename);
+
+    /// Emulate a 128K ZX Spectrum (paging at port 0x7ffd), else 48K.
+    SpectrumEmulator& Set128K(bool p_is_128k)
+    {
+        m_is_128k = p_is_128k;
+        return *this;
+    }
+
+    /// Set clock frequency in hz.
+    SpectrumEmulator& SetSpectrumClock(int p_spectrum_clock)
+    {
+        m_spectrum_clock = p_spectrum_clock;
+        return *this;
+    }
+
+    /// Set edges at EAR (times in T-states from start of audio, ascending). Each toggles the EAR level.
+    SpectrumEmulator& SetEdges(std::vector<double> p_edges)
+    {
+        m_edges = std::move(p_edges);
+        return *this;
+    }
+
+    /// Loading is done when PC reaches this address (as in RANDOMIZE USR xxxxx).
+    /// When 0 expect loader to return to BASIC.
+    SpectrumEmulator& SetStopAddress(uint16_t p_address)
+    {
+        m_stop_address = p_address;
+        return *this;
+    }
+
+    /// Stop when (started and) returning to BASIC, as the zqloader does when
+    /// not calling USR. Default true. Set false to keep running eg for a BASIC
+    /// loader that calls some machine code, then loads more.
+    SpectrumEmulator& SetStopWhenReturnToBasic(bool p_stop)
+    {
+        m_stop_at_basic = p_stop;
+        return *this;
+    }
+
+    /// How long to keep running after last edge before giving up.
+    SpectrumEmulator& SetTimeout(Doublesec p_timeout)
+    {
+        m_timeout = p_timeout;
+        return *this;
+    }
+
+    /// Boot, feed the edges and run until done or timeout.
+    SpectrumEmulator& Run();
+
+    /// Loading done as expected, and loader printed nothing (eg no CRC ERROR)?
+    bool IsOk() const;
+
+    /// Reached stop address or returned to BASIC (no timeout)?
+    bool IsDone() const
+    {
+        return m_done;
+    }
+
+    /// T-states from start of audio until done (or timeout).
+    uint64_t GetLoadTStates() const
+    {
+        return m_done_time - m_audio_start;
+    }
+
+    /// Program counter now.
+    uint16_t GetPc() const
+    {
+        return m_cpu.GetRegisters().pc;
+    }
+
+    /// Number of times port 0xfe (EAR, keyboard) was read during the last complete frame.
+    /// A loader waiting for an edge reads it thousands of times per frame; a game
+    /// scanning the keyboard only a few times.
+    int GetUlaReadsLastFrame() const
+    {
+        return m_ula_reads_last_frame;
+    }
+
+    /// Text printed by the loader with RST 10h (eg "CRC ERROR").
+    const std::string &GetPrinted() const
+    {
+        return m_printed;
+    }
+
+    /// Read memory as the CPU sees it now.
+    uint8_t Peek(uint16_t p_address) const;
+
+    /// Read from given 128K RAM bank (0..7).
+    uint8_t PeekBank(int p_bank, uint16_t p_offset) const;
+
+    /// Compare memory with given blocks (m_bank >= 0: at that 128K bank).
+    /// Shows the ranges that differ at std::cout. Returns # bytes that differ.
+    size_t CompareMemory(const MemoryBlocks &p_expected) const;
+
+    /// Write current machine state as .sna snapshot (48K or 128K).
+    void WriteSnapshot(std::ostream &p_stream) const;
+
+    /// Show result of Run at std::cout
+    const SpectrumEmulator& DebugDump() const;
+
+private:
+
+    // Z80Cpu::Bus
+    uint8_t Read(uint16_t p_address) override;
+    void    Write(uint16_t p_address, uint8_t p_value) override;
+    uint8_t In(uint16_t p_port) override;
+    void    Out(uint16_t p_port, uint8_t p_value) override;
+
+    // Reset, then type keys to start loading; sets m_audio_start.
+    void BootWithRom();
+
+    // Decode normal speed blocks from edges, put BASIC at PROG, start as PRINT USR would.
+    void BootWithoutRom();
+
+    // Decode one normal speed (ROM) block of given length (including flag and checksum)
+    // starting at edge p_index. p_index is moved to the edge after the block.
+    DataBlock DecodeRomBlock(size_t &p_index, size_t p_length) const;
+
+    // Key press/release at given time; row (0..7) and bit (0..4) at keyboard matrix.
+    void AddKey(double p_time, int p_row, int p_bit, bool p_pressed);
+
+    // Press then release given keys (same time) starting at given time.
+    double TypeKeys(double p_time, std::initializer_list<std::pair<int, int>> p_keys);
+
+    // Current memory bank at given address (RAM only).
+    int GetBank(uint16_t p_address) const;
+
+    bool IsRom1Paged() const
+    {
+        return !m_is_128k || (m_port_7ffd & 0x10);
+    }
+
+private:
+
+    struct KeyEvent
+    {
+        double  m_time;
+        int     m_row;
+        int     m_bit;
+        bool    m_pressed;
+    };
+
+    Z80Cpu                  m_cpu;
+    std::vector<uint8_t>    m_rom;                          // 16K or 32K
+    std::vector<uint8_t>    m_ram;                          // 8 banks of 16K (48K uses 5, 2, 0)
+    std::filesystem::path   m_rom_filename;
+    bool                    m_is_128k        = false;
+    uint8_t                 m_port_7ffd      = 0;
+    uint8_t                 m_border         = 7;
+    int                     m_spectrum_clock = spectrum::spectrum_clock;
+    std::vector<double>     m_edges;
+    size_t                  m_edge_index     = 0;           // next edge not reached yet
+    bool                    m_ear            = false;
+    int                     m_ula_reads      = 0;           // at this frame
+    int                     m_ula_reads_last_frame = 0;
+    std::vector<KeyEvent>   m_key_events;
+    size_t                  m_key_index      = 0;
+    uint8_t                 m_keyboard[8]    = {};          // pressed keys (bits) per half row
+    uint16_t                m_stop_address   = 0;
+    bool                    m_stop_at_basic  = true;
+    Doublesec               m_timeout        = 5s;
+    uint64_t                m_time           = 0;           // T-states since reset
+    uint64_t                m_audio_start    = 0;           // T-state when first edge is at 0
+    uint64_t                m_started_time   = 0;           // T-state when (RAM) loader started
+    uint64_t                m_done_time      = 0;
+    bool                    m_started        = false;
+    bool                    m_done           = false;
+    bool                    m_returned       = false;       // returned to BASIC
+    std::string             m_printed;
+}; // class SpectrumEmulator
@@ -0,0 +1,389 @@
+// ==============================================================================
+// PROJECT:         zqloader
+// FILE:            tapeedges.cpp
+// DESCRIPTION:     Implementation of class TapeEdges
+//
+// Copyright (c) 2026 Daan Scherft [Oxidaan]
+// This project uses the MIT license. See LICENSE.txt for details.
+// ==============================================================================
+
+#include "tapeedges.h"
+#include "tzx_types.h"
+#include "taploader.h"
+#include "loadbinary.h"
+#include "spectrum_consts.h"
+#include "tools.h"              // ToLower
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+
+namespace fs = std::filesystem;
+
+namespace
+{
+constexpr int tstates_per_ms       = spectrum::spectrum_clock / 1000;
+constexpr int header_pilot_pulses  = 8063;
+constexpr int data_pilot_pulses    = 3223;
+constexpr int tap_pause_ms         = 1000;      // tap has no pauses, as SAVE does
+constexpr int stop_the_tape_ms     = 1000;      // 'stop the tape' (pause 0): as if started again right away
+
+
+int Get24(std::istream &p_stream)
+{
+    int len1 = LoadBinary<BYTE>(p_stream);     // bit of weird 24 bit length
+    int len2 = LoadBinary<BYTE>(p_stream);
+    int len3 = LoadBinary<BYTE>(p_stream);
+    return 0x10000 * len3 + 0x100 * len2 + len1;
+}
+}
+
+
+
+TapeEdges& TapeEdges::Load(const fs::path &p_filename)
+{
+    std::ifstream fileread(p_filename, std::ios::binary);
+    if (!fileread)
+    {
+        throw std::runtime_error("File " + p_filename.string() + " not found.");
+    }
+    try
+    {
+        if (ToLower(p_filename.extension().string()) == ".tap")
+        {
+            ReadTap(fileread);
+        }
+        else
+        {
+            ReadTzx(fileread);
+        }
+    }
+    catch(const std::exception &e)
+    {
+        // clarify
+        throw std::runtime_error("Reading file: " + p_filename.string() + ": " + e.what());
+    }
+    return *this;
+}
+
+
+
+void TapeEdges::ReadTap(std::istream &p_stream)
+{
+    while (p_stream.peek() != std::char_traits<char>::eof() && p_stream.good())
+    {
+        AddStandardBlock(TapLoader::LoadTapBlock(p_stream), tap_pause_ms);
+    }
+}
+
+
+
+// http://k1.spdns.de/Develop/Projects/zasm/Info/TZX%20format.html
+// https://worldofspectrum.net/TZXformat.html
+void TapeEdges::ReadTzx(std::istream &p_stream)
+{
+    if (LoadBinary<std::string>(p_stream, 7) != "ZXTape!")
+    {
+        throw std::runtime_error("Not a tzx file");
+    }
+    p_stream.ignore(3);         // eof marker, version
+    std::streampos loop_start;
+    int loop_count = 0;
+    while (p_stream.peek() != std::char_traits<char>::eof() && p_stream.good())
+    {
+        TzxBlockType id = LoadBinary<TzxBlockType>(p_stream);
+        switch (id)
+        {
+        case TzxBlockType::StandardSpeedDataBlock:
+        {
+            int pause = LoadBinary<WORD>(p_stream);
+            int len   = LoadBinary<WORD>(p_stream);
+            AddStandardBlock(TapLoader::LoadTapBlock(p_stream, len), pause);
+            break;
+        }
+        case TzxBlockType::TurboSpeedDataBlock:
+        {
+            auto turbo = LoadBinary<TurboSpeedDataBlock>(p_stream);
+            int len    = turbo.length[0] + 0x100 * turbo.length[1] + 0x10000 * turbo.length[2];
+            auto block = TapLoader::LoadTapBlock(p_stream, len);
+            for (int n = 0; n < turbo.length_of_pilot_tone; n++)
+            {
+                AddPulse(turbo.length_of_pilot_pulse);
+            }
+            AddPulse(turbo.length_of_sync_first_pulse);
+            AddPulse(turbo.length_of_sync_second_pulse);
+            AddData(block, turbo.length_of_zero_bit_pulse, turbo.length_of_one_bit_pulse, turbo.used_bits_last_byte);
+            AddPause(turbo.pause);
+            break;
+        }
+        case TzxBlockType::Puretone:
+        {
+            int len   = LoadBinary<WORD>(p_stream);
+            int count = LoadBinary<WORD>(p_stream);
+            for (int n = 0; n < count; n++)
+            {
+                AddPulse(len);
+            }
+            break;
+        }
+        case TzxBlockType::PulseSequence:
+        {
+            int count = LoadBinary<BYTE>(p_stream);
+            for (int n = 0; n < count; n++)
+            {
+                AddPulse(LoadBinary<WORD>(p_stream));
+            }
+            break;
+        }
+        case TzxBlockType::PureDataBlock:
+        {
+            int zero      = LoadBinary<WORD>(p_stream);
+            int one       = LoadBinary<WORD>(p_stream);
+            int used_bits = LoadBinary<BYTE>(p_stream);
+            int pause     = LoadBinary<WORD>(p_stream);
+            auto block    = TapLoader::LoadTapBlock(p_stream, Get24(p_stream));
+            AddData(block, zero, one, used_bits);
+            AddPause(pause);
+            break;
+        }
+        case TzxBlockType::DirectRecordingBlock:
+        {
+            int tstates_per_sample = LoadBinary<WORD>(p_stream);
+            int pause              = LoadBinary<WORD>(p_stream);
+            int used_bits          = LoadBinary<BYTE>(p_stream);
+            auto block             = TapLoader::LoadTapBlock(p_stream, Get24(p_stream));
+            for (size_t n = 0; n < block.size(); n++)
+            {
+                int bits = n + 1 == block.size() ? used_bits : 8;
+                for (int bit = 0; bit < bits; bit++)
+                {
+                    SetLevel((int(block[n]) << bit) & 0x80);
+                    m_time += tstates_per_sample;
+                }
+            }
+            AddPause(pause);
+            break;
+        }
+        case TzxBlockType::GeneralizedDataBlock:
+            ReadGeneralizedDataBlock(p_stream);
+            break;
+        case TzxBlockType::PauseOrStopthetapecommand:
+        {
+            int pause = LoadBinary<WORD>(p_stream);
+            AddPause(pause == 0 ? stop_the_tape_ms : pause);
+            break;
+        }
+        case TzxBlockType::Loopstart:
+            loop_count = LoadBinary<WORD>(p_stream);
+            loop_start = p_stream.tellg();
+            break;
+        case TzxBlockType::Loopend:
+            if (--loop_count > 0)
+            {
+                p_stream.seekg(loop_start);
+            }
+            break;
+        case TzxBlockType::Setsignallevel:
+            p_stream.ignore(4);
+            SetLevel(LoadBinary<BYTE>(p_stream) != 0);
+            break;
+        case TzxBlockType::CSWRecordingBlock:
+            std::cout << id << "; ignored/can not handle this block." << std::endl;
+            p_stream.ignore(LoadBinary<DWORD>(p_stream));
+            break;
+        case TzxBlockType::Jumptoblock:
+            std::cout << id << "; ignored/can not handle this block." << std::endl;
+            p_stream.ignore(2);
+            break;
+        case TzxBlockType::Callsequence:
+            std::cout << id << "; ignored/can not handle this block." << std::endl;
+            p_stream.ignore(LoadBinary<WORD>(p_stream) * 2);
+            break;
+        case TzxBlockType::Selectblock:
+            std::cout << id << "; ignored/can not handle this block." << std::endl;
+            p_stream.ignore(LoadBinary<WORD>(p_stream));
+            break;
+        case TzxBlockType::Returnfromsequence:
+        case TzxBlockType::GroupEnd:
+            break;
+        case TzxBlockType::Stopthetapeifin48Kmode:
+            p_stream.ignore(4);
+            break;
+        case TzxBlockType::Messageblock:
+            p_stream.ignore(1);     // time
+            [[fallthrough]];
+        case TzxBlockType::GroupStart:
+        case TzxBlockType::Textdescription:
+            p_stream.ignore(LoadBinary<BYTE>(p_stream));
+            break;
+        case TzxBlockType::Archiveinfo:
+            p_stream.ignore(LoadBinary<WORD>(p_stream));
+            break;
+        case TzxBlockType::Hardwaretype:
+            p_stream.ignore(LoadBinary<BYTE>(p_stream) * 3);
+            break;
+        case TzxBlockType::Custominfoblock:
+            p_stream.ignore(16);
+            p_stream.ignore(LoadBinary<DWORD>(p_stream));
+            break;
+        case TzxBlockType::Glueblock:
+            p_stream.ignore(9);
+            break;
+        default:
+            throw std::runtime_error("Unknown TZX block: " + std::to_string(int(id)));
+        }
+    }
+}
+
+
+
+// Generalized data block (0x19): symbol definitions for pilot/sync and data,
+// pilot/sync as (symbol, repetitions), then data as packed symbols.
+void TapeEdges::ReadGeneralizedDataBlock(std::istream &p_stream)
+{
+    struct SymDef
+    {
+        Edge                m_edge;
+        std::vector<int>    m_pulses;
+    };
+    auto ReadSymDefs = [&](int p_count, int p_max_pulses)
+    {
+        std::vector<SymDef> retval(p_count == 0 ? 256 : p_count);
+        for (auto &symdef : retval)
+        {
+            symdef.m_edge = Edge(LoadBinary<BYTE>(p_stream) & 3);
+            for (int n = 0; n < p_max_pulses; n++)
+            {
+                symdef.m_pulses.push_back(LoadBinary<WORD>(p_stream));
+            }
+        }
+        return retval;
+    };
+    auto AddSymbol = [&](const SymDef &p_symdef)
+    {
+        // symbol flags: what happens at the end of its first pulse
+        m_time += p_symdef.m_pulses.empty() ? 0 : p_symdef.m_pulses[0];
+        switch (p_symdef.m_edge)
+        {
+        case Edge::toggle:      AddEdge();          break;
+        case Edge::no_change:                       break;
+        case Edge::zero:        SetLevel(false);    break;
+        case Edge::one:         SetLevel(true);     break;
+        }
+        for (size_t n = 1; n < p_symdef.m_pulses.size() && p_symdef.m_pulses[n] != 0; n++)
+        {
+            AddPulse(p_symdef.m_pulses[n]);
+        }
+    };
+
+    auto block = LoadBinary<GeneralizedDataBlock>(p_stream);
+    if (block.totp > 0)
+    {
+        auto symdefs = ReadSymDefs(block.asp, block.npp);
+        for (DWORD n = 0; n < block.totp; n++)
+        {
+            int symbol      = LoadBinary<BYTE>(p_stream);
+            int repetitions = LoadBinary<WORD>(p_stream);
+            for (int r = 0; r < repetitions; r++)
+            {
+                AddSymbol(symdefs.at(symbol));
+            }
+        }
+    }
+    if (block.totd > 0)
+    {
+        auto symdefs     = ReadSymDefs(block.asd, block.npd);
+        int bits_per_sym = 0;
+        while ((1 << bits_per_sym) < int(symdefs.size()))
+        {
+            bits_per_sym++;
+        }
+        auto data = TapLoader::LoadTapBlock(p_stream, int((block.totd * bits_per_sym + 7) / 8));
+        size_t bit = 0;
+        for (DWORD n = 0; n < block.totd; n++)
+        {
+            int symbol = 0;
+            for (int b = 0; b < bits_per_sym; b++, bit++)
+            {
+                symbol = symbol << 1 | ((int(data[bit / 8]) >> (7 - bit % 8)) & 1);
+            }
+            AddSymbol(symdefs.at(symbol));
+        }
+    }
+    AddPause(block.pause);
+}
+
+
+
+// Block as saved by the ROM: pilot (shorter for data), sync, data.
+void TapeEdges::AddStandardBlock(const DataBlock &p_block, int p_pause_ms)
+{
+    using namespace spectrum;
+    int pilot_pulses = (!p_block.empty() && int(p_block[0]) < 128) ? header_pilot_pulses : data_pilot_pulses;
+    for (int n = 0; n < pilot_pulses; n++)
+    {
+        AddPulse(tstate_leader);
+    }
+    AddPulse(tstate_sync1);
+    AddPulse(tstate_sync2);
+    AddData(p_block, tstate_zero, tstate_one, 8);
+    AddPause(p_pause_ms);
+}
+
+
+
+// Two pulses per bit, most significant bit first.
+void TapeEdges::AddData(const DataBlock &p_block, int p_zero, int p_one, int p_used_bits_last_byte)
+{
+    for (size_t n = 0; n < p_block.size(); n++)
+    {
+        int bits = n + 1 == p_block.size() ? p_used_bits_last_byte : 8;
+        for (int bit = 0; bit < bits; bit++)
+        {
+            int len = ((int(p_block[n]) << bit) & 0x80) ? p_one : p_zero;
+            AddPulse(len);
+            AddPulse(len);
+        }
+    }
+}
+
+
+
+// Wait given T-states, then an edge (as SpectrumLoader does).
+void TapeEdges::AddPulse(int p_tstates)
+{
+    m_time += p_tstates;
+    AddEdge();
+}
+
+
+
+// As at tzx spec: when high after the last edge stay so for 1ms, then low.
+void TapeEdges::AddPause(int p_ms)
+{
+    if (p_ms > 0 && m_level)
+    {
+        m_time += tstates_per_ms;
+        SetLevel(false);
+        p_ms--;
+    }
+    m_time += double(p_ms) * tstates_per_ms;
+}
+
+
+
+void TapeEdges::SetLevel(bool p_level)
+{
+    if (m_level != p_level)
+    {
+        AddEdge();
+    }
+}
+
+
+
+void TapeEdges::AddEdge()
+{
+    m_edges.push_back(m_time);
+    m_level = !m_level;
+}
@@ -0,0 +1,55 @@
+// ==============================================================================
+// PROJECT:         zqloader
+// FILE:            tapeedges.h
+// DESCRIPTION:     Definition of class TapeEdges
+//
+// Copyright (c) 2026 Daan Scherft [Oxidaan]
+// This project uses the MIT license. See LICENSE.txt for details.
+// ==============================================================================
+
+#pragma once
+
+#include <vector>
+#include <filesystem>
+#include <iosfwd>
+#include "datablock.h"
+
+
+/// Gets the edges (times in T-states, each toggles the EAR level) of a tap or tzx file
+/// exactly as on tape: using the pulse timings at the file (turbo, pure tone, pulse
+/// sequence, generalized and direct recording blocks, loops) so custom loaders can
+/// load it at SpectrumEmulator.
+/// Tap blocks get standard ROM timings.
+/// Not handled (skipped with a warning): CSW recordings, jumps, call sequences, select.
+class TapeEdges
+{
+public:
+
+    /// Load given tap or tzx file; edges are added to the ones already there.
+    TapeEdges& Load(const std::filesystem::path &p_filename);
+
+    /// Edges found so far, in T-states (3.5Mhz as at tzx) ascending.
+    const std::vector<double> &GetEdges() const
+    {
+        return m_edges;
+    }
+
+private:
+
+    void ReadTap(std::istream &p_stream);
+    void ReadTzx(std::istream &p_stream);
+    void ReadGeneralizedDataBlock(std::istream &p_stream);
+
+    void AddStandardBlock(const DataBlock &p_block, int p_pause_ms);
+    void AddData(const DataBlock &p_block, int p_zero, int p_one, int p_used_bits_last_byte);
+    void AddPulse(int p_tstates);
+    void AddPause(int p_ms);
+    void SetLevel(bool p_level);
+    void AddEdge();
+
+private:
+
+    std::vector<double> m_edges;
+    double              m_time  = 0;        // T-states
+    bool                m_level = false;    // EAR level after last edge
+}; // class TapeEdges
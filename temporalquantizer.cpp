@@ -0,0 +1,63 @@
+// ==============================================================================
+// PROJECT:         zqloader
+// FILE:            temporalquantizer.cpp
+// DESCRIPTION:     Implementation of class TemporalQuantizer
+//
+// Copyright (c) 2026 Daan Scherft [Oxidaan]
+// This project uses the MIT license. See LICENSE.txt for details.
+// ==============================================================================
+
+#include "temporalquantizer.h"
+
+using namespace spectrum::screen;
+
+
+namespace
+{
+// Distance of given paper and ink colors to those of given attribute.
+int GetError(Attr p_attr, Rgb p_paper, Rgb p_ink)
+{
+    return ColorDistanceRgb(p_paper, AttrPaperToRgbColor(p_attr)) + ColorDistanceRgb(p_ink, AttrInkToRgbColor(p_attr));
+}
+}   // namespace
+
+
+
+/// Cells (paper, ink) as at ScreenConverter::RunBars.
+const std::vector<Attr>& TemporalQuantizer::Run(const Rgb *p_pixels, int p_width, int p_height, int p_stride,
+                                                const std::vector<Attr> &p_attributes)
+{
+    if (m_shown.size() != p_attributes.size() || p_width != m_width || p_height != m_height || m_threshold <= 0)
+    {
+        m_width  = p_width;
+        m_height = p_height;
+        m_shown = p_attributes;
+        m_carry.assign(p_attributes.size(), 0);
+        return m_shown;
+    }
+    bool vertical = p_height == 2 * SCREEN_HEIGHT / 8;
+    size_t cell   = 0;
+    for (int y = 0; y < p_height; y += vertical ? 2 : 1)
+    {
+        for (int x = 0; x < p_width && cell < m_shown.size(); x += vertical ? 1 : 2, cell++)
+        {
+            auto &shown = m_shown[cell];
+            auto  found = p_attributes[cell];
+            if (shown.byte == found.byte)
+            {
+                m_carry[cell] = 0;
+                continue;
+            }
+            Rgb paper = p_pixels[y * p_stride + x];
+            Rgb ink   = vertical ? p_pixels[(y + 1) * p_stride + x] : p_pixels[y * p_stride + x + 1];
+            int gain  = GetError(shown, paper, ink) - GetError(found, paper, ink);
+            m_carry[cell] = gain > 0 ? m_carry[cell] + gain : 0;
+            if (m_carry[cell] > m_threshold)
+            {
+                shown         = found;
+                m_carry[cell] = 0;
+            }
+        }
+    }
+    return m_shown;
+}
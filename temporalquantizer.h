@@ -0,0 +1,60 @@
+// ==============================================================================
+// PROJECT:         zqloader
+// FILE:            temporalquantizer.h
+// DESCRIPTION:     Definition of class TemporalQuantizer
+//
+// Copyright (c) 2026 Daan Scherft [Oxidaan]
+// This project uses the MIT license. See LICENSE.txt for details.
+// ==============================================================================
+
+#pragma once
+
+#include <vector>
+#include "zqloader.h"           // LIB_API
+#include "spectrum_screen.h"
+#include "color_distance.h"     // Rgb
+
+
+/// Attribute video quantized frame by frame (see ScreenConverter::RunBars) flickers:
+/// a cell with a color about halfway two spectrum colors, or with some noise, changes
+/// almost each frame. Which is visible, and costs bytes to send.
+/// This keeps the attribute as shown for each cell; a cell only changes when the new
+/// attribute is nearer to the image than the shown one by more than a threshold.
+/// The error of keeping the shown attribute is carried over to next frames, so a small
+/// but lasting difference (eg a slow fade) does get through after a few frames.
+class LIB_API TemporalQuantizer
+{
+public:
+
+    static constexpr int default_threshold = 3000;
+
+    /// Set threshold: squared RGB distance, paper plus ink, summed over frames.
+    /// 0 is no hysteresis: each frame as converted.
+    TemporalQuantizer& SetThreshold(int p_threshold)
+    {
+        m_threshold = p_threshold;
+        return *this;
+    }
+
+    /// Forget attributes shown, eg when a new video starts.
+    TemporalQuantizer& Reset()
+    {
+        m_shown.clear();
+        m_carry.clear();
+        return *this;
+    }
+
+    /// Given image (as given to ScreenConverter::RunBars) and the attributes converted
+    /// from it, get attributes to show.
+    /// First frame, or when image size changed: as given.
+    const std::vector<spectrum::screen::Attr>& Run(const Rgb *p_pixels, int p_width, int p_height, int p_stride,
+                                                   const std::vector<spectrum::screen::Attr> &p_attributes);
+
+private:
+
+    int                                 m_threshold = default_threshold;
+    int                                 m_width     = 0;    // of image last given
+    int                                 m_height    = 0;
+    std::vector<spectrum::screen::Attr> m_shown;        // per cell
+    std::vector<int>                    m_carry;        // per cell: error of keeping shown attribute, so far
+}; // class TemporalQuantizer
@@ -0,0 +1,39 @@
+// ==============================================================================
+// PROJECT:         zqloader
+// FILE:            check.h
+// DESCRIPTION:     Minimal checks for the unit tests (test/*.cpp)
+//
+// Copyright (c) 2026 Daan Scherft [Oxidaan]
+// This project uses the MIT license. See LICENSE.txt for details.
+// ==============================================================================
+
+#pragma once
+
+#include <iostream>
+
+
+/// Number of checks failed so far.
+inline int &CheckErrors()
+{
+    static int errors = 0;
+    return errors;
+}
+
+
+/// Check given condition; when false print what was checked.
+inline void Check(bool p_ok, const char *p_what)
+{
+    if (!p_ok)
+    {
+        std::cout << "ERROR: check failed: " << p_what << std::endl;
+        CheckErrors()++;
+    }
+}
+
+
+/// Print result, return value for main: nonzero when any check failed.
+inline int CheckResult()
+{
+    std::cout << (CheckErrors() == 0 ? "OK" : "FAILED") << std::endl;
+    return CheckErrors() == 0 ? 0 : 1;
+}
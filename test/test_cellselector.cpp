@@ -0,0 +1,89 @@
+//==============================================================================
+// PROJECT:         zqloader
+// FILE:            test_cellselector.cpp
+// DESCRIPTION:     Test: CellSelector::Run.
+//
+// Copyright (c) 2026 Daan Scherft [Oxidaan]
+// This project uses the MIT license. See LICENSE.txt for details.
+//==============================================================================
+
+#include "cellselector.h"
+#include "spectrum_screen.h"
+#include "check.h"
+
+using namespace spectrum::screen;
+
+
+/// Screen with all cells given attribute, no pixels set (so all paper).
+static Screen MakeScreen(Attr p_attr)
+{
+    Screen screen;
+    for (int y = 0; y < SCREEN_HEIGHT / 8; y++)
+    {
+        for (int x = 0; x < SCREEN_WIDTH / 8; x++)
+        {
+            screen.SetAttribute(x, y, p_attr);
+        }
+    }
+    return screen;
+}
+
+
+/// Set given number of pixels of cell at given attribute coordinates: first pixel of each line.
+static void SetPixels(Screen &p_screen, int p_attr_x, int p_attr_y, int p_lines)
+{
+    for (int line = 0; line < p_lines; line++)
+    {
+        p_screen.SetPixel(p_attr_x * 8, p_attr_y * 8 + line, true);
+    }
+}
+
+
+int main()
+{
+    Attr white_on_black{};              // paper black, ink white
+    white_on_black.attr.ink   = Attr::Color::white;
+    white_on_black.attr.paper = Attr::Color::black;
+    Attr black_on_black{};
+
+    auto shown = MakeScreen(white_on_black);
+    {
+        auto news = MakeScreen(white_on_black);
+        SetPixels(news, 3, 4, 8);
+        SetPixels(news, 20, 10, 1);
+        auto result = CellSelector(10000, 2).Run(shown.GetDataBlock(), news.GetDataBlock());
+        Check(result == news.GetDataBlock(), "CellSelector: all fits, all taken");
+    }
+    {
+        auto news = MakeScreen(white_on_black);
+        SetPixels(news, 3, 4, 8);             // 8 bytes, each a block of its own: costs 8 * 3
+        SetPixels(news, 20, 10, 1);           // 1 byte: costs 3, but much less visible
+        auto result = CellSelector(24, 2).Run(shown.GetDataBlock(), news.GetDataBlock());
+        auto expect = MakeScreen(white_on_black);
+        SetPixels(expect, 3, 4, 8);
+        Check(result == expect.GetDataBlock(), "CellSelector: budget for one cell takes the most visible");
+    }
+    {
+        auto dark  = MakeScreen(black_on_black);
+        auto news  = MakeScreen(black_on_black);
+        SetPixels(news, 3, 4, 8);             // ink and paper the same: not visible
+        auto result = CellSelector(24, 2).Run(dark.GetDataBlock(), news.GetDataBlock());
+        Check(result == dark.GetDataBlock(), "CellSelector: invisible change is not taken");
+    }
+    {
+        auto news = MakeScreen(white_on_black);
+        for (int x = 0; x < 16; x++)
+        {
+            SetPixels(news, x, 0, 1);         // first line of 16 cells next to each other: 16 bytes in a row
+        }
+        SetPixels(news, 5, 12, 8);            // 8 bytes, 8 blocks
+        auto result = CellSelector(20, 2).Run(shown.GetDataBlock(), news.GetDataBlock());
+        auto expect = MakeScreen(white_on_black);
+        for (int x = 0; x < 16; x++)
+        {
+            SetPixels(expect, x, 0, 1);
+        }
+        Check(result == expect.GetDataBlock(), "CellSelector: run of bytes as one block when it fits the budget");
+    }
+    return CheckResult();
+}
@@ -0,0 +1,81 @@
+//==============================================================================
+// PROJECT:         zqloader
+// FILE:            test_emulate_chained.cpp
+// DESCRIPTION:     Test: chained compressed turbo blocks load at the emulator.
+//
+// Copyright (c) 2026 Daan Scherft [Oxidaan]
+// This project uses the MIT license. See LICENSE.txt for details.
+//==============================================================================
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+#include "zqloader.h"
+
+
+namespace fs = std::filesystem;
+
+
+/// Write a 48K SNA snapshot that compresses well in parts (runs, repeated
+/// patterns) and not at all in others (pseudo random), so it gets several RLE
+/// blocks whose decompression takes long compared to loading them.
+static void WriteTestSnapshot(const fs::path &p_filename)
+{
+    std::vector<uint8_t> header(27, 0);
+    header[19] = 0;                     // IFF2: di
+    header[23] = 0x00;                  // SP = 0xff00
+    header[24] = 0xff;
+    header[25] = 1;                     // IM 1
+    std::vector<uint8_t> ram(48 * 1024);
+    uint32_t random = 12345;
+    for (int n = 0; n < int(ram.size()); n++)
+    {
+        int address = n + 0x4000;
+        random = random * 1103515245 + 12345;
+        ram[n] = address < 0x5800 ? uint8_t((address >> 8) & 0x0f ? 0 : n) :       // screen: mostly 0
+                 address < 0x5b00 ? uint8_t(0x38) :                                 // attributes: one run
+                 address < 0x8000 ? uint8_t(0) :
+                 address < 0xa000 ? uint8_t(random >> 24) :                         // not compressible
+                 address < 0xe000 ? uint8_t((n / 3) & 1 ? 0xff : n & 0x07) :       // short runs and literals
+                                    uint8_t(0xaa);
+    }
+    ram[0xff00 - 0x4000] = 0x00;        // PC at stack = 0x8000
+    ram[0xff01 - 0x4000] = 0x80;
+    std::ofstream file(p_filename, std::ios::binary);
+    file.write(reinterpret_cast<const char *>(header.data()), header.size());
+    file.write(reinterpret_cast<const char *>(ram.data()), ram.size());
+    if (!file)
+    {
+        throw std::runtime_error("Could not write " + p_filename.string());
+    }
+}
+
+
+/// Arguments: path/to/zqloader48.tap path/to/snapshot/to/create.sna
+int main(int argc, char **argv)
+{
+    try
+    {
+        if (argc != 3)
+        {
+            throw std::runtime_error("Usage: test_emulate_chained path/to/zqloader48.tap path/to/test.sna");
+        }
+        WriteTestSnapshot(argv[2]);
+        ZQLoader zqloader;
+        zqloader.SetAction(ZQLoader::Action::emulate).
+                 SetSkipPilots(true).
+                 SetNormalFilename(argv[1]).
+                 SetTurboFilename(argv[2]).
+                 Run();     // throws when memory differs
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << "ERROR: " << e.what() << std::endl;
+        return 1;
+    }
+    std::cout << "OK" << std::endl;
+    return 0;
+}
@@ -0,0 +1,115 @@
+//==============================================================================
+// PROJECT:         zqloader
+// FILE:            test_memoryimage.cpp
+// DESCRIPTION:     Test: MemoryImage::GetChanged and LimitBlocks.
+//
+// Copyright (c) 2026 Daan Scherft [Oxidaan]
+// This project uses the MIT license. See LICENSE.txt for details.
+//==============================================================================
+
+#include <cstddef>
+#include "memoryimage.h"
+#include "memoryblock.h"
+#include "check.h"
+
+
+/// Block of p_size bytes at given address, byte n is n.
+static MemoryBlock MakeBlock(int p_address, int p_size, int p_bank = -1)
+{
+    DataBlock data(size_t(p_size), std::byte{0});
+    for (int n = 0; n < p_size; n++)
+    {
+        data[n] = std::byte(n);
+    }
+    MemoryBlock block;
+    block.m_address   = p_address;
+    block.m_bank      = p_bank;
+    block.m_datablock = std::move(data);
+    return block;
+}
+
+
+/// As given block, with given bytes (offsets) changed.
+static MemoryBlock Change(const MemoryBlock &p_block, std::initializer_list<int> p_offsets)
+{
+    DataBlock data(p_block.m_datablock.begin(), p_block.m_datablock.end());
+    for (int offset : p_offsets)
+    {
+        data[offset] = std::byte(int(data[offset]) ^ 0xff);
+    }
+    MemoryBlock block = p_block;
+    block.m_datablock = std::move(data);
+    return block;
+}
+
+
+static void TestGetChanged()
+{
+    MemoryImage image;
+    MemoryBlocks blocks{ MakeBlock(0x8000, 32) };
+    auto all = image.GetChanged(blocks, 4);
+    Check(all.size() == 1 && all.front().GetStartAddress() == 0x8000 && all.front().size() == 32, "GetChanged: empty image, all changed");
+
+    image.Apply(blocks);
+    Check(image.GetChanged(blocks, 4).empty(), "GetChanged: same as image, nothing changed");
+
+    MemoryBlocks changed{ Change(blocks.front(), { 2, 12, 14 }) };
+    auto parts = image.GetChanged(changed, 4);
+    Check(parts.size() == 2, "GetChanged: gap of 9 > 4 splits");
+    Check(parts.front().GetStartAddress() == 0x8002 && parts.front().size() == 1, "GetChanged: first part only the changed byte");
+    Check(parts.back().GetStartAddress() == 0x800c && parts.back().size() == 3, "GetChanged: gap of 1 <= 4 combined");
+    Check(parts.back().m_datablock[0] == changed.front().m_datablock[12], "GetChanged: part views new data");
+
+    parts = image.GetChanged(changed, 9);
+    Check(parts.size() == 1 && parts.front().GetStartAddress() == 0x8002 && parts.front().size() == 13, "GetChanged: gap of 9 <= 9 combined");
+
+    MemoryBlocks longer{ MakeBlock(0x8000, 40) };
+    parts = image.GetChanged(longer, 4);
+    Check(parts.size() == 1 && parts.front().GetStartAddress() == 0x8020 && parts.front().size() == 8, "GetChanged: unknown memory is changed");
+
+    MemoryBlocks banked{ MakeBlock(0xc000, 16, 3) };
+    image.Apply(banked);
+    parts = image.GetChanged(banked, 4);
+    Check(parts.size() == 1 && parts.front().m_bank == 3 && parts.front().size() == 16, "GetChanged: banked block always all");
+}
+
+
+static void TestLimitBlocks()
+{
+    // 3 blocks of 10 bytes; each block counts 5 extra.
+    MemoryBlocks blocks{ MakeBlock(0x1000, 10), MakeBlock(0x2000, 10), MakeBlock(0x3000, 10) };
+
+    auto taken = LimitBlocks(blocks, 100, 5, 0);
+    Check(taken.size() == 3, "LimitBlocks: all fit");
+
+    taken = LimitBlocks(blocks, 30, 5, 0);
+    Check(taken.size() == 2 && taken.front().GetStartAddress() == 0x1000 && taken.back().GetStartAddress() == 0x2000 &&
+          taken.back().size() == 10, "LimitBlocks: 2 fit exactly");
+
+    taken = LimitBlocks(blocks, 25, 5, 0);
+    Check(taken.size() == 2 && taken.back().size() == 5, "LimitBlocks: last one partial");
+
+    taken = LimitBlocks(blocks, 25, 5, 0x2005);
+    Check(taken.size() == 2 && taken.front().GetStartAddress() == 0x2000 && taken.front().size() == 10 &&
+          taken.back().GetStartAddress() == 0x3000 && taken.back().size() == 5, "LimitBlocks: resumes at block containing address");
+
+    taken = LimitBlocks(blocks, 25, 5, 0x3000 + 10);
+    Check(taken.size() == 2 && taken.front().GetStartAddress() == 0x1000, "LimitBlocks: wraps around after last");
+
+    taken = LimitBlocks(blocks, 30, 5, 0x300a - 1);
+    Check(taken.size() == 2 && taken.front().GetStartAddress() == 0x3000 && taken.back().GetStartAddress() == 0x1000,
+          "LimitBlocks: blocks before resume go last");
+
+    taken = LimitBlocks(blocks, 1, 5, 0);
+    Check(taken.size() == 1 && taken.front().size() == 1, "LimitBlocks: at least one byte");
+
+    Check(LimitBlocks({}, 100, 5, 0).empty(), "LimitBlocks: no blocks");
+}
+
+
+int main()
+{
+    TestGetChanged();
+    TestLimitBlocks();
+    return CheckResult();
+}
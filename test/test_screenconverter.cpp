@@ -0,0 +1,66 @@
+//==============================================================================
+// PROJECT:         zqloader
+// FILE:            test_screenconverter.cpp
+// DESCRIPTION:     Test: ScreenConverter gives the same screen with 1 or N threads.
+//
+// Copyright (c) 2026 Daan Scherft [Oxidaan]
+// This project uses the MIT license. See LICENSE.txt for details.
+//==============================================================================
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "screenconverter.h"
+#include "spectrum_screen.h"
+#include "check.h"
+
+using namespace spectrum::screen;
+
+
+/// Fixed 256x192 image: color gradients with some noise, so dithering diffuses
+/// errors of all sizes and attributes differ per cell.
+static std::vector<Rgb> MakeTestImage()
+{
+    std::vector<Rgb> image(SCREEN_WIDTH * SCREEN_HEIGHT);
+    uint32_t random = 12345;
+    for (int y = 0; y < SCREEN_HEIGHT; y++)
+    {
+        for (int x = 0; x < SCREEN_WIDTH; x++)
+        {
+            random = random * 1103515245 + 12345;
+            int noise = int((random >> 24) & 0x3f) - 32;
+            auto Clamp = [](int p_value)
+            {
+                return p_value < 0 ? 0 : p_value > 255 ? 255 : p_value;
+            };
+            image[y * SCREEN_WIDTH + x] = MakeRgb(Clamp(x + noise), Clamp(y * 4 / 3 + noise), Clamp((x + y) / 2 - noise));
+        }
+    }
+    return image;
+}
+
+
+int main()
+{
+    auto image = MakeTestImage();
+    for (auto dither : { ScreenConverter::Dither::floyd_steinberg, ScreenConverter::Dither::ordered, ScreenConverter::Dither::none })
+    {
+        for (auto method : { ScreenConverter::AttributeMethod::dark_light, ScreenConverter::AttributeMethod::bright_first })
+        {
+            for (bool black_white : { true, false })
+            {
+                ScreenConverter converter;
+                converter.SetDither(dither).SetAttributeMethod(method).SetUseDistanceToBlackWhite(black_white);
+                auto serial = converter.SetThreadCount(1).Run(image.data(), SCREEN_WIDTH);
+                for (int threads : { 2, 3, 8, 64 })
+                {
+                    auto parallel = converter.SetThreadCount(threads).Run(image.data(), SCREEN_WIDTH);
+                    auto what     = "ScreenConverter: dither " + std::to_string(int(dither)) + " attribute method " + std::to_string(int(method)) +
+                                    " black/white " + std::to_string(black_white) + ": " + std::to_string(threads) + " threads same as 1";
+                    Check(parallel.GetDataBlock() == serial.GetDataBlock(), what.c_str());
+                }
+            }
+        }
+    }
+    return CheckResult();
+}
@@ -0,0 +1,87 @@
+//==============================================================================
+// PROJECT:         zqloader
+// FILE:            test_temporalquantizer.cpp
+// DESCRIPTION:     Test: TemporalQuantizer::Run.
+//
+// Copyright (c) 2026 Daan Scherft [Oxidaan]
+// This project uses the MIT license. See LICENSE.txt for details.
+//==============================================================================
+
+#include <vector>
+#include "temporalquantizer.h"
+#include "spectrum_screen.h"
+#include "check.h"
+
+using namespace spectrum::screen;
+
+
+namespace
+{
+constexpr int width  = 64;          // paper left, ink right; as ScreenConverter::RunBars
+constexpr int height = 24;
+constexpr int cells  = width / 2 * height;
+
+Attr MakeAttr(Attr::Color p_paper, Attr::Color p_ink)
+{
+    Attr attr{};
+    attr.attr.paper = p_paper;
+    attr.attr.ink   = p_ink;
+    return attr;
+}
+
+/// Image with the exact colors of given attributes.
+std::vector<Rgb> MakeImage(const std::vector<Attr> &p_attributes)
+{
+    std::vector<Rgb> image(width * height);
+    for (int cell = 0; cell < cells; cell++)
+    {
+        image[2 * cell]     = AttrPaperToRgbColor(p_attributes[cell]);
+        image[2 * cell + 1] = AttrInkToRgbColor(p_attributes[cell]);
+    }
+    return image;
+}
+
+int GetDistance(Attr p_attr1, Attr p_attr2)
+{
+    return ColorDistanceRgb(AttrPaperToRgbColor(p_attr1), AttrPaperToRgbColor(p_attr2)) +
+           ColorDistanceRgb(AttrInkToRgbColor(p_attr1), AttrInkToRgbColor(p_attr2));
+}
+}   // namespace
+
+
+int main()
+{
+    auto a = MakeAttr(Attr::Color::white, Attr::Color::black);
+    auto b = MakeAttr(Attr::Color::yellow, Attr::Color::black);
+    std::vector<Attr> all_a(cells, a);
+    std::vector<Attr> one_b = all_a;
+    one_b[5] = b;
+    auto image_a = MakeImage(all_a);
+    auto image_b = MakeImage(one_b);
+
+    TemporalQuantizer quantizer;
+    quantizer.SetThreshold(GetDistance(a, b) - 1);
+    Check(quantizer.Run(image_a.data(), width, height, width, all_a)[5].byte == a.byte, "TemporalQuantizer: first frame as given");
+    Check(quantizer.Run(image_a.data(), width, height, width, one_b)[5].byte == a.byte, "TemporalQuantizer: image still nearer to shown, keeps shown");
+    Check(quantizer.Run(image_b.data(), width, height, width, one_b)[5].byte == b.byte, "TemporalQuantizer: gain above threshold changes");
+
+    // Gain just below threshold: kept for 2 frames, then the error carried over gets through.
+    quantizer.Reset().SetThreshold(2 * GetDistance(a, b));
+    quantizer.Run(image_a.data(), width, height, width, all_a);
+    Check(quantizer.Run(image_b.data(), width, height, width, one_b)[5].byte == a.byte, "TemporalQuantizer: carry 1 frame, keeps shown");
+    Check(quantizer.Run(image_b.data(), width, height, width, one_b)[5].byte == a.byte, "TemporalQuantizer: carry 2 frames, keeps shown");
+    Check(quantizer.Run(image_b.data(), width, height, width, one_b)[5].byte == b.byte, "TemporalQuantizer: carry 3 frames, changes");
+
+    // Carry is reset when the frame does not ask for a change.
+    quantizer.Reset();
+    quantizer.Run(image_a.data(), width, height, width, all_a);
+    quantizer.Run(image_b.data(), width, height, width, one_b);
+    quantizer.Run(image_b.data(), width, height, width, one_b);
+    quantizer.Run(image_a.data(), width, height, width, all_a);
+    Check(quantizer.Run(image_b.data(), width, height, width, one_b)[5].byte == a.byte, "TemporalQuantizer: carry reset");
+
+    quantizer.Reset().SetThreshold(0);
+    quantizer.Run(image_a.data(), width, height, width, all_a);
+    Check(quantizer.Run(image_a.data(), width, height, width, one_b)[5].byte == b.byte, "TemporalQuantizer: threshold 0, as given");
+    return CheckResult();
+}
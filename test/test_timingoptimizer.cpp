@@ -0,0 +1,42 @@
+//==============================================================================
+// PROJECT:         zqloader
+// FILE:            test_timingoptimizer.cpp
+// DESCRIPTION:     Test: TimingOptimizer::Run is never slower than the defaults.
+//
+// Copyright (c) 2026 Daan Scherft [Oxidaan]
+// This project uses the MIT license. See LICENSE.txt for details.
+//==============================================================================
+
+#include <string>
+#include "timingoptimizer.h"
+#include "check.h"
+
+
+int main()
+{
+    for (uint32_t sample_rate : { 22050u, 32000u, 44100u, 48000u, 96000u })
+    {
+        TimingOptimizer optimizer;
+        optimizer.SetSampleRate(sample_rate);
+        TimingProfile defaults;
+        defaults.m_sample_rate = sample_rate;
+        bool defaults_ok       = optimizer.Check(defaults);
+        auto name              = "TimingOptimizer " + std::to_string(sample_rate) + "hz: ";
+        try
+        {
+            TimingProfile profile = optimizer.Run();
+            auto what             = name + "safe";
+            Check(optimizer.Check(profile), what.c_str());
+            what = name + "bit_loop_max kept at default";
+            Check(profile.m_bit_loop_max == loader_defaults::bit_loop_max, what.c_str());
+            what = name + "not slower than defaults";
+            Check(!defaults_ok || profile.m_byte_duration <= defaults.m_byte_duration, what.c_str());
+        }
+        catch (const std::exception &e)
+        {
+            auto what = name + "no timing found while defaults are safe: " + e.what();
+            Check(!defaults_ok, what.c_str());
+        }
+    }
+    return CheckResult();
+}
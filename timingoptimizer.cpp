@@ -0,0 +1,172 @@
+// ==============================================================================
+// PROJECT:         zqloader
+// FILE:            timingoptimizer.cpp
+// DESCRIPTION:     Implementation of class TimingOptimizer
+//
+// Copyright (c) 2025 Daan Scherft [Oxidaan]
+// This project uses the MIT license. See LICENSE.txt for details.
+// ==============================================================================
+
+#include "timingoptimizer.h"
+#include "turboblock.h"
+#include "turbodemodulator.h"
+#include <random>
+#include <ostream>
+#include <stdexcept>
+#include <array>
+#include <vector>
+
+
+namespace
+{
+constexpr int    max_zero_max = 8;              // highest ZERO_MAX to try
+constexpr size_t random_bytes = 1024;           // test pattern: # random bytes first
+constexpr size_t run_bytes    = 4 * 64;         // then # bytes of runs of same bits
+
+// Test data: (pseudo) random, like compressed data, plus some runs of same bits.
+DataBlock MakePattern()
+{
+    DataBlock retval;
+    std::mt19937 random(1234);
+    for (size_t n = 0; n < random_bytes; n++)
+    {
+        retval.push_back(std::byte(random() & 0xff));
+    }
+    for (auto value : { 0x00_byte, 0xff_byte, 0x55_byte, 0xaa_byte })
+    {
+        retval.insert(retval.end(), run_bytes / 4, value);
+    }
+    return retval;
+}
+
+// Average T-states of a byte of the random part of the test pattern, from the edges as rendered.
+// So including sample quantization and end of byte delay exactly as SampleSender sends it.
+// The pattern is sent last, one edge per bit. The first byte (no end of byte delay) is skipped.
+double GetByteDuration(const std::vector<double> &p_edges)
+{
+    constexpr size_t bytes = random_bytes - 1;
+    if (p_edges.size() <= (random_bytes + run_bytes) * 8)
+    {
+        return 0;
+    }
+    auto last = p_edges.end() - run_bytes * 8 - 1;     // last edge of random part
+    return (*last - *(last - bytes * 8)) / bytes;
+}
+}
+
+
+
+/// Writes as command line options, eg: zero_tstates=91 one_tstates=231 ...
+std::ostream& operator << (std::ostream& p_stream, const TimingProfile& p_profile)
+{
+    p_stream << "zero_tstates="       << p_profile.m_zero_duration
+             << " one_tstates="       << p_profile.m_one_duration
+             << " end_of_byte_delay=" << p_profile.m_end_of_byte_delay
+             << " zero_max="          << p_profile.m_zero_max
+             << " bit_loop_max="      << p_profile.m_bit_loop_max
+             << " samplerate="        << p_profile.m_sample_rate;
+    return p_stream;
+}
+
+
+
+/// Do the search. Throws when no safe timing was found.
+/// Candidates are the defaults, and for each zero_max and each number of samples for a zero and a one:
+/// a duration halfway a sample period and the shortest one giving that number of samples.
+/// (the latter can make the longer first pulse of a byte, with end of byte delay, a sample shorter).
+/// For each zero candidate the shortest safe one is taken; longer ones can not be faster.
+/// bit_loop_max does not influence speed so is kept at its default.
+TimingProfile TimingOptimizer::Run() const
+{
+    if (m_sample_rate == 0)
+    {
+        throw std::runtime_error("TimingOptimizer: sample rate must be given");
+    }
+    const double period = double(m_spectrum_clock) / m_sample_rate;     // T-states per sample
+    auto make_profile = [&](int p_zero_max, int p_zero_duration, int p_one_duration)
+    {
+        TimingProfile profile;
+        profile.m_sample_rate       = m_sample_rate;
+        profile.m_spectrum_clock    = m_spectrum_clock;
+        profile.m_end_of_byte_delay = m_end_of_byte_delay;
+        profile.m_zero_max          = p_zero_max;
+        profile.m_zero_duration     = p_zero_duration;
+        profile.m_one_duration      = p_one_duration;
+        return profile;
+    };
+    // T-state durations that give given number of samples.
+    auto get_candidates = [&](int p_samples)
+    {
+        return std::array<int, 2>{ int((p_samples - 0.5) * period), int((p_samples - 1) * period) + 1 };
+    };
+
+    TimingProfile best = make_profile(loader_defaults::zero_max, loader_defaults::zero_duration, loader_defaults::one_duration);
+    bool found = Check(best);
+    for (int zero_max = 1; zero_max <= max_zero_max; zero_max++)
+    {
+        // A zero must be seen (worst case, delayed one IN loop) at last IN giving a zero.
+        // A one longer than that plus margin plus quantization will not be better.
+        const double zero_limit = loader_tstates::bit_loop_duration + zero_max * loader_tstates::wait_for_edge_loop_duration;
+        const double one_limit  = zero_limit + m_safety_margin + 2 * period + loader_tstates::wait_for_edge_loop_duration;
+        for (int zero_samples = 1; zero_samples * period <= zero_limit; zero_samples++)
+        {
+            for (int zero_duration : get_candidates(zero_samples))
+            {
+                bool safe = false;
+                for (int one_samples = zero_samples + 1; !safe && one_samples * period <= one_limit; one_samples++)
+                {
+                    for (int one_duration : get_candidates(one_samples))
+                    {
+                        TimingProfile profile = make_profile(zero_max, zero_duration, one_duration);
+                        if (Check(profile))
+                        {
+                            safe = true;
+                            if (!found || profile.m_byte_duration < best.m_byte_duration)
+                            {
+                                best  = profile;
+                                found = true;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+    if (!found)
+    {
+        throw std::runtime_error("TimingOptimizer: no safe timing found for sample rate " + std::to_string(m_sample_rate) +
+                                 " and safety margin " + std::to_string(m_safety_margin));
+    }
+    return best;
+}
+
+
+
+/// Check given profile with the Z80 loader model, rendered at the sample rate.
+/// Fills in smallest margin and byte duration.
+/// False when a bit failed or margin too small.
+bool TimingOptimizer::Check(TimingProfile &p_profile) const
+{
+    static const DataBlock pattern = MakePattern();
+
+    TurboDemodulator demodulator;
+    demodulator.SetSampleRate(m_sample_rate).
+                SetSpectrumClock(m_spectrum_clock).
+                SetZeroMax(p_profile.m_zero_max).
+                SetBitLoopMax(p_profile.m_bit_loop_max);
+    TurboBlock block;
+    block.SetLoadAddress(spectrum::RAM_START).SetData(pattern, CompressionType::none);
+    std::move(block).MoveToLoader(demodulator, 0ms, p_profile.m_zero_duration, p_profile.m_one_duration, p_profile.m_end_of_byte_delay);
+    demodulator.Run();
+
+    p_profile.m_margin        = demodulator.GetSmallestMargin();
+    p_profile.m_byte_duration = GetByteDuration(demodulator.GetEdges());
+    if (demodulator.GetBlocks().size() != 1)
+    {
+        return false;
+    }
+    const auto &block_found = demodulator.GetBlocks().front();
+    return block_found.IsOk() &&
+           block_found.m_data.size() == pattern.size() + TurboBlock::GetHeaderSize() &&
+           p_profile.m_margin >= m_safety_margin;
+}
@@ -0,0 +1,97 @@
+// ==============================================================================
+// PROJECT:         zqloader
+// FILE:            timingoptimizer.h
+// DESCRIPTION:     Definition of class TimingOptimizer
+//
+// Copyright (c) 2025 Daan Scherft [Oxidaan]
+// This project uses the MIT license. See LICENSE.txt for details.
+// ==============================================================================
+
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>           // std::ostream
+#include "types.h"
+#include "spectrum_consts.h"
+#include "loader_defaults.h"
+
+
+/// A set of zqloader timing parameters as found by TimingOptimizer.
+struct TimingProfile
+{
+    int        m_zero_duration     = loader_defaults::zero_duration;      // T-states (zero_tstates)
+    int        m_one_duration      = loader_defaults::one_duration;       // T-states (one_tstates)
+    int        m_end_of_byte_delay = loader_defaults::end_of_byte_delay;  // T-states
+    int        m_zero_max          = loader_defaults::zero_max;
+    int        m_bit_loop_max      = loader_defaults::bit_loop_max;
+    uint32_t   m_sample_rate       = 0;
+    int        m_spectrum_clock    = spectrum::spectrum_clock;
+    double     m_margin            = 0;                                   // smallest margin seen (T-states)
+    double     m_byte_duration     = 0;                                   // average T-states for a (random) byte, as sent
+
+    /// Average speed in bits per second
+    double GetBitsPerSecond() const
+    {
+        return m_byte_duration ? 8.0 * m_spectrum_clock / m_byte_duration : 0.0;
+    }
+
+    /// Writes as command line options, eg: zero_tstates=91 one_tstates=231 ...
+    friend std::ostream& operator << (std::ostream& p_stream, const TimingProfile& p_profile);
+};
+
+
+
+/// Searches the fastest zqloader timing parameters (zero/one durations, zero_max)
+/// that still decode every bit with at least a given safety margin at a given
+/// sample rate and spectrum clock.
+/// Each candidate is rendered to edges quantized at the sample rate (as SampleSender does)
+/// then checked with the Z80 loader model at TurboDemodulator; its speed is measured
+/// at these same edges. The defaults are a candidate too, so the result is never slower
+/// than these when they are safe.
+class TimingOptimizer
+{
+public:
+
+    /// Set sample rate to optimize for (hz). Must not be 0.
+    TimingOptimizer& SetSampleRate(uint32_t p_sample_rate)
+    {
+        m_sample_rate = p_sample_rate;
+        return *this;
+    }
+
+    /// Set clock frequency in hz.
+    TimingOptimizer& SetSpectrumClock(int p_spectrum_clock)
+    {
+        m_spectrum_clock = p_spectrum_clock;
+        return *this;
+    }
+
+    /// Minimal margin (T-states) each edge must be away from a wrong decision (or timeout).
+    TimingOptimizer& SetSafetyMargin(int p_margin)
+    {
+        m_safety_margin = p_margin;
+        return *this;
+    }
+
+    /// Extra delay after each byte (host side), keep default normally.
+    TimingOptimizer& SetEndOfByteDelay(int p_end_of_byte_delay)
+    {
+        m_end_of_byte_delay = p_end_of_byte_delay;
+        return *this;
+    }
+
+    /// Do the search. Throws when no safe timing was found.
+    TimingProfile Run() const;
+
+    /// Check given profile with the Z80 loader model at sample rate and clock set here.
+    /// Fills in smallest margin and byte duration.
+    /// False when a bit failed or margin too small.
+    bool Check(TimingProfile &p_profile) const;
+
+private:
+
+    uint32_t   m_sample_rate        = 48000;
+    int        m_spectrum_clock     = spectrum::spectrum_clock;
+    int        m_safety_margin      = loader_defaults::timing_safety_margin;
+    int        m_end_of_byte_delay  = loader_defaults::end_of_byte_delay;
+};
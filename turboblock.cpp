@@ -9,6 +9,7 @@
 
 #include "turboblock.h"
 #include "spectrum_screen.h"
+#include <algorithm>         // std::max
 
 TurboBlock::TurboBlock()
 {
@@ -23,6 +24,32 @@ TurboBlock::TurboBlock()
 }
 
 
+/// Reconstruct a TurboBlock from data as received by zqloader.z80asm,
+/// so the header followed by the (still compressed) payload.
+TurboBlock::TurboBlock(DataBlock p_received) :
+    m_data(std::move(p_received))
+{
+    if (m_data.size() < sizeof(Header))
+    {
+        throw std::runtime_error("Received data too small to contain a header: " + std::to_string(m_data.size()));
+    }
+    m_data_size = m_data.size() - sizeof(Header);
+    if (GetHeader().m_compression_type == CompressionType::rle && IsChecksumOk())
+    {
+        Compressor<DataBlock>::RLE_Meta rle_meta{};
+        rle_meta.code_for_most      = std::byte(GetHeader().m_code_for_most);
+        rle_meta.code_for_multiples = std::byte(GetHeader().m_code_for_multiples);
+        rle_meta.value_for_most     = std::byte(GetHeader().m_value_for_most);
+#ifdef DO_COMRESS_PAIRS
+        rle_meta.code_for_pairs     = std::byte(GetHeader().m_code_for_pairs);
+        rle_meta.value_for_pairs    = std::byte(GetHeader().m_value_for_pairs);
+#endif
+        DataBlock payload(m_data.begin() + sizeof(Header), m_data.end());
+        m_data_size = Compressor<DataBlock>::DeCompress(payload, rle_meta).size();
+    }
+}
+
+
 /// Set given data as payload at this TurboBlock. Try to compress.
 /// At header sets:
 /// m_length,
@@ -74,6 +101,7 @@ TurboBlock& TurboBlock::SetData(const DataBlock& p_data, CompressionType p_compr
 //    if(data->size() > spectrum::SCREEN_SIZE)        // @DEBUG cause crc error
 //        GetHeader().m_checksum++;
     // GetHeader().m_length = uint16_t(compressed_data.size() + 2);       // @DEBUG should give ERROR
+    m_data.reserve(sizeof(Header) + data->size());
     m_data.insert(m_data.end(), data->begin(), data->end());          // append given data at m_data (after header)
 
 
@@ -100,12 +128,83 @@ std::chrono::milliseconds TurboBlock::EstimateHowLongSpectrumWillTakeToDecompres
     }
     if (GetHeader().m_compression_type == CompressionType::rle)
     {
-        return 10ms + 1ms * ((m_data_size * 1000) / (1024 * p_decompression_speed));
+        auto at_speed = (m_data_size * 1000) / (1024 * p_decompression_speed);
+        auto actual   = (GetDeCompressionTstates() * 1000 + spectrum::spectrum_clock - 1) / spectrum::spectrum_clock;     // round up
+        return 10ms + 1ms * std::max<uint64_t>(at_speed, actual);
     }
     // Uses ldir
     return 10ms + 1ms * ((m_data_size * 1000) / (1024 * loader_tstates::ldir_speed));
 }
 
+uint64_t TurboBlock::GetDeCompressionTstates() const
+{
+    using namespace loader_tstates;
+    const auto &header = GetHeader();
+    auto it            = m_data.begin() + sizeof(Header);
+    auto end           = m_data.end();
+    auto Read          = [&]()
+    {
+        return it < end ? uint8_t(*it++) : uint8_t(0);
+    };
+    auto RunLength     = [&](uint8_t p_count)
+    {
+        return decompress_run_byte * (p_count == 0 ? 256 : p_count);     // djnz
+    };
+    uint64_t retval = 0;
+    uint64_t codes  = 0;
+    while (it < end)
+    {
+        auto code = Read();
+        codes++;
+        if (code == header.m_code_for_most)
+        {
+            if (it < end && uint8_t(*it) == header.m_code_for_most)
+            {
+                it++;
+                retval += decompress_escape;
+            }
+            else
+            {
+                retval += decompress_most + RunLength(Read());
+            }
+        }
+        else if (code == header.m_code_for_multiples)
+        {
+            if (it < end && uint8_t(*it) == header.m_code_for_multiples)
+            {
+                it++;
+                retval += decompress_escape;
+            }
+            else
+            {
+                Read();     // value
+                retval += decompress_multiples + RunLength(Read());
+            }
+        }
+#ifdef DO_COMRESS_PAIRS
+        else if (code == header.m_code_for_pairs)
+        {
+            if (it < end && uint8_t(*it) == header.m_code_for_pairs)
+            {
+                it++;
+                retval += decompress_escape;
+            }
+            else
+            {
+                retval += decompress_pairs;
+            }
+        }
+#endif
+        else
+        {
+            retval += decompress_byte;
+        }
+    }
+    return retval + decompress_counter_msb * (codes / 256 + 1);
+}
+
+
+
 TurboBlock& TurboBlock::DebugDump(int p_max) const
 {
     if(m_skip_pilot)
@@ -248,6 +347,15 @@ inline DataBlock TurboBlock::TryCompress(const DataBlock& p_data, CompressionTyp
     return p_data.Clone();       // done
 }
 
+/// Does the checksum stored at header match the payload?
+/// (Same check as zqloader.z80asm does)
+bool TurboBlock::IsChecksumOk() const
+{
+    DataBlock payload(m_data.begin() + sizeof(Header), m_data.end());
+    return CalculateChecksum(payload) == GetHeader().m_checksum;
+}
+
+
 // Calculate a simple one-byte checksum over given data.
 // including header and the length fields.
 inline uint8_t TurboBlock::CalculateChecksum(const DataBlock& p_data)
@@ -93,6 +93,11 @@ public:
 
     TurboBlock();
 
+    /// Reconstruct a TurboBlock from data as received by zqloader.z80asm,
+    /// so the header followed by the (still compressed) payload.
+    /// Eg used by TurboDemodulator.
+    explicit TurboBlock(DataBlock p_received);
+
     /// Set given data as payload at this TurboBlock. Try to compress.
     /// At header sets:
     /// m_length,
@@ -176,6 +181,19 @@ public:
     }
 
 
+    /// Leader before each block.
+    static constexpr std::chrono::milliseconds leader_duration = 200ms;
+
+    /// # of (500, 500) leader patterns used instead when pilot is skipped: a short resync.
+    /// 128 patterns: 256 edges, about 36ms at 3.5Mhz.
+    /// Must be more than LEADER_MIN_EDGES; the margin (56 edges, about 8ms) covers the loader
+    /// starting to listen a bit late (eg decompression took a bit longer than estimated).
+    /// The Z80 loader is unchanged for this: it relies on LEADER_MIN_EDGES being 200 at
+    /// zqloader.z80asm, same as loader_tstates::leader_min_edges.
+    static constexpr unsigned resync_patterns = (loader_tstates::leader_min_edges + 56) / 2;
+
+    /// When set only a short resync (see resync_patterns) instead of full leader.
+    /// For blocks directly following another block, eg a chain.
     TurboBlock& SetSkipPilot(bool p_to_what)
     {
         m_skip_pilot = p_to_what;
@@ -186,14 +204,25 @@ public:
     {
         return GetHeader().m_after_block;
     }
+
+    /// Get length of payload as send (so compressed) as stored at header.
+    uint16_t GetLength() const
+    {
+        return GetHeader().m_length;
+    }
+
+    /// Does the checksum stored at header match the payload?
+    /// (Same check as zqloader.z80asm does)
+    bool IsChecksumOk() const;
     
     /// Move this TurboBlock (as pulsers) to given loader (eg SpectrumLoader).
     /// Give it leader+sync as used by zqloader.z80asm.
     /// Move all to given loader eg SpectrumLoader.
     /// p_pause_before this is important when ZX Spectrum needs some time to decompress.
     /// Give this an estimate how long it takes to handle previous block.
+    /// The data is moved (not copied) to the pulsers; header and payload share it.
     template<class TLoader>
-    void MoveToLoader(TLoader& p_loader, std::chrono::milliseconds p_pause_before, int p_zero_duration, int p_one_duration, int p_end_of_byte_delay)
+    void MoveToLoader(TLoader& p_loader, std::chrono::milliseconds p_pause_before, int p_zero_duration, int p_one_duration, int p_end_of_byte_delay) &&
     {
         Check();
 
@@ -201,13 +230,24 @@ public:
         {
             PausePulser(p_loader.GetTstateDuration()).SetLength(p_pause_before).MoveToLoader(p_loader);           // pause before
         }
-        TonePulser(p_loader.GetTstateDuration()).SetPattern(500, 500).SetLength(m_skip_pilot ? 20ms : 200ms).MoveToLoader(p_loader);    // leader; best to have even number of edges
+        TonePulser leader(p_loader.GetTstateDuration());
+        leader.SetPattern(500, 500);                                                                                // leader; best to have even number of edges
+        if (m_skip_pilot)
+        {
+            leader.SetLength(resync_patterns);
+        }
+        else
+        {
+            leader.SetLength(leader_duration);
+        }
+        leader.MoveToLoader(p_loader);
         TonePulser(p_loader.GetTstateDuration()).SetPattern(250, 499).SetLength(1).MoveToLoader(p_loader);        // sync + 499=minisync!
 
 
 
-        DataBlock header(m_data.begin(), m_data.begin() + sizeof(Header));      // split (eg for minisync)
-        DataBlock payload(m_data.begin() + sizeof(Header), m_data.end());
+        DataBlockView data(std::move(m_data));
+        DataBlockView header(data, 0, sizeof(Header));                          // split (eg for minisync)
+        DataBlockView payload(data, sizeof(Header), data.size() - sizeof(Header));
 
         MoveToLoader(p_loader, std::move(header), p_zero_duration, p_one_duration, p_end_of_byte_delay);     // header
         if (payload.size() != 0)
@@ -222,6 +262,8 @@ public:
 
    // After loading a compressed block ZX spectrum needs some time to
    // decompress before it can accept next block. Will wait this long after sending block.
+   // Never shorter than DECOMPRESS takes for this data (see GetDeCompressionTstates),
+   // a lower p_decompression_speed makes it longer.
     std::chrono::milliseconds EstimateHowLongSpectrumWillTakeToDecompress(int p_decompression_speed) const;
 
 
@@ -236,6 +278,11 @@ private:
     static uint16_t Adjust16bitCounterForUseWithDjnz(uint16_t p_counter);
 
 
+    // T-states DECOMPRESS (zqloader.z80asm) takes for the payload, following the
+    // same path per code as the Z80 does. Without contention.
+    uint64_t GetDeCompressionTstates() const;
+
+
     // Get (final) destination address
     uint16_t GetDestAddress() const
     {
@@ -248,7 +295,7 @@ private:
     //  Move given DataBlock (as pulsers) to loader (eg SpectrumLoader)
     //  PausePulser(minisync) + DataPulser
     template<class TLoader>
-    void MoveToLoader(TLoader& p_loader, DataBlock p_block, int p_zero_duration, int p_one_duration, int p_end_of_byte_delay)
+    static void MoveToLoader(TLoader& p_loader, DataBlockView p_block, int p_zero_duration, int p_one_duration, int p_end_of_byte_delay)
     {
         // already done! PausePulser(p_loader.GetTstateDuration()).SetLength(500).SetEdge(Edge::toggle).MoveToLoader(p_loader); // extra minisync before
 
@@ -293,7 +340,7 @@ private:
 private:
 
     size_t      m_data_size{};               // size of (uncompressed/final) data exl. header. Note: Spectrum does not need this.
-    bool        m_skip_pilot = false;        // has (long or short) pilot tone + sync
+    bool        m_skip_pilot = false;        // has short resync instead of full pilot tone (+ sync)
     DataBlock   m_data;                      // the data as send to Spectrum, starts with header
 }; // class TurboBlock
 
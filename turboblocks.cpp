@@ -12,6 +12,10 @@
 #include "turboblocks.h"
 #include "taploader.h"
 #include "memoryblock.h"
+#include "loaderplanner.h"
+#include "blockplanner.h"
+#include "memoryimage.h"
+#include "cellselector.h"
 #include "loader_defaults.h"
 #include "spectrum_consts.h"        // SCREEN_END
 #include "spectrum_types.h"         // ZxBlockType
@@ -78,13 +82,23 @@ public:
         return m_zqloader_code.size() != 0;
     }
 
+    /// ZQLoader is already resident at the ZX Spectrum: only load symbols.
+    void SetZqLoaderResident(const std::filesystem::path& p_filename)
+    {
+        std::cout << "ZQLoader is resident, not sending: " << p_filename << std::endl;
+        fs::path filename_exp = p_filename;
+        filename_exp.replace_extension("exp");
+        LoadSymbolFilename(filename_exp);
+        m_is_resident = true;
+    }
+
 
     // Get location to copy loader to.
     // If not set before:
     //  If any block overlaps the loader at basic, set
     //  return spectrum::SCREEN_23RD as location to copy loader to.
     //  If no block overlaps return 0.
-    // Else get whatever was set before (snapshots do this)
+    // Else get whatever was set before (snapshots do this, found with LoaderPlanner)
     uint16_t GetLoaderCopyStart(const MemoryBlocks & p_memory_blocks) const
     {
         if (m_loader_copy_start == 0)
@@ -107,6 +121,20 @@ public:
         return m_loader_copy_start;
     }
 
+
+    // LoaderPlanner with loader length and regions the loader uses:
+    // system variables, BASIC and loader at BASIC up to CLEAR, and loader at upper memory.
+    LoaderPlanner GetLoaderPlanner(bool p_with_registers) const
+    {
+        int upper_start = m_symbols.GetSymbol("ASM_UPPER_START");
+        LoaderPlanner planner;
+        planner.SetLength(GetLoaderCodeLength(p_with_registers)).
+                AddReserved(spectrum::SCREEN_START + spectrum::screen::SCREEN_SIZE, m_symbols.GetSymbol("CLEAR")).
+                AddReserved(upper_start, upper_start + m_symbols.GetSymbol("ASM_UPPER_LEN")).
+                SetPreferred(spectrum::screen::SCREEN_23RD);
+        return planner;
+    }
+
     // Check if any block overwrites our loader copied loader code (after copy)
     // cut it in two pieces before and after thus leaving space,
     // ignoring the middle part (must be screen or emtpy snapshot region)
@@ -181,6 +209,148 @@ public:
     }
     
 
+    // Delta: only the parts of given blocks that differ from m_delta_base.
+    // When nothing changed keep a single byte: still need a block to end with (eg start USR).
+    MemoryBlocks GetChangedBlocks(MemoryBlocks p_memory_blocks) const
+    {
+        auto changed = m_delta_base.GetChanged(p_memory_blocks, GetDeltaMaxGap());
+        size_t total = 0;
+        size_t sent  = 0;
+        for (const auto& block : p_memory_blocks)
+        {
+            total += block.size();
+        }
+        for (const auto& block : changed)
+        {
+            sent += block.size();
+        }
+        std::cout << "Delta: sending " << sent << " of " << total << " bytes in " << changed.size() << " block(s)" << std::endl;
+        if (changed.empty())
+        {
+            auto first = p_memory_blocks.front();
+            changed.push_back(std::get<0>(SplitBlock(first, first.GetStartAddress() + 1)));
+        }
+        return changed;
+    }
+
+    // Video: add given frame (eg all attributes) as turbo blocks, but only the runs
+    // that changed since the previous frame added here, scattered to their address by
+    // the loader. Runs less than GetFrameMaxGap apart are merged into one block: sending
+    // the unchanged bytes between them is faster than an extra block, so a frame
+    // typically becomes one or a few blocks. Blocks of a frame, and frames, are chained.
+    // All of it when first, or when that is faster (eg scene cut).
+    // When nothing changed keep a single byte: still need a block to go on.
+    // p_max_duration: when not 0, send no more than fits in about that time; the rest
+    // stays changed, so is send with next frame(s). Continues where it stopped, so
+    // all parts of the frame get their turn.
+    void AddFrameAsTurboBlocks(MemoryBlock p_frame, uint16_t p_load_address, std::chrono::milliseconds p_max_duration)
+    {
+        MemoryBlocks frame;
+        auto max_gap  = GetFrameMaxGap();
+        int  max_size = p_max_duration > 0ms ? GetFrameMaxSize(p_max_duration) : 0;
+        // Full screen, not all might fit: the cells that matter most, see CellSelector.
+        // Until all of the screen was send once: round robin as other frames.
+        bool is_cells = max_size > 0 && p_frame.m_bank < 0 &&
+                        p_frame.GetStartAddress() == spectrum::SCREEN_START && p_frame.size() == spectrum::screen::SCREEN_SIZE &&
+                        m_frame_image.IsKnown(spectrum::SCREEN_START, spectrum::screen::SCREEN_SIZE);
+        if (is_cells)
+        {
+            auto shown = m_frame_image.Get(spectrum::SCREEN_START, spectrum::screen::SCREEN_SIZE);
+            p_frame.m_datablock = CellSelector(max_size, max_gap).Run(shown, std::move(p_frame.m_datablock).Release());
+        }
+        frame.push_back(std::move(p_frame));
+        auto blocks  = m_frame_image.GetChanged(frame, max_gap);     // all when image empty
+        m_is_frame_chained = !m_frame_image.IsEmpty();
+        if (m_is_frame_chained)
+        {
+            size_t sent = 0;
+            for (const auto& block : blocks)
+            {
+                sent += block.size() + max_gap;
+            }
+            if (sent >= frame.front().size() + max_gap)
+            {
+                blocks = frame;                 // scene cut
+            }
+        }
+        if (max_size > 0 && !is_cells)
+        {
+            blocks = LimitBlocks(std::move(blocks), max_size, max_gap, m_frame_resume_address);
+            if (!blocks.empty())
+            {
+                m_frame_resume_address = blocks.back().GetEndAddress();
+            }
+        }
+        if (blocks.empty())
+        {
+            auto first = frame.front();
+            blocks.push_back(std::get<0>(SplitBlock(first, first.GetStartAddress() + 1)));
+        }
+        m_frame_image.Apply(blocks);           // only what is send
+        for (auto& block : blocks)
+        {
+            AddMemoryBlockAsTurboBlock(std::move(block), p_load_address);
+        }
+        m_is_frame = true;
+    }
+
+    // Frames: # bytes that can be send in given time.
+    int GetFrameMaxSize(std::chrono::milliseconds p_duration) const
+    {
+        double byte_tstates = 4.0 * (m_zero_duration + m_one_duration) + m_end_of_byte_delay;
+        return std::max(1, int(std::chrono::duration<double>(p_duration).count() * spectrum::spectrum_clock / byte_tstates));
+    }
+
+    // Frames: # unchanged bytes that take about as long as an extra chained block:
+    // its resync, header and pause after it, so are better send along.
+    int GetFrameMaxGap() const
+    {
+        double byte_tstates  = 4.0 * (m_zero_duration + m_one_duration) + m_end_of_byte_delay;
+        double block_tstates = TurboBlock::resync_patterns * 1000.0 +
+                               0.010 * spectrum::spectrum_clock;       // pause, see EstimateHowLongSpectrumWillTakeToDecompress
+        return int(block_tstates / byte_tstates) + int(TurboBlock::GetHeaderSize());
+    }
+
+
+    // Delta: # unchanged bytes that take about as long as the leader and header
+    // of an extra block, so are better send along.
+    int GetDeltaMaxGap() const
+    {
+        double byte_tstates   = 4.0 * (m_zero_duration + m_one_duration) + m_end_of_byte_delay;
+        double leader_tstates = m_skip_pilots ? TurboBlock::resync_patterns * 1000.0 :
+                                                std::chrono::duration<double>(TurboBlock::leader_duration).count() * spectrum::spectrum_clock;
+        return int(leader_tstates / byte_tstates) + int(TurboBlock::GetHeaderSize());
+    }
+
+
+    // Split blocks further where that lowers predicted load time, see BlockPlanner.
+    // First block is left alone: loader gets copied after it.
+    // Last block is left alone: it overwrites loader at upper and has its own load address.
+    MemoryBlocks PlanBlocks(MemoryBlocks p_memory_blocks) const
+    {
+        if (p_memory_blocks.size() <= 2)
+        {
+            return p_memory_blocks;
+        }
+        BlockPlanner planner;
+        planner.SetDurations(m_zero_duration, m_one_duration, m_end_of_byte_delay).
+                SetDeCompressionSpeed(m_decompression_speed).
+                SetCompressionType(m_compression_type).
+                SetSkipPilots(m_skip_pilots);
+        MemoryBlocks new_blocks;
+        new_blocks.push_back(std::move(p_memory_blocks.front()));
+        p_memory_blocks.pop_front();
+        MemoryBlock last = std::move(p_memory_blocks.back());
+        p_memory_blocks.pop_back();
+        for (auto& block : p_memory_blocks)
+        {
+            new_blocks.splice(new_blocks.end(), planner.Run(std::move(block)));
+        }
+        new_blocks.push_back(std::move(last));
+        return new_blocks;
+    }
+
+
     /// p_usr_address: when done loading all blocks end start machine code here as in RANDOMIZE USR xxxx
     /// p_clear_address: when done loading put stack pointer here, which is a bit like CLEAR xxxx
     /// To be called after last block was added.
@@ -203,6 +373,10 @@ public:
         // Combine adjacent blocks, combine overlapping blocks; order from low to high
         auto memory_blocks = Compact(std::move(m_memory_blocks));
         DONT_USE(m_memory_blocks);
+        if (m_is_delta)
+        {
+            memory_blocks = GetChangedBlocks(std::move(memory_blocks));
+        }
         {
             const MemoryBlock& first = memory_blocks.front();
             // First block includes screen but is bigger than that.
@@ -224,17 +398,28 @@ public:
 
 
         // Make space for new loader location
-        // skip when at screen 2/3rd - not need then and is actually slower. Also screen is loaded earlier.
-        if (loader_copy_start && loader_copy_start != spectrum::screen::SCREEN_23RD )
+        // skip when at screen - not need then and is actually slower. Also screen is loaded earlier.
+        if (loader_copy_start && LoaderPlanner::NeedsSplit(loader_copy_start, GetLoaderCodeLength(false)))
         {
             memory_blocks = MakeSpaceForCopiedLoader(std::move(memory_blocks), loader_copy_start);
         }
 
         memory_blocks = MakeSpaceForUpperLoader(std::move(memory_blocks));
 
+        memory_blocks = PlanBlocks(std::move(memory_blocks));
 
 
-        MemoryBlocksToTurboBlocks(std::move(memory_blocks), loader_copy_start, p_usr_address, p_clear_address, p_last_bank_to_set);
+        // Loader at BASIC not moved away and no last block overwriting loader at upper?
+        bool is_intact = loader_copy_start == 0 && memory_blocks.back().size() == 0;
+        if (m_stay_in_loader && !is_intact)
+        {
+            std::cout << "<b>Warning: Can not stay in loader when done, it gets overwritten.</b>" << std::endl;
+        }
+        m_is_intact  = is_intact;
+        m_is_staying = m_stay_in_loader && is_intact;
+        m_is_kept    = is_intact && (m_is_staying || p_usr_address == 0);
+
+        MemoryBlocksToTurboBlocks(std::move(memory_blocks), loader_copy_start, p_usr_address, p_clear_address, p_last_bank_to_set, m_is_staying);
 
 
 
@@ -291,7 +476,9 @@ public:
     /// Move all earlier added turboblocks to given SpectrumLoader.
     /// Call after Finalize.
     /// p_is_fun_attribute originally used for scrolling attribute text, but more general
-    /// for a continues stream of (small) blocks. (can skip pilot, dont log)
+    /// for a continues stream of (small) blocks. (dont log)
+    /// When skip pilots set (chain), all blocks but the first get a short resync instead of full pilot.
+    /// Frames (see AddFrameAsTurboBlocks) are always chained, also to the previous frame.
     /// no-op when there are no blocks.
     /// p_load_address: when given (!=0) load there first.
     void MoveToLoader(SpectrumLoader& p_spectrumloader, bool p_is_fun_attribute, uint16_t p_load_address = 0)
@@ -312,12 +499,27 @@ public:
 
 
 
+        // Frame following previous frame: continue its chain, after the pause its last block needs.
+        // Anything else might overwrite what frames left: next frame all.
+        bool is_chained = m_is_frame && m_is_frame_chained;
+        if (!m_is_frame && !m_turbo_blocks.empty())
+        {
+            m_frame_image.Clear();
+        }
+        if (is_chained)
+        {
+            pause_before = m_frame_pause;
+        }
+
         int cnt = 1;
        
         for (auto& tblock : m_turbo_blocks)
         {
             auto next_pause = tblock.EstimateHowLongSpectrumWillTakeToDecompress(m_decompression_speed); // b4 because moved
-            // TODO skip for now tblock.SetSkipPilot(p_is_fun_attribute);
+            // Chain: only first block has full pilot, others a short resync
+            // right after the pause for the previous block.
+            // Frames are always chained.
+            tblock.SetSkipPilot((m_skip_pilots || m_is_frame) && (&tblock != &m_turbo_blocks.front() || is_chained));
             if (!p_is_fun_attribute)
             {
                 std::cout << "Block #" << cnt++ << "\n";
@@ -331,6 +533,9 @@ public:
             pause_before = next_pause;
         }
         m_turbo_blocks.clear();
+        m_frame_pause      = pause_before;
+        m_is_frame         = false;
+        m_is_frame_chained = false;
 
     }
 
@@ -478,8 +683,9 @@ private:
     // Move memory blocks to turboblocks.
     // Set what to do after each block eg bankswitch, CopyLoader (first), SetUsrStartAddress (last)
     // p_last_bank_to_set when <0: 48K snapshot. Dont do bank setting.
+    // p_stay_in_loader: last block continues to (wait for) next block.
     // Called from Finalize.
-    void MemoryBlocksToTurboBlocks(MemoryBlocks &&p_memory_blocks, uint16_t p_loader_copy_start, uint16_t p_usr_address, uint16_t p_clear_address, int p_last_bank_to_set)
+    void MemoryBlocksToTurboBlocks(MemoryBlocks &&p_memory_blocks, uint16_t p_loader_copy_start, uint16_t p_usr_address, uint16_t p_clear_address, int p_last_bank_to_set, bool p_stay_in_loader)
     {
         TurboBlock *prev = nullptr;
         TurboBlock *prevprev = nullptr;
@@ -524,7 +730,12 @@ private:
                 m_turbo_blocks.front().SetAfterBlockDo(TurboBlock::AfterBlock::CopyLoader);
             }
             // What should be done after last block
-            if (p_usr_address)
+            // When staying in loader keep AfterBlock::LoadNext (default): waits for next program.
+            if (p_stay_in_loader)
+            {
+                std::cout << "When done stay in loader, waiting for next program." << std::endl;
+            }
+            else if (p_usr_address)
             {
                 m_turbo_blocks.back().SetUsrStartAddress(p_usr_address);
             }
@@ -562,7 +773,8 @@ private:
         {
             tblock.SetLoadAddress(p_load_address);
         }
-        tblock.SetData(std::move(p_block.m_datablock), m_compression_type);
+        auto compression_type = p_block.m_compression_type == CompressionType::automatic ? m_compression_type : p_block.m_compression_type;
+        tblock.SetData(std::move(p_block.m_datablock).Release(), compression_type);   // only copies when split
 
         m_turbo_blocks.push_back(std::move(tblock));
         return m_turbo_blocks.back();
@@ -593,6 +805,18 @@ private:
     int                           m_decompression_speed     = loader_defaults::decompression_speed; // kb/second time spectrum needsto decompress before sending next block
     std::chrono::milliseconds     m_initial_wait            = loader_defaults::initial_wait;        // pause after loading ZQLoader itself, give basic some time.
     bool                          m_skip_pilots             = false;
+    bool                          m_is_resident             = false;                                // zqloader already at ZX Spectrum, see SetZqLoaderResident
+    bool                          m_stay_in_loader          = false;                                // see SetWhenDoneStayInLoader
+    bool                          m_is_kept                 = false;                                // see IsZqLoaderKept
+    bool                          m_is_staying              = false;                                // see IsStayingInLoader
+    bool                          m_is_intact               = false;                                // see IsZqLoaderIntact
+    bool                          m_is_delta                = false;                                // see SetDeltaBase
+    MemoryImage                   m_delta_base;
+    MemoryImage                   m_frame_image;                                                    // frames as added so far, see AddFrameAsTurboBlocks
+    bool                          m_is_frame                = false;                                // blocks to move to loader are a frame
+    bool                          m_is_frame_chained        = false;                                // ..following previous frame
+    int                           m_frame_resume_address    = 0;                                    // see LimitBlocks
+    std::chrono::milliseconds     m_frame_pause             = 0ms;                                  // needed after last block of previous MoveToLoader
 }; // class TurboBlocks
 
 
@@ -626,6 +850,45 @@ bool TurboBlocks::IsZqLoaderAdded() const
     return m_pimpl->IsZqLoaderAdded();
 }
 
+TurboBlocks& TurboBlocks::SetZqLoaderResident(const std::filesystem::path& p_filename)
+{
+    m_pimpl->SetZqLoaderResident(p_filename);
+    return *this;
+}
+
+bool TurboBlocks::IsZqLoaderResident() const
+{
+    return m_pimpl->m_is_resident;
+}
+
+TurboBlocks& TurboBlocks::SetWhenDoneStayInLoader(bool p_to_what)
+{
+    m_pimpl->m_stay_in_loader = p_to_what;
+    return *this;
+}
+
+bool TurboBlocks::IsZqLoaderKept() const
+{
+    return m_pimpl->m_is_kept;
+}
+
+bool TurboBlocks::IsZqLoaderIntact() const
+{
+    return m_pimpl->m_is_intact;
+}
+
+TurboBlocks& TurboBlocks::SetDeltaBase(const MemoryImage& p_image)
+{
+    m_pimpl->m_delta_base = p_image;
+    m_pimpl->m_is_delta   = true;
+    return *this;
+}
+
+bool TurboBlocks::IsStayingInLoader() const
+{
+    return m_pimpl->m_is_staying;
+}
+
 size_t TurboBlocks::size() const
 {
     return m_pimpl->m_memory_blocks.size(); 
@@ -644,6 +907,12 @@ TurboBlocks& TurboBlocks::AddMemoryBlockAsTurboBlock(MemoryBlock p_block,  uint1
     return *this;
 }
 
+TurboBlocks& TurboBlocks::AddFrameAsTurboBlocks(MemoryBlock p_frame, uint16_t p_load_address, std::chrono::milliseconds p_max_duration)
+{
+    m_pimpl->AddFrameAsTurboBlocks(std::move(p_frame), p_load_address, p_max_duration);
+    return *this;
+}
+
 size_t TurboBlocks::Finalize(uint16_t p_usr_address, uint16_t p_clear_address, int p_last_bank_to_set)
 {
     return m_pimpl->Finalize(p_usr_address, p_clear_address, p_last_bank_to_set);
@@ -734,6 +1003,12 @@ uint16_t TurboBlocks::GetLoaderCodeLength(bool p_with_registers ) const
 }
 
 
+LoaderPlanner TurboBlocks::GetLoaderPlanner(bool p_with_registers) const
+{
+    return m_pimpl->GetLoaderPlanner(p_with_registers);
+}
+
+
 
 TurboBlocks &TurboBlocks::DebugDump() const
 {
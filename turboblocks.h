@@ -12,11 +12,14 @@
 
 #include <memory>            // std::unique_ptr
 #include <filesystem>        // std::filesystem::path
+#include <chrono>
 #include "types.h"           // CompressionType
 
 class Symbols;
 class TurboBlock;
 class SpectrumLoader;
+class LoaderPlanner;
+class MemoryImage;
 struct MemoryBlock;
 
 
@@ -55,6 +58,35 @@ public:
     ///  Is ZqLoader added (with AddZqLoader above)?
     bool IsZqLoaderAdded() const;
 
+    /// ZQLoader is already resident at the ZX Spectrum (eg from a previous program in
+    /// a session, see LoaderSession): only loads its symbol file (has same base name).
+    /// Is not send again, so also not patched.
+    TurboBlocks& SetZqLoaderResident(const std::filesystem::path& p_filename);
+
+    ///  Is ZqLoader resident (with SetZqLoaderResident above)?
+    bool IsZqLoaderResident() const;
+
+    /// After the last block do not start machine code or return to BASIC, but
+    /// stay in the loader waiting for the next program (AfterBlock::LoadNext).
+    /// Only done when the loader is not overwritten, see IsZqLoaderKept.
+    TurboBlocks& SetWhenDoneStayInLoader(bool p_to_what);
+
+    /// After Finalize: is zqloader still intact at the ZX Spectrum after loading
+    /// all blocks, so can load a next program without sending it again?
+    /// True when no block overwrites the loader (at BASIC, at upper memory) and it
+    /// ends waiting for the next block (SetWhenDoneStayInLoader) or returns to BASIC (then RUN).
+    bool IsZqLoaderKept() const;
+
+    /// After Finalize: no block overwrites zqloader (at BASIC, at upper memory)?
+    bool IsZqLoaderIntact() const;
+
+    /// Delta: the ZX Spectrum memory is known to be as given image (eg previous program
+    /// of a session send to a resident zqloader). Only what changed is send.
+    TurboBlocks& SetDeltaBase(const MemoryImage& p_image);
+
+    /// After Finalize: does the loader stay waiting for the next program when done (see SetWhenDoneStayInLoader)?
+    bool IsStayingInLoader() const;
+
 
     /// Get # Memory blocks added
     size_t size() const;
@@ -65,6 +97,15 @@ public:
     /// Add given memory block, make it a turboblock immidiately.
     TurboBlocks& AddMemoryBlockAsTurboBlock(MemoryBlock p_block, uint16_t p_load_address = 0);
 
+    /// Video: add given frame (eg all attributes), make it turboblocks immidiately.
+    /// Only the runs that changed since the previous frame added this way are added,
+    /// each as a turboblock at its own address (so scattered by the loader).
+    /// All of it when first frame, or when that loads faster (eg scene cut).
+    /// At MoveToLoader blocks of a frame are chained, and chained to the previous frame.
+    /// p_max_duration: when not 0 send no more than takes about this long; the rest is send
+    /// with the next frame(s).
+    TurboBlocks& AddFrameAsTurboBlocks(MemoryBlock p_frame, uint16_t p_load_address = 0, std::chrono::milliseconds p_max_duration = {});
+
     /// p_usr_address: when done loading all blocks end start machine code here as in RANDOMIZE USR xxxx
     /// p_clear_address: when done loading put stack pointer here, which is a bit like CLEAR xxxx
     /// To be called after last block was added.
@@ -135,7 +176,13 @@ public:
 
     // Length needed when loader code needs to be moved away from BASIC location
     uint16_t GetLoaderCodeLength(bool p_with_registers) const;
+
+    /// Get a LoaderPlanner to find where to copy the loader to, set up with
+    /// length needed and regions used by the loader (BASIC, upper).
+    LoaderPlanner GetLoaderPlanner(bool p_with_registers) const;
    
+    /// Chain blocks: only first block gets full pilot tone, next blocks a short resync
+    /// right after the (decompression) pause of the block before. Saves time per block.
     TurboBlocks& SetSkipPilots(bool p_to_what);
 
     TurboBlocks &DebugDump() const;
@@ -0,0 +1,395 @@
+// ==============================================================================
+// PROJECT:         zqloader
+// FILE:            turbodemodulator.cpp
+// DESCRIPTION:     Implementation of class TurboDemodulator
+//
+// Copyright (c) 2025 Daan Scherft [Oxidaan]
+// This project uses the MIT license. See LICENSE.txt for details.
+// ==============================================================================
+
+#include "turbodemodulator.h"
+#include "turboblock.h"
+#include "loader_defaults.h"
+#include <istream>
+#include <iostream>
+#include <iomanip>          // std::setprecision
+#include <cstring>          // memcmp
+
+
+namespace
+{
+// Values depend only on z80 code. See zqloader.z80asm
+constexpr int leader_max            = 12;       // LEADER_MAX
+constexpr int leader_min            = 8;        // LEADER_MIN
+constexpr int sync_min              = 4;        // SYNC_MIN
+constexpr int minisync_max          = 200;      // ld B, 200 at LOAD_BYTES
+constexpr int leader_loop_overhead  = 127;      // T-states from IN that saw edge to first IN at next WAIT_FOR_EDGE (.leader_loop1)
+constexpr int minisync_overhead     = 100;      // about, from last IN at previous LOAD_BYTES or sync to first IN of minisync
+
+// Read little endian value from WAV header
+uint32_t ReadLE(const char *p_ptr, int p_size)
+{
+    uint32_t retval = 0;
+    for (int n = p_size - 1; n >= 0; n--)
+    {
+        retval = (retval << 8) | uint8_t(p_ptr[n]);
+    }
+    return retval;
+}
+}
+
+
+
+/// Set this ZQLoader parameter
+/// When 0 keep defaults.
+TurboDemodulator& TurboDemodulator::SetBitLoopMax(int p_value)
+{
+    if (p_value)
+    {
+        m_bit_loop_max = p_value;
+    }
+    return *this;
+}
+
+
+
+/// Set this ZQLoader parameter
+/// When 0 keep defaults.
+TurboDemodulator& TurboDemodulator::SetZeroMax(int p_value)
+{
+    if (p_value)
+    {
+        m_zero_max = p_value;
+    }
+    return *this;
+}
+
+
+
+/// Read a WAV file (PCM 8 or 16 bit, first channel is used) and find the edges in it.
+/// Uses some hysteresis so silence (eg at pauses) does not give edges.
+TurboDemodulator& TurboDemodulator::LoadWav(std::istream &p_stream)
+{
+    std::vector<char> data{ std::istreambuf_iterator<char>(p_stream), std::istreambuf_iterator<char>() };
+    if (data.size() < 12 || memcmp(data.data(), "RIFF", 4) != 0 || memcmp(data.data() + 8, "WAVE", 4) != 0)
+    {
+        throw std::runtime_error("Not a WAV file");
+    }
+    uint32_t num_channels    = 0;
+    uint32_t sample_rate     = 0;
+    uint32_t bits_per_sample = 0;
+    const char *samples      = nullptr;
+    size_t samples_size      = 0;
+    for (size_t pos = 12; pos + 8 <= data.size(); )
+    {
+        const char *chunk = data.data() + pos;
+        size_t chunk_size = ReadLE(chunk + 4, 4);
+        chunk_size        = std::min(chunk_size, data.size() - pos - 8);
+        if (memcmp(chunk, "fmt ", 4) == 0 && chunk_size >= 16)
+        {
+            if (ReadLE(chunk + 8, 2) != 1)
+            {
+                throw std::runtime_error("WAV file is not PCM");
+            }
+            num_channels    = ReadLE(chunk + 10, 2);
+            sample_rate     = ReadLE(chunk + 12, 4);
+            bits_per_sample = ReadLE(chunk + 22, 2);
+        }
+        else if (memcmp(chunk, "data", 4) == 0)
+        {
+            samples      = chunk + 8;
+            samples_size = chunk_size;
+        }
+        pos += 8 + chunk_size + (chunk_size & 1);       // chunks are word aligned
+    }
+    if (!samples || num_channels == 0 || sample_rate == 0 || (bits_per_sample != 8 && bits_per_sample != 16))
+    {
+        throw std::runtime_error("Unsupported WAV file (need PCM 8 or 16 bit)");
+    }
+    const size_t frame_size = num_channels * bits_per_sample / 8;
+    const int hysteresis    = 1024;                 // at 16 bit scale
+    m_edges.clear();
+    bool level = false;
+    for (size_t n = 0; (n + 1) * frame_size <= samples_size; n++)
+    {
+        const char *frame = samples + n * frame_size;
+        int value = bits_per_sample == 16 ? int(int16_t(ReadLE(frame, 2))) :
+                                            (int(uint8_t(*frame)) - 128) * 256;
+        bool new_level = value > hysteresis  ? true :
+                         value < -hysteresis ? false :
+                         level;
+        if (n == 0)
+        {
+            level = new_level;      // initial level, no edge
+        }
+        else if (new_level != level)
+        {
+            level = new_level;
+            m_edges.push_back(double(n) * m_spectrum_clock / sample_rate);
+        }
+    }
+    return *this;
+}
+
+
+
+/// Run the Z80 loader model over the edges found.
+TurboDemodulator& TurboDemodulator::Run()
+{
+    m_blocks.clear();
+    m_edge_index = 0;
+    m_level      = false;
+    m_time       = 0;
+    while (NextEdge())
+    {
+        if (!WaitForLeaderAndSync())
+        {
+            continue;       // try_again
+        }
+        Block block;
+        block.m_start = m_time;
+        if (LoadBytes(block, TurboBlock::GetHeaderSize()))
+        {
+            size_t length = size_t(block.m_data[0]) | (size_t(block.m_data[1]) << 8);      // m_length
+            if (length == 0 || LoadBytes(block, length))
+            {
+                block.m_checksum_ok = TurboBlock(block.m_data.Clone()).IsChecksumOk();
+            }
+        }
+        m_blocks.push_back(std::move(block));
+    }
+    return *this;
+}
+
+
+
+/// Get the correctly loaded blocks as TurboBlocks.
+std::vector<TurboBlock> TurboDemodulator::GetTurboBlocks() const
+{
+    std::vector<TurboBlock> retval;
+    for (const auto &block : m_blocks)
+    {
+        if (block.IsOk())
+        {
+            retval.emplace_back(block.m_data.Clone());
+        }
+    }
+    return retval;
+}
+
+
+
+/// At least one block found and all blocks loaded with correct checksum?
+bool TurboDemodulator::IsOk() const
+{
+    return !m_blocks.empty() && std::all_of(m_blocks.begin(), m_blocks.end(), [](const Block &p_block)
+    {
+        return p_block.IsOk();
+    });
+}
+
+
+
+/// Smallest timing margin in T-states over all blocks.
+double TurboDemodulator::GetSmallestMargin() const
+{
+    double retval = std::numeric_limits<double>::max();
+    for (const auto &block : m_blocks)
+    {
+        retval = std::min(retval, block.m_margins.GetSmallest());
+    }
+    return retval;
+}
+
+
+
+/// Show result of Run at std::cout
+const TurboDemodulator& TurboDemodulator::DebugDump() const
+{
+    std::cout << std::fixed << std::setprecision(1);
+    int num = 0;
+    for (const auto &block : m_blocks)
+    {
+        const auto &margins = block.m_margins;
+        std::cout << "Block " << num++ << " at " << (block.m_start / m_spectrum_clock) << "s: ";
+        if (block.m_data.size() >= TurboBlock::GetHeaderSize())
+        {
+            std::cout << "length = " << TurboBlock(block.m_data.Clone()).GetLength() << "; ";
+        }
+        std::cout << (!block.m_error.empty() ? block.m_error :
+                      block.m_checksum_ok    ? std::string("OK") :
+                                               std::string("CHECKSUM ERROR")) << '\n';
+        std::cout << "    zeros: " << margins.m_zeros;
+        if (margins.m_zeros)
+        {
+            std::cout << " margin min/avg = " << margins.m_min_zero << '/' << margins.m_sum_zero / margins.m_zeros << 'T';
+        }
+        std::cout << "; ones: " << margins.m_ones;
+        if (margins.m_ones)
+        {
+            std::cout << " margin min/avg = " << margins.m_min_one << '/' << margins.m_sum_one / margins.m_ones << 'T'
+                      << " timeout margin = " << margins.m_min_timeout << 'T';
+        }
+        if (margins.m_zeros || margins.m_ones)
+        {
+            std::cout << "; worst at byte " << margins.m_worst_byte << " bit " << margins.m_worst_bit;
+        }
+        std::cout << '\n';
+    }
+    if (!m_blocks.empty())
+    {
+        std::cout << "Smallest margin: " << GetSmallestMargin() << " T states (" << 1e6 * GetSmallestMargin() / m_spectrum_clock << "us)\n";
+    }
+    std::cout << std::defaultfloat;
+    std::cout << "Found " << m_edges.size() << " edges. Demodulated " << m_blocks.size() << " turbo blocks: " << (IsOk() ? "all OK" : "FAILED") << std::endl;
+    return *this;
+}
+
+
+
+// Consume next edge as 'first edge' (wait_for_first_edge at zqloader.z80asm).
+// Asume it is seen immediately.
+bool TurboDemodulator::NextEdge()
+{
+    if (m_edge_index >= m_edges.size())
+    {
+        return false;
+    }
+    m_time      = m_edges[m_edge_index++];
+    m_last_edge = m_time;
+    m_level     = !m_level;
+    return true;
+}
+
+
+
+// Do at most p_max_ins IN's, first at p_first_in then each p_loop_duration.
+// Returns # of IN's done when a level change was seen, 0 at timeout.
+// An even number of edges between two IN's is not seen, same as at the real Z80.
+int TurboDemodulator::PollForEdge(double p_first_in, int p_max_ins, int p_loop_duration)
+{
+    for (int n = 1; n <= p_max_ins; n++)
+    {
+        double time_in = p_first_in + (n - 1) * p_loop_duration;
+        bool level     = m_level;
+        while (m_edge_index < m_edges.size() && m_edges[m_edge_index] <= time_in)
+        {
+            level       = !level;
+            m_last_edge = m_edges[m_edge_index++];
+        }
+        if (level != m_level)
+        {
+            m_level = level;
+            m_time  = time_in;
+            return n;
+        }
+        if (m_edge_index >= m_edges.size())
+        {
+            break;      // end of stream
+        }
+    }
+    m_time = p_first_in + (p_max_ins - 1) * p_loop_duration;
+    return 0;
+}
+
+
+
+// Leader (LEADER_MIN_EDGES valid edges) followed by sync. False when not.
+// #IN's between edges: LEADER_MIN..LEADER_MAX is leader; SYNC_MIN..LEADER_MIN-1 is sync.
+bool TurboDemodulator::WaitForLeaderAndSync()
+{
+    int edges = 0;
+    while (true)
+    {
+        int num_ins = PollForEdge(m_time + leader_loop_overhead, leader_max, loader_tstates::wait_for_edge_loop);
+        if (num_ins == 0)
+        {
+            return false;       // timeout
+        }
+        if (edges < loader_tstates::leader_min_edges)
+        {
+            if (num_ins < leader_min)
+            {
+                return false;   // to soon
+            }
+            edges++;
+        }
+        else
+        {
+            if (num_ins < sync_min)
+            {
+                return false;   // to soon not even a sync
+            }
+            if (num_ins < leader_min)
+            {
+                return true;    // sync
+            }
+        }
+    }
+}
+
+
+
+// Minisync then p_length bytes (LOAD_BYTES at zqloader.z80asm) appended to p_block.
+// A bit is a one when more than ZERO_MAX IN's were needed to see the edge,
+// a timeout when no edge after BIT_LOOP_MAX-1 IN's.
+// Margin for a zero is time between edge and last IN that still gives a zero,
+// for a one the time between that IN and the edge.
+bool TurboDemodulator::LoadBytes(Block &p_block, size_t p_length)
+{
+    if (PollForEdge(m_time + minisync_overhead, minisync_max, loader_tstates::wait_for_edge_loop) == 0)
+    {
+        p_block.m_error = "Timeout at minisync";
+        return false;
+    }
+    for (size_t n = 0; n < p_length; n++)
+    {
+        int value = 0;
+        for (int bit = 7; bit >= 0; bit--)
+        {
+            double first_in = m_time + loader_tstates::bit_loop_duration;          // minisync also takes this
+            if (bit == 7 && n != 0)
+            {
+                first_in += loader_tstates::end_of_byte_delay;     // byte was stored
+            }
+            int num_ins = PollForEdge(first_in, m_bit_loop_max - 1, loader_tstates::wait_for_edge_loop_duration);
+            if (num_ins == 0)
+            {
+                p_block.m_error = "Timeout at byte " + std::to_string(p_block.m_data.size()) + " bit " + std::to_string(bit);
+                return false;
+            }
+            bool one         = num_ins > m_zero_max;
+            double threshold = first_in + (m_zero_max - 1) * loader_tstates::wait_for_edge_loop_duration;  // last IN giving a zero
+            double timeout   = first_in + (m_bit_loop_max - 2) * loader_tstates::wait_for_edge_loop_duration;
+            AddMargin(p_block.m_margins, one, one ? m_last_edge - threshold : threshold - m_last_edge, timeout - m_last_edge, p_block.m_data.size(), bit);
+            value = (value << 1) | int(one);
+        }
+        p_block.m_data.push_back(std::byte(value));
+    }
+    return true;
+}
+
+
+
+void TurboDemodulator::AddMargin(Margins &p_margins, bool p_bit, double p_margin, double p_timeout_margin, size_t p_byte, int p_bit_num) const
+{
+    double smallest = p_margins.GetSmallest();
+    if (p_bit)
+    {
+        p_margins.m_ones++;
+        p_margins.m_sum_one    += p_margin;
+        p_margins.m_min_one     = std::min(p_margins.m_min_one, p_margin);
+        p_margins.m_min_timeout = std::min(p_margins.m_min_timeout, p_timeout_margin);
+    }
+    else
+    {
+        p_margins.m_zeros++;
+        p_margins.m_sum_zero += p_margin;
+        p_margins.m_min_zero  = std::min(p_margins.m_min_zero, p_margin);
+    }
+    if (p_margins.GetSmallest() < smallest)
+    {
+        p_margins.m_worst_byte = p_byte;
+        p_margins.m_worst_bit  = p_bit_num;
+    }
+}
@@ -0,0 +1,205 @@
+// ==============================================================================
+// PROJECT:         zqloader
+// FILE:            turbodemodulator.h
+// DESCRIPTION:     Definition of class TurboDemodulator
+//
+// Copyright (c) 2025 Daan Scherft [Oxidaan]
+// This project uses the MIT license. See LICENSE.txt for details.
+// ==============================================================================
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <iosfwd>           // std::istream
+#include <limits>
+#include <algorithm>        // std::min
+#include "types.h"          // Doublesec
+#include "datablock.h"
+#include "spectrum_consts.h"
+#include "loader_defaults.h"
+#include "pulsers.h"
+#include <cmath>            // std::ceil
+
+
+class TurboBlock;
+
+
+/// Host side software model of the zqloader.z80asm turbo loader.
+/// Finds the edges in a sample stream (eg a WAV file as written by SampleToWav)
+/// then replays these against a model of the Z80 edge polling loops (WAIT_FOR_EDGE, LOAD_BYTES)
+/// using the loop timings from loader_defaults.h and the configured zero_max / bit_loop_max.
+/// Reconstructs the TurboBlocks, validates their checksums and reports per-bit timing margins:
+/// how many T-states an edge could shift before that bit would be read wrong.
+/// Normal speed (ROM) blocks in the stream are just skipped, like zqloader does.
+class TurboDemodulator
+{
+public:
+
+    /// Timing margins in T-states as seen at the bits of a block.
+    struct Margins
+    {
+        int      m_zeros               = 0;            // # zero bits seen
+        int      m_ones                = 0;            // # one bits seen
+        double   m_min_zero            = std::numeric_limits<double>::max();     // edge of a zero could be this much later, still a zero
+        double   m_min_one             = std::numeric_limits<double>::max();     // edge of a one could be this much earlier, still a one
+        double   m_min_timeout         = std::numeric_limits<double>::max();     // edge of a one could be this much later before timeout
+        double   m_sum_zero            = 0;            // to calculate average
+        double   m_sum_one             = 0;            // to calculate average
+        size_t   m_worst_byte          = 0;            // byte index (from start of header) with smallest margin
+        int      m_worst_bit           = 0;            // bit 7..0 at that byte
+
+        /// Smallest margin seen, either zero, one or timeout.
+        double GetSmallest() const
+        {
+            return std::min(std::min(m_min_zero, m_min_one), m_min_timeout);
+        }
+    };
+
+    /// A (turbo) block as found in the sample stream.
+    struct Block
+    {
+        DataBlock     m_data;                          // as received: header followed by payload
+        double        m_start         = 0;             // T-state at stream where sync was seen
+        bool          m_checksum_ok   = false;
+        std::string   m_error;                         // empty when completely received
+        Margins       m_margins;
+
+        bool IsOk() const
+        {
+            return m_error.empty() && m_checksum_ok;
+        }
+    };
+
+public:
+
+    TurboDemodulator()  = default;
+    ~TurboDemodulator() = default;
+
+
+    /// Set this ZQLoader parameter, must match what was patched into zqloader.z80asm.
+    /// When 0 keep defaults.
+    TurboDemodulator& SetBitLoopMax(int p_value);
+
+    /// Set this ZQLoader parameter, must match what was patched into zqloader.z80asm.
+    /// When 0 keep defaults.
+    TurboDemodulator& SetZeroMax(int p_value);
+
+    /// Set clock frequency in hz of the (modelled) ZX Spectrum.
+    TurboDemodulator& SetSpectrumClock(int p_spectrum_clock)
+    {
+        m_spectrum_clock = p_spectrum_clock;
+        return *this;
+    }
+
+    /// Read a WAV file (PCM 8 or 16 bit, first channel is used) and find the edges in it.
+    TurboDemodulator& LoadWav(std::istream &p_stream);
+
+    /// Set edges directly (times in T-states, ascending). Each toggles the EAR level.
+    TurboDemodulator& SetEdges(std::vector<double> p_edges)
+    {
+        m_edges = std::move(p_edges);
+        return *this;
+    }
+
+    /// Get edges as found by LoadWav or set with SetEdges/AddPulser (times in T-states).
+    const std::vector<double>& GetEdges() const
+    {
+        return m_edges;
+    }
+
+    /// Set sample rate used to quantize edges of pulsers added with AddPulser.
+    /// When 0 do not quantize.
+    TurboDemodulator& SetSampleRate(uint32_t p_sample_rate)
+    {
+        m_sample_rate = p_sample_rate;
+        return *this;
+    }
+
+    /// Render given pulser to edges, quantized at sample rate the same way as SampleSender does.
+    /// So this can be used as 'loader' at eg TurboBlock::MoveToLoader instead of SpectrumLoader.
+    template <class TPulser, typename std::enable_if<std::is_base_of<Pulser, TPulser>::value, int>::type = 0>
+    TurboDemodulator& AddPulser(TPulser p_pulser)
+    {
+        TPulser &pulser = p_pulser;         // (final) so no virtual calls
+        do
+        {
+            double wait = pulser.GetDurationWait().count();         // sec
+            if (m_sample_rate)
+            {
+                wait = std::max(1.0, std::ceil(wait * m_sample_rate - 1e-9)) / m_sample_rate;
+            }
+            m_render_time += wait;
+            Edge edge = pulser.GetEdge();
+            if (edge == Edge::toggle ||
+               (edge == Edge::one && !m_render_level) ||
+               (edge == Edge::zero && m_render_level))
+            {
+                m_render_level = !m_render_level;
+                m_edges.push_back(m_render_time * m_spectrum_clock);
+            }
+        }
+        while (!pulser.Next());
+        return *this;
+    }
+
+    /// T-state duration, needed when used as 'loader' see AddPulser.
+    Doublesec GetTstateDuration() const
+    {
+        return 1s / double(m_spectrum_clock);
+    }
+
+    /// Run the Z80 loader model over the edges found; fills blocks, see GetBlocks.
+    TurboDemodulator& Run();
+
+    /// Get all blocks found by Run.
+    const std::vector<Block>& GetBlocks() const
+    {
+        return m_blocks;
+    }
+
+    /// Get the correctly loaded blocks as TurboBlocks.
+    std::vector<TurboBlock> GetTurboBlocks() const;
+
+    /// At least one block found and all blocks loaded with correct checksum?
+    bool IsOk() const;
+
+    /// Smallest timing margin in T-states over all blocks.
+    double GetSmallestMargin() const;
+
+    /// Show result of Run at std::cout
+    const TurboDemodulator& DebugDump() const;
+
+private:
+
+    // Consume next edge as 'first edge' (wait_for_first_edge at zqloader.z80asm).
+    bool NextEdge();
+
+    // Do at most p_max_ins IN's, first at p_first_in then each p_loop_duration.
+    // Returns # of IN's done when a level change was seen, 0 at timeout.
+    int PollForEdge(double p_first_in, int p_max_ins, int p_loop_duration);
+
+    // Leader (LEADER_MIN_EDGES valid edges) followed by sync. False when not.
+    bool WaitForLeaderAndSync();
+
+    // Minisync then p_length bytes (LOAD_BYTES at zqloader.z80asm) -> p_block.
+    // False at timeout, p_block.m_error is set then.
+    bool LoadBytes(Block &p_block, size_t p_length);
+
+    void AddMargin(Margins &p_margins, bool p_bit, double p_margin, double p_timeout_margin, size_t p_byte, int p_bit_num) const;
+
+private:
+
+    std::vector<double>   m_edges;                              // edge times in T-states
+    std::vector<Block>    m_blocks;
+    int                   m_spectrum_clock = spectrum::spectrum_clock;
+    int                   m_bit_loop_max   = loader_defaults::bit_loop_max;
+    int                   m_zero_max       = loader_defaults::zero_max;
+    size_t                m_edge_index     = 0;                 // next edge not seen yet
+    bool                  m_level          = false;             // EAR level last seen (bit 6 at C at zqloader.z80asm)
+    double                m_time           = 0;                 // T-state of IN that saw last edge
+    double                m_last_edge      = 0;                 // T-state of last edge seen
+    uint32_t              m_sample_rate    = 0;                 // to quantize at AddPulser
+    double                m_render_time    = 0;                 // sec, at AddPulser
+    bool                  m_render_level   = false;             // at AddPulser
+}; // class TurboDemodulator
@@ -15,6 +15,7 @@
 #include "spectrum_consts.h"      // spectrum::tstate_one etc at IsPulserSpectrumData
 #include <string>
 #include <sstream>
+#include <cmath>           // std::lround
 
 
 inline void DebugLog(const char *p_str)
@@ -26,22 +27,24 @@ inline void DebugLog(const char *p_str)
 }
 
 // Is given (Tone)Pulser a leader tone?
-inline bool TzxWriter::IsPulserLeader(const Pulser &p_pulser)
+inline bool TzxWriter::IsPulserLeader(const AnyPulser &p_pulser)
 {
-    const TonePulser *pulser_ptr =  dynamic_cast<const TonePulser *>(&p_pulser);
-    if(pulser_ptr)
-    {
-        const auto &pattern = pulser_ptr->GetPattern();
-        return pulser_ptr->GetMaxPulses() > pattern.size() &&       // more than a single
-            (pattern.size() == 1 || (pattern.size() == 2 && pattern[0] == pattern[1]));
-    }    
-    return false;
+    const TonePulser *pulser_ptr = std::get_if<TonePulser>(&p_pulser);
+    return pulser_ptr && IsPulserLeader(*pulser_ptr);
+}
+
+// Is given TonePulser a leader tone?
+inline bool TzxWriter::IsPulserLeader(const TonePulser &p_pulser)
+{
+    const auto &pattern = p_pulser.GetPattern();
+    return p_pulser.GetMaxPulses() > pattern.size() &&       // more than a single
+        (pattern.size() == 1 || (pattern.size() == 2 && pattern[0] == pattern[1]));
 }
 
 // Is given Pulser a sync?
-inline bool TzxWriter::IsPulserSync(const Pulser &p_pulser)
+inline bool TzxWriter::IsPulserSync(const AnyPulser &p_pulser)
 {
-    const TonePulser *pulser_ptr =  dynamic_cast<const TonePulser *>(&p_pulser);
+    const TonePulser *pulser_ptr = std::get_if<TonePulser>(&p_pulser);
     if(pulser_ptr)
     {
         const auto &pattern = pulser_ptr->GetPattern();
@@ -53,9 +56,9 @@ inline bool TzxWriter::IsPulserSync(const Pulser &p_pulser)
 
 // Is given Pulser spectrum data at normal/standard ROM speed?
 // Can write as ID 10 - Standard Speed Data Block
-inline bool TzxWriter::IsPulserSpectrumData(const Pulser &p_pulser)
+inline bool TzxWriter::IsPulserSpectrumData(const AnyPulser &p_pulser)
 {
-    const DataPulser *pulser_ptr =  dynamic_cast<const DataPulser *>(&p_pulser);
+    const DataPulser *pulser_ptr = std::get_if<DataPulser>(&p_pulser);
     if(pulser_ptr)
     {
         const auto &one_pattern = pulser_ptr->GetOnePattern();
@@ -70,9 +73,9 @@ inline bool TzxWriter::IsPulserSpectrumData(const Pulser &p_pulser)
 
 // Is given Pulser a 'normal' turbo data block? With 2 same edges for each zero/one.
 // (Can write as ID 11 - Turbo Speed Data Block)
-inline bool TzxWriter::IsPulserTurboData(const Pulser &p_pulser)
+inline bool TzxWriter::IsPulserTurboData(const AnyPulser &p_pulser)
 {
-    const DataPulser *pulser_ptr =  dynamic_cast<const DataPulser *>(&p_pulser);
+    const DataPulser *pulser_ptr = std::get_if<DataPulser>(&p_pulser);
     if(pulser_ptr ) // && !IsPulserSpectrumData(p_pulser))
     {
         const auto &one_pattern = pulser_ptr->GetOnePattern();
@@ -87,10 +90,10 @@ inline bool TzxWriter::IsPulserTurboData(const Pulser &p_pulser)
 
 // Is given Pulser a zqloader turbo data block? One edge per bit.
 // (Needs ID 19 - Generalized Data Block)
-inline bool TzxWriter::IsZqLoaderTurboData(const Pulser &p_pulser)
+inline bool TzxWriter::IsZqLoaderTurboData(const AnyPulser &p_pulser)
 {
-    const DataPulser *pulser_ptr =  dynamic_cast<const DataPulser *>(&p_pulser);
-    return pulser_ptr && !IsPulserSpectrumData(*pulser_ptr) && !IsPulserTurboData(*pulser_ptr);
+    const DataPulser *pulser_ptr = std::get_if<DataPulser>(&p_pulser);
+    return pulser_ptr && !IsPulserSpectrumData(p_pulser) && !IsPulserTurboData(p_pulser);
 }
 
 void TzxWriter::WriteBegin(std::ostream& p_stream)
@@ -113,20 +116,20 @@ void TzxWriter::WriteTzxFile(const Pulsers& p_pulsers, std::ostream& p_stream,
 
 void TzxWriter::WritePulsers(const Pulsers& p_pulsers, std::ostream& p_stream,  Doublesec p_tstate_dur)
 {
-    const Pulser *prevprev{};
-    const Pulser *prev{};
-    const Pulser *current{};
+    const AnyPulser *prevprev{};
+    const AnyPulser *prev{};
+    const AnyPulser *current{};
     int zqblocks = 0;       // logging only
     for(const auto &p : p_pulsers)
     {
-        current = p.get();
+        current = &p;
 
         // Is it leader-sync-data? A standard Spectrum block?
         if(prevprev && IsPulserLeader(*prevprev) &&
            prev && IsPulserSync(*prev) &&
            IsPulserSpectrumData(*current))
         {
-            WriteAsStandardSpectrum(p_stream, *dynamic_cast<const TonePulser *>(prevprev), *dynamic_cast<const TonePulser *>(prev), *dynamic_cast<const DataPulser *>(current));
+            WriteAsStandardSpectrum(p_stream, std::get<TonePulser>(*prevprev), std::get<TonePulser>(*prev), std::get<DataPulser>(*current));
             prev = nullptr;
             current = nullptr;
         }
@@ -135,7 +138,7 @@ void TzxWriter::WritePulsers(const Pulsers& p_pulsers, std::ostream& p_stream,
            prev && IsPulserSync(*prev) &&
            IsPulserTurboData(*current))
         {
-            WriteAsTurboData(p_stream,*dynamic_cast<const TonePulser *>(prevprev), *dynamic_cast<const TonePulser *>(prev), *dynamic_cast<const DataPulser *>(current));
+            WriteAsTurboData(p_stream, std::get<TonePulser>(*prevprev), std::get<TonePulser>(*prev), std::get<DataPulser>(*current));
             prev = nullptr;
             current = nullptr;
         }
@@ -152,7 +155,7 @@ void TzxWriter::WritePulsers(const Pulsers& p_pulsers, std::ostream& p_stream,
             {
                 std::cout << "Block # " << zqblocks << " (ZQLoader data) ";
             }
-            WriteAsZqLoaderTurboData(p_stream, dynamic_cast<const TonePulser *>(prevprev), *dynamic_cast<const TonePulser *>(prev), *dynamic_cast<const DataPulser *>(current));
+            WriteAsZqLoaderTurboData(p_stream, prevprev ? std::get_if<TonePulser>(prevprev) : nullptr, std::get<TonePulser>(*prev), std::get<DataPulser>(*current));
 
             prev = nullptr;
             current = nullptr;
@@ -187,23 +190,21 @@ void TzxWriter::WriteInfo(std::ostream& p_stream, const std::string &p_text)
 }
 
 // Write a Pulser as TzxBlock
-void TzxWriter::WriteAsTzxBlock(const Pulser &p_pulser, std::ostream &p_stream,  Doublesec p_tstate_dur) 
+void TzxWriter::WriteAsTzxBlock(const AnyPulser &p_pulser, std::ostream &p_stream,  Doublesec p_tstate_dur) 
 {
-    if(dynamic_cast<const TonePulser *>(&p_pulser))
+    std::visit([&](const auto &p_concrete_pulser)
     {
-        WriteAsTzxBlock(*dynamic_cast<const TonePulser *>(&p_pulser), p_stream, p_tstate_dur);
-    }
-    if(dynamic_cast<const PausePulser *>(&p_pulser))
-    {
-        WriteAsTzxBlock(*dynamic_cast<const PausePulser *>(&p_pulser), p_stream, p_tstate_dur);
-    }
-    if(dynamic_cast<const DataPulser *>(&p_pulser))
-    {
-        WriteAsTzxBlock(*dynamic_cast<const DataPulser *>(&p_pulser), p_stream, p_tstate_dur);
-    }
+        WriteAsTzxBlock(p_concrete_pulser, p_stream, p_tstate_dur);
+    }, p_pulser);
 }
 
 
+
+// DebugPulser has no effect, nothing to write.
+void TzxWriter::WriteAsTzxBlock(const DebugPulser &, std::ostream &, Doublesec) 
+{}
+
+
 // Write a tone (eg leader).
 // Puretone or GeneralizedDataBlock
 void TzxWriter::WriteAsTzxBlock(const TonePulser &p_pulser, std::ostream &p_stream, Doublesec p_tstate_dur) 
@@ -298,7 +299,9 @@ void TzxWriter::WriteAsTzxBlock(const PausePulser &p_pulser, std::ostream& p_str
 {
     auto edge = p_pulser.GetEdgeAfterWait();
     auto duration_in_tstates = p_pulser.GetDurationInTStates();
-    auto len_in_ms = WORD((1000.0 * duration_in_tstates * p_tstate_dur).count());
+    // Round, not truncate: a pause too short might make the short resync of a chained block
+    // start before the loader listens (eg 100ms would give 99.9999...).
+    auto len_in_ms = WORD(std::lround((1000.0 * duration_in_tstates * p_tstate_dur).count()));
     if(duration_in_tstates > 35000 /* 0xffff */ && edge == Edge::no_change) // 10ms
     {
         std::cout << "Pause: PauseOrStopthetapecommand " << len_in_ms << "ms; (TStates=" << duration_in_tstates << ")" << std::endl;
@@ -17,8 +17,7 @@
 class TzxWriter
 {
 public:
-    using PulserPtr = std::unique_ptr<Pulser>;
-    using Pulsers   = std::vector<PulserPtr>;
+    using Pulsers   = std::vector<AnyPulser>;
 
 public:
     TzxWriter() = delete;
@@ -31,7 +30,8 @@ public:
     static void WriteMetaData(std::ostream& p_stream , Doublesec p_tstate_dur);
 
 private:
-    static void WriteAsTzxBlock(const Pulser &p_pulser, std::ostream &p_stream, Doublesec p_tstate_dur) ;
+    static void WriteAsTzxBlock(const AnyPulser &p_pulser, std::ostream &p_stream, Doublesec p_tstate_dur) ;
+    static void WriteAsTzxBlock(const DebugPulser &p_pulser, std::ostream &p_stream, Doublesec p_tstate_dur) ;
     static void WriteAsTzxBlock(const TonePulser &p_pluser, std::ostream &p_stream, Doublesec p_tstate_dur) ;
     static void WriteAsTzxBlock(const PausePulser &p_pluser, std::ostream &p_stream, Doublesec p_tstate_dur) ;
     static void WriteAsTzxBlock(const DataPulser &p_pluser, std::ostream &p_stream, Doublesec p_tstate_dur) ;
@@ -39,11 +39,12 @@ private:
 
     static void WriteInfo(std::ostream& p_stream, const std::string &p_text);
 
-    static bool IsPulserLeader(const Pulser &p_pulser);
-    static bool IsPulserSync(const Pulser &p_pulser);
-    static bool IsPulserSpectrumData(const Pulser &p_pulser);
-    static bool IsPulserTurboData(const Pulser &p_pulser);
-    static bool IsZqLoaderTurboData(const Pulser &p_pulser);
+    static bool IsPulserLeader(const AnyPulser &p_pulser);
+    static bool IsPulserLeader(const TonePulser &p_pulser);
+    static bool IsPulserSync(const AnyPulser &p_pulser);
+    static bool IsPulserSpectrumData(const AnyPulser &p_pulser);
+    static bool IsPulserTurboData(const AnyPulser &p_pulser);
+    static bool IsZqLoaderTurboData(const AnyPulser &p_pulser);
     static void WriteAsStandardSpectrum (std::ostream& p_stream, const TonePulser &p_leader, const TonePulser &p_sync, const DataPulser &p_data);
     static void WriteAsTurboData        (std::ostream &p_stream, const TonePulser &p_leader, const TonePulser &p_sync, const DataPulser &p_data);
     static void WriteAsZqLoaderTurboData(std::ostream &p_stream, const TonePulser *p_leader, const TonePulser &p_sync, const DataPulser &p_data);
@@ -0,0 +1,523 @@
+// ==============================================================================
+// PROJECT:         zqloader
+// FILE:            videoencoder.cpp
+// DESCRIPTION:     Implementation of class VideoEncoder
+//
+// Copyright (c) 2026 Daan Scherft [Oxidaan]
+// This project uses the MIT license. See LICENSE.txt for details.
+// ==============================================================================
+
+#include "videoencoder.h"
+#include "framescheduler.h"
+#include "temporalquantizer.h"
+#include "memoryblock.h"
+#include "spectrum_consts.h"        // SCREEN_START
+#include "spectrum_screen.h"
+#include "datablock.h"
+#include "byte_tools.h"          // _byte
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <istream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+using namespace spectrum::screen;
+
+
+namespace
+{
+
+/// Image as read, 0xAARRGGBB pixels.
+struct RgbImage
+{
+    int              m_width  = 0;
+    int              m_height = 0;
+    std::vector<Rgb> m_pixels;
+};
+
+
+
+// Read RGB pixels (3 bytes each) from given stream. False when not all could be read.
+bool ReadRgb(std::istream &p_stream, RgbImage &out_image)
+{
+    std::vector<uint8_t> bytes(size_t(out_image.m_width) * size_t(out_image.m_height) * 3);
+    p_stream.read(reinterpret_cast<char *>(bytes.data()), std::streamsize(bytes.size()));
+    if (p_stream.gcount() != std::streamsize(bytes.size()))
+    {
+        return false;
+    }
+    out_image.m_pixels.resize(bytes.size() / 3);
+    for (size_t n = 0; n < out_image.m_pixels.size(); n++)
+    {
+        out_image.m_pixels[n] = MakeRgb(bytes[3 * n], bytes[3 * n + 1], bytes[3 * n + 2]);
+    }
+    return true;
+}
+
+
+
+// Read binary PPM (P6) file, 8 bits per color.
+// Throws when it could not be read.
+RgbImage ReadPpm(const fs::path &p_filename)
+{
+    std::ifstream fileread(p_filename, std::ios::binary);
+    if (!fileread)
+    {
+        throw std::runtime_error("Could not open image file " + p_filename.string() + " for reading");
+    }
+    // header: P6 width height maxval, separated by white space, may have # comments
+    auto ReadValue = [&]
+    {
+        std::string value;
+        while (fileread >> value && value[0] == '#')
+        {
+            fileread.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        }
+        return value;
+    };
+    RgbImage image;
+    try
+    {
+        if (ReadValue() != "P6")
+        {
+            throw std::runtime_error("not a binary PPM (P6) file");
+        }
+        image.m_width   = std::stoi(ReadValue());
+        image.m_height  = std::stoi(ReadValue());
+        int max_value   = std::stoi(ReadValue());
+        if (image.m_width <= 0 || image.m_height <= 0 || max_value != 255)
+        {
+            throw std::runtime_error("size or maximum value not supported");
+        }
+    }
+    catch (const std::logic_error &)
+    {
+        throw std::runtime_error("Image file " + p_filename.string() + ": invalid header");
+    }
+    catch (const std::runtime_error &e)
+    {
+        throw std::runtime_error("Image file " + p_filename.string() + ": " + e.what());
+    }
+    fileread.get();         // single white space after header
+    if (!ReadRgb(fileread, image))
+    {
+        throw std::runtime_error("Image file " + p_filename.string() + ": too short");
+    }
+    return image;
+}
+
+
+
+// Scale given image to given size: average of the source pixels
+// covering each destination pixel (nearest when enlarging).
+std::vector<Rgb> Scale(const RgbImage &p_image, int p_width, int p_height)
+{
+    std::vector<Rgb> retval(size_t(p_width) * size_t(p_height));
+    for (int y = 0; y < p_height; y++)
+    {
+        int y0 = y * p_image.m_height / p_height;
+        int y1 = std::max(y0 + 1, (y + 1) * p_image.m_height / p_height);
+        for (int x = 0; x < p_width; x++)
+        {
+            int x0 = x * p_image.m_width / p_width;
+            int x1 = std::max(x0 + 1, (x + 1) * p_image.m_width / p_width);
+            int red = 0, green = 0, blue = 0;
+            for (int sy = y0; sy < y1; sy++)
+            {
+                const Rgb *row = p_image.m_pixels.data() + size_t(sy) * size_t(p_image.m_width);
+                for (int sx = x0; sx < x1; sx++)
+                {
+                    red   += RgbRed(row[sx]);
+                    green += RgbGreen(row[sx]);
+                    blue  += RgbBlue(row[sx]);
+                }
+            }
+            int count = (y1 - y0) * (x1 - x0);
+            retval[size_t(y) * size_t(p_width) + size_t(x)] = MakeRgb(red / count, green / count, blue / count);
+        }
+    }
+    return retval;
+}
+
+
+
+// Pixels of a screen showing bars: each 8x8 cell half paper, half ink.
+// Screen pixel layout: pixel row within a cell is at address bits 8-10.
+DataBlock GetBars(bool p_vertical)
+{
+    DataBlock retval;
+    for (int n = 0; n < SCREEN_PIXEL_SIZE; n++)
+    {
+        bool ink_row = ((n >> 8) & 7) >= 4;
+        retval.push_back(p_vertical ? (ink_row ? 0xff_byte : 0x00_byte) : 0x0f_byte);
+    }
+    return retval;
+}
+
+}   // namespace
+
+
+
+
+class VideoEncoder::Impl
+{
+    using Clock     = FrameScheduler::Clock;
+    using TimePoint = FrameScheduler::TimePoint;
+    using Doublesec = std::chrono::duration<double>;
+
+    // A source frame, converted.
+    struct Frame
+    {
+        int       m_index   = 0;            // at source
+        DataBlock m_data;                   // attributes, or screen
+        std::vector<Rgb> m_pixels;          // attribute modes: image as scaled, for TemporalQuantizer
+        bool      m_is_sent = false;
+    };
+
+public:
+
+    Impl()
+    {
+        m_converter.SetThreadCount(1);          // frames run in parallel instead
+    }
+
+    void Run(ZQLoader &p_zqloader)
+    {
+        auto action = p_zqloader.GetAction();
+        if (action != ZQLoader::Action::write_wav && action != ZQLoader::Action::write_tzx)
+        {
+            throw std::runtime_error("Video needs a wav or tzx output file");
+        }
+        if (!m_stream && m_files.empty())
+        {
+            throw std::runtime_error("Video: no input set");
+        }
+        m_scheduler.SetTargetFps(m_target_fps).Reset();
+        p_zqloader.SetPreload();
+        p_zqloader.SetCompressionType(CompressionType::automatic);
+        if (m_mode != Mode::screen)
+        {
+            p_zqloader.AddMemoryBlock({ GetBars(m_mode == Mode::attributes_32x48), spectrum::SCREEN_START }, 0);
+        }
+        if (action == ZQLoader::Action::write_tzx)
+        {
+            // tzx is written at once
+            while (SendNext(p_zqloader))
+            {
+            }
+        }
+        else
+        {
+            // next frame each time previous is done, while writing
+            p_zqloader.SetOnDone([this, &p_zqloader]
+            {
+                SendNext(p_zqloader);
+            });
+        }
+        p_zqloader.Run();
+        p_zqloader.SetOnDone(nullptr);
+        std::cout << "Video: send " << m_send_count << " frames out of " << m_read_count << "; duration " << int(m_time.count()) << "s" << std::endl;
+    }
+
+    // Add next frame to given zqloader. False when done.
+    bool SendNext(ZQLoader &p_zqloader)
+    {
+        auto now       = ToTimePoint(m_time);
+        auto show_time = m_scheduler.OnFrameShown(now).GetShowTime(now);
+        if (m_scheduler.IsReportDue())
+        {
+            std::cout << m_scheduler.GetReport() << std::endl;
+        }
+        Fill(Doublesec(show_time.time_since_epoch()).count());
+        if (m_frames.empty())
+        {
+            return false;
+        }
+        if (m_is_eof && m_frames.size() == 1 && m_frames.front().m_is_sent &&
+            m_time.count() >= GetTime(m_frames.front().m_index + 1))
+        {
+            return false;           // last frame shown long enough
+        }
+        std::vector<TimePoint> times;
+        for (const auto &frame : m_frames)
+        {
+            times.push_back(ToTimePoint(Doublesec(GetTime(frame.m_index))));
+        }
+        auto index = FrameScheduler::SelectFrame(times, show_time);
+        m_frames.erase(m_frames.begin(), m_frames.begin() + std::ptrdiff_t(index));
+        auto &frame   = m_frames.front();
+        auto  address = m_mode == Mode::screen ? spectrum::SCREEN_START : ATTR_BEGIN;
+        auto  before  = p_zqloader.GetQueuedDuration();
+        p_zqloader.AddFrame({ GetData(frame), address }, m_load_address, m_scheduler.GetFrameBudget());
+        auto airtime = p_zqloader.GetQueuedDuration() - before;
+        m_scheduler.OnFrameSend(times[index], airtime);
+        m_time += airtime;
+        frame.m_is_sent = true;
+        m_send_count++;
+        return true;
+    }
+
+private:
+
+    // Read and convert frames until the last one is at or after given time (seconds), or
+    // at end of input. Frames are read ahead and converted in parallel, one thread each,
+    // at most GetThreadCount at a time. Throws what a conversion threw.
+    // Frames that are followed by one closer to given time are skipped, never converted.
+    void Fill(double p_time)
+    {
+        while (!m_is_eof && (m_frames.empty() || GetTime(m_frames.back().m_index) < p_time))
+        {
+            std::vector<std::pair<int, RgbImage>> batch;
+            while (batch.size() < size_t(GetThreadCount()))
+            {
+                RgbImage image;
+                if (!ReadFrame(image))
+                {
+                    m_is_eof = true;
+                    break;
+                }
+                int index = m_read_count++;
+                if (!batch.empty() && GetTime(index) <= p_time)
+                {
+                    batch.back() = { index, std::move(image) };          // skip previous
+                }
+                else
+                {
+                    batch.emplace_back(index, std::move(image));
+                }
+            }
+            std::vector<Frame> frames(batch.size());
+            std::vector<std::future<void>> converts;       // last: destroyed (waited for) first, also when get throws
+            for (size_t n = 0; n < batch.size(); n++)
+            {
+                converts.push_back(std::async(std::launch::async, [&, n]
+                {
+                    frames[n].m_index = batch[n].first;
+                    Convert(batch[n].second, frames[n]);
+                }));
+            }
+            for (auto &convert : converts)
+            {
+                convert.get();              // rethrows what Convert threw
+            }
+            std::move(frames.begin(), frames.end(), std::back_inserter(m_frames));
+        }
+    }
+
+    // Read next frame, from stream or directory. False when at end.
+    bool ReadFrame(RgbImage &out_image)
+    {
+        if (m_stream)
+        {
+            out_image.m_width  = m_width;
+            out_image.m_height = m_height;
+            return ReadRgb(*m_stream, out_image);
+        }
+        if (m_next_file >= m_files.size())
+        {
+            return false;
+        }
+        out_image = ReadPpm(m_files[m_next_file++]);
+        return true;
+    }
+
+    // Convert given image to what is send (attributes or screen).
+    // Runs in parallel.
+    void Convert(const RgbImage &p_image, Frame &out_frame) const
+    {
+        if (m_mode == Mode::screen)
+        {
+            auto pixels = Scale(p_image, SCREEN_WIDTH, SCREEN_HEIGHT);
+            out_frame.m_data = m_converter.Run(pixels.data(), SCREEN_WIDTH).GetDataBlock().Clone();
+            return;
+        }
+        auto [width, height] = GetBarsSize();
+        out_frame.m_pixels = Scale(p_image, width, height);
+        auto attributes    = m_converter.RunBars(out_frame.m_pixels.data(), width, height, width);
+        auto *raw          = reinterpret_cast<const std::byte *>(attributes.data());
+        out_frame.m_data   = DataBlock(raw, raw + attributes.size());
+    }
+
+    // What to send for given frame. Attribute modes: through m_temporal_quantizer,
+    // so in order of sending.
+    DataBlock GetData(const Frame &p_frame)
+    {
+        if (m_mode == Mode::screen)
+        {
+            return p_frame.m_data.Clone();
+        }
+        auto [width, height] = GetBarsSize();
+        std::vector<Attr> attributes(p_frame.m_data.size());
+        std::copy(p_frame.m_data.begin(), p_frame.m_data.end(), reinterpret_cast<std::byte *>(attributes.data()));
+        const auto &shown = m_temporal_quantizer.Run(p_frame.m_pixels.data(), width, height, width, attributes);
+        auto *raw = reinterpret_cast<const std::byte *>(shown.data());
+        return DataBlock(raw, raw + shown.size());
+    }
+
+    // Size of image converted to attributes (bars) for attribute modes.
+    std::pair<int, int> GetBarsSize() const
+    {
+        return m_mode == Mode::attributes_64x24 ? std::pair{ 64, 24 } : std::pair{ 32, 48 };
+    }
+
+    // Time (seconds) source frame with given index is shown.
+    double GetTime(int p_index) const
+    {
+        return p_index / m_source_fps;
+    }
+
+    static TimePoint ToTimePoint(Doublesec p_time)
+    {
+        return TimePoint(std::chrono::duration_cast<Clock::duration>(p_time));
+    }
+
+    int GetThreadCount() const
+    {
+        return m_thread_count > 0 ? m_thread_count : std::max(1, int(std::thread::hardware_concurrency()));
+    }
+
+public:
+
+    Mode                  m_mode         = Mode::attributes_64x24;
+    ScreenConverter       m_converter;
+    TemporalQuantizer     m_temporal_quantizer;
+    int                   m_thread_count = 0;
+    double                m_source_fps   = 25.0;
+    double                m_target_fps   = 0;
+    uint16_t              m_load_address = 40000;
+    std::istream         *m_stream       = nullptr;
+    int                   m_width        = 0;
+    int                   m_height       = 0;
+    std::vector<fs::path> m_files;                  // images from directory
+private:
+    size_t                m_next_file    = 0;
+    bool                  m_is_eof       = false;
+    int                   m_read_count   = 0;
+    int                   m_send_count   = 0;
+    std::deque<Frame>     m_frames;                 // converted, not yet skipped
+    FrameScheduler        m_scheduler;
+    Doublesec             m_time{};                 // airtime of all frames send so far
+}; // class VideoEncoder::Impl
+
+
+
+VideoEncoder::VideoEncoder() :
+    m_pimpl(new Impl())
+{
+}
+
+VideoEncoder::VideoEncoder(VideoEncoder &&) = default;
+VideoEncoder &VideoEncoder::operator = (VideoEncoder &&) = default;
+VideoEncoder::~VideoEncoder() = default;
+
+
+
+VideoEncoder& VideoEncoder::SetMode(Mode p_mode)
+{
+    m_pimpl->m_mode = p_mode;
+    return *this;
+}
+
+
+
+VideoEncoder& VideoEncoder::SetScreenConverter(ScreenConverter p_converter)
+{
+    m_pimpl->m_converter = std::move(p_converter);
+    m_pimpl->m_converter.SetThreadCount(1);         // frames run in parallel instead
+    return *this;
+}
+
+
+
+VideoEncoder& VideoEncoder::SetTemporalThreshold(int p_threshold)
+{
+    m_pimpl->m_temporal_quantizer.SetThreshold(p_threshold);
+    return *this;
+}
+
+
+
+VideoEncoder& VideoEncoder::SetThreadCount(int p_count)
+{
+    m_pimpl->m_thread_count = p_count;
+    return *this;
+}
+
+
+
+VideoEncoder& VideoEncoder::SetSourceFps(double p_fps)
+{
+    if (p_fps <= 0)
+    {
+        throw std::runtime_error("Video: invalid source frame rate " + std::to_string(p_fps));
+    }
+    m_pimpl->m_source_fps = p_fps;
+    return *this;
+}
+
+
+
+VideoEncoder& VideoEncoder::SetTargetFps(double p_fps)
+{
+    m_pimpl->m_target_fps = p_fps;
+    return *this;
+}
+
+
+
+VideoEncoder& VideoEncoder::SetLoadAddress(uint16_t p_address)
+{
+    m_pimpl->m_load_address = p_address;
+    return *this;
+}
+
+
+
+VideoEncoder& VideoEncoder::SetInput(std::istream &p_stream, int p_width, int p_height)
+{
+    if (p_width <= 0 || p_height <= 0)
+    {
+        throw std::runtime_error("Video: invalid frame size " + std::to_string(p_width) + "x" + std::to_string(p_height));
+    }
+    m_pimpl->m_stream = &p_stream;
+    m_pimpl->m_width  = p_width;
+    m_pimpl->m_height = p_height;
+    m_pimpl->m_files.clear();
+    return *this;
+}
+
+
+
+VideoEncoder& VideoEncoder::SetInput(const fs::path &p_directory)
+{
+    std::vector<fs::path> files;
+    for (const auto &entry : fs::directory_iterator(p_directory))
+    {
+        if (entry.is_regular_file() && entry.path().extension() == ".ppm")
+        {
+            files.push_back(entry.path());
+        }
+    }
+    if (files.empty())
+    {
+        throw std::runtime_error("Video: no .ppm images found at " + p_directory.string());
+    }
+    std::sort(files.begin(), files.end());
+    m_pimpl->m_files  = std::move(files);
+    m_pimpl->m_stream = nullptr;
+    return *this;
+}
+
+
+
+void VideoEncoder::Run(ZQLoader &p_zqloader)
+{
+    m_pimpl->Run(p_zqloader);
+}
@@ -0,0 +1,87 @@
+// ==============================================================================
+// PROJECT:         zqloader
+// FILE:            videoencoder.h
+// DESCRIPTION:     Definition of class VideoEncoder
+//
+// Copyright (c) 2026 Daan Scherft [Oxidaan]
+// This project uses the MIT license. See LICENSE.txt for details.
+// ==============================================================================
+
+#pragma once
+
+#include <filesystem>
+#include <iosfwd>
+#include <memory>
+#include "zqloader.h"           // LIB_API
+#include "screenconverter.h"
+
+
+/// Headless video and image fun: converts a video (raw RGB frames) or a directory of
+/// images to turbo blocks that show them at the ZX Spectrum, one after the other,
+/// chained behind a preloaded zqloader. No Qt needed, eg to pre-render a video
+/// show as wav or tzx.
+/// Frames are converted in parallel, ahead of where they are needed.
+/// Each frame send is the source frame closest to the moment it will be visible
+/// at the ZX Spectrum (so the result keeps the pace of the source), only what
+/// changed since the previous frame is send.
+/// Writing uses the given ZQLoader, which must be set to write a wav or tzx file,
+/// so runs faster than real time.
+class LIB_API VideoEncoder
+{
+public:
+
+    /// What to send per frame.
+    enum class Mode
+    {
+        attributes_64x24,   // attributes only; screen bars: paper left, ink right
+        attributes_32x48,   // attributes only; screen bars: paper top, ink bottom
+        screen,             // full screen: pixels plus attributes (ScreenConverter); cells by error, see CellSelector
+    };
+
+    VideoEncoder();
+    VideoEncoder(VideoEncoder &&);
+    VideoEncoder &operator = (VideoEncoder &&);
+    ~VideoEncoder();
+
+    /// Set what to send per frame; default attributes_64x24.
+    VideoEncoder& SetMode(Mode p_mode);
+
+    /// Set converter used for Mode::screen (dither etc).
+    VideoEncoder& SetScreenConverter(ScreenConverter p_converter);
+
+    /// Set threshold for attribute modes: how much better a new attribute must be before
+    /// a cell changes, see TemporalQuantizer. 0 is each frame as converted.
+    VideoEncoder& SetTemporalThreshold(int p_threshold);
+
+    /// Use given number of threads to convert frames; 0 (default) is number of cores.
+    VideoEncoder& SetThreadCount(int p_count);
+
+    /// Frames per second of the source (so time each frame, or image, is shown).
+    /// Default 25.
+    VideoEncoder& SetSourceFps(double p_fps);
+
+    /// Frames per second to send at most, see FrameScheduler.
+    /// 0 (default): each frame as fast as what changed can be send.
+    VideoEncoder& SetTargetFps(double p_fps);
+
+    /// Address to load (compressed) blocks first, as in ZQLoader::AddFrame. Default 40000.
+    VideoEncoder& SetLoadAddress(uint16_t p_address);
+
+    /// Read frames of given size from given stream: p_width * p_height * 3 bytes each,
+    /// RGB (eg ffmpeg -f rawvideo -pix_fmt rgb24 -).
+    VideoEncoder& SetInput(std::istream &p_stream, int p_width, int p_height);
+
+    /// Read frames as images from given directory, in order of name.
+    /// Images must be binary PPM (P6) files (eg ffmpeg -i video.mp4 path/%05d.ppm).
+    VideoEncoder& SetInput(const std::filesystem::path &p_directory);
+
+    /// Run it: preload zqloader (p_zqloader normal filename, or default) then all frames.
+    /// p_zqloader: set up as usual (durations, volume, ...), with a wav or tzx output file.
+    /// Throws when input could not be read or converted (also when that failed at a conversion thread).
+    void Run(ZQLoader &p_zqloader);
+
+private:
+
+    class Impl;
+    std::unique_ptr<Impl> m_pimpl;
+}; // class VideoEncoder
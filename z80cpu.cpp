@@ -0,0 +1,1045 @@
+// ==============================================================================
+// PROJECT:         zqloader
+// FILE:            z80cpu.cpp
+// DESCRIPTION:     Implementation of class Z80Cpu
+//
+// Copyright (c) 2025 Daan Scherft [Oxidaan]
+// This project uses the MIT license. See LICENSE.txt for details.
+// ==============================================================================
+
+// Decoding follows 'Decoding Z80 opcodes' (http://www.z80.info/decoding.htm):
+// opcode = x(7..6) y(5..3) z(2..0); y = p(5..4) q(3).
+
+#include "z80cpu.h"
+#include <utility>          // std::swap
+
+
+namespace
+{
+
+// T-states of unprefixed opcodes; conditional jumps/calls/returns when not taken.
+// 0 for prefixes. (IX+d) adds 8 (see Z80Cpu::GetIndexAddress).
+constexpr uint8_t cycles_main[256] =
+{
+    4, 10,  7,  6,  4,  4,  7,  4,  4, 11,  7,  6,  4,  4,  7,  4,
+    8, 10,  7,  6,  4,  4,  7,  4, 12, 11,  7,  6,  4,  4,  7,  4,
+    7, 10, 16,  6,  4,  4,  7,  4,  7, 11, 16,  6,  4,  4,  7,  4,
+    7, 10, 13,  6, 11, 11, 10,  4,  7, 11, 13,  6,  4,  4,  7,  4,
+    4,  4,  4,  4,  4,  4,  7,  4,  4,  4,  4,  4,  4,  4,  7,  4,
+    4,  4,  4,  4,  4,  4,  7,  4,  4,  4,  4,  4,  4,  4,  7,  4,
+    4,  4,  4,  4,  4,  4,  7,  4,  4,  4,  4,  4,  4,  4,  7,  4,
+    7,  7,  7,  7,  7,  7,  4,  7,  4,  4,  4,  4,  4,  4,  7,  4,
+    4,  4,  4,  4,  4,  4,  7,  4,  4,  4,  4,  4,  4,  4,  7,  4,
+    4,  4,  4,  4,  4,  4,  7,  4,  4,  4,  4,  4,  4,  4,  7,  4,
+    4,  4,  4,  4,  4,  4,  7,  4,  4,  4,  4,  4,  4,  4,  7,  4,
+    4,  4,  4,  4,  4,  4,  7,  4,  4,  4,  4,  4,  4,  4,  7,  4,
+    5, 10, 10, 10, 10, 11,  7, 11,  5, 10, 10,  0, 10, 17,  7, 11,
+    5, 10, 10, 11, 10, 11,  7, 11,  5,  4, 10, 11, 10,  0,  7, 11,
+    5, 10, 10, 19, 10, 11,  7, 11,  5,  4, 10,  4, 10,  0,  7, 11,
+    5, 10, 10,  4, 10, 11,  7, 11,  5,  6, 10,  4, 10,  0,  7, 11,
+};
+
+constexpr uint8_t flags_sz   = Z80Cpu::flag_s | Z80Cpu::flag_z;
+constexpr uint8_t flags_xy   = Z80Cpu::flag_y | Z80Cpu::flag_x;
+constexpr uint8_t flags_szpv = Z80Cpu::flag_s | Z80Cpu::flag_z | Z80Cpu::flag_pv;
+
+
+constexpr bool IsEvenParity(uint8_t p_value)
+{
+    p_value ^= p_value >> 4;
+    p_value ^= p_value >> 2;
+    p_value ^= p_value >> 1;
+    return !(p_value & 1);
+}
+
+// Sign, zero and undocumented bits 5, 3 for given result.
+constexpr uint8_t SZ(uint8_t p_value)
+{
+    return uint8_t((p_value & (Z80Cpu::flag_s | flags_xy)) | (p_value ? 0 : Z80Cpu::flag_z));
+}
+
+// As SZ plus parity.
+constexpr uint8_t SZP(uint8_t p_value)
+{
+    return uint8_t(SZ(p_value) | (IsEvenParity(p_value) ? Z80Cpu::flag_pv : 0));
+}
+
+}   // namespace
+
+
+
+Z80Cpu::Z80Cpu(Bus &p_bus) :
+    m_bus(p_bus)
+{}
+
+
+
+void Z80Cpu::Reset()
+{
+    m_regs.pc   = 0;
+    m_regs.i    = 0;
+    m_regs.r    = 0;
+    m_regs.iff1 = false;
+    m_regs.iff2 = false;
+    m_regs.im   = 0;
+    m_halted    = false;
+    m_after_ei  = false;
+}
+
+
+
+int Z80Cpu::Step()
+{
+    m_after_ei = false;
+    if (m_halted)
+    {
+        m_regs.r = uint8_t((m_regs.r & 0x80) | ((m_regs.r + 1) & 0x7f));
+        return 4;
+    }
+    int tstates = 0;
+    m_index = Index::hl;
+    uint8_t opcode = FetchOpcode();
+    while (opcode == 0xdd || opcode == 0xfd)
+    {
+        m_index  = opcode == 0xdd ? Index::ix : Index::iy;
+        tstates += 4;
+        opcode   = FetchOpcode();
+    }
+    if (opcode == 0xcb)
+    {
+        tstates += m_index == Index::hl ? ExecuteCB() : ExecuteIndexCB();
+    }
+    else if (opcode == 0xed)
+    {
+        m_index  = Index::hl;       // ED ignores DD/FD
+        tstates += ExecuteED();
+    }
+    else
+    {
+        tstates += Execute(opcode);
+    }
+    return tstates;
+}
+
+
+
+int Z80Cpu::Interrupt()
+{
+    if (!m_regs.iff1 || m_after_ei)
+    {
+        return 0;
+    }
+    m_halted    = false;
+    m_regs.iff1 = false;
+    m_regs.iff2 = false;
+    m_regs.r    = uint8_t((m_regs.r & 0x80) | ((m_regs.r + 1) & 0x7f));
+    Push(m_regs.pc);
+    if (m_regs.im == 2)
+    {
+        m_regs.pc = Read16(uint16_t(m_regs.i << 8 | 0xff));
+        return 19;
+    }
+    m_regs.pc = 0x38;
+    return 13;
+}
+
+
+
+uint8_t Z80Cpu::FetchOpcode()
+{
+    m_regs.r = uint8_t((m_regs.r & 0x80) | ((m_regs.r + 1) & 0x7f));
+    return m_bus.Read(m_regs.pc++);
+}
+
+
+
+uint8_t Z80Cpu::Fetch8()
+{
+    return m_bus.Read(m_regs.pc++);
+}
+
+
+
+uint16_t Z80Cpu::Fetch16()
+{
+    uint8_t lo = Fetch8();
+    uint8_t hi = Fetch8();
+    return uint16_t(hi << 8 | lo);
+}
+
+
+
+uint16_t Z80Cpu::Read16(uint16_t p_address)
+{
+    uint8_t lo = m_bus.Read(p_address);
+    uint8_t hi = m_bus.Read(uint16_t(p_address + 1));
+    return uint16_t(hi << 8 | lo);
+}
+
+
+
+void Z80Cpu::Write16(uint16_t p_address, uint16_t p_value)
+{
+    m_bus.Write(p_address, uint8_t(p_value));
+    m_bus.Write(uint16_t(p_address + 1), uint8_t(p_value >> 8));
+}
+
+
+
+void Z80Cpu::Push(uint16_t p_value)
+{
+    m_regs.sp -= 2;
+    Write16(m_regs.sp, p_value);
+}
+
+
+
+uint16_t Z80Cpu::Pop()
+{
+    uint16_t retval = Read16(m_regs.sp);
+    m_regs.sp += 2;
+    return retval;
+}
+
+
+
+uint16_t Z80Cpu::GetIndex() const
+{
+    return m_index == Index::ix ? m_regs.ix :
+           m_index == Index::iy ? m_regs.iy :
+                                  m_regs.GetHL();
+}
+
+
+
+void Z80Cpu::SetIndex(uint16_t p_value)
+{
+    if (m_index == Index::ix)
+    {
+        m_regs.ix = p_value;
+    }
+    else if (m_index == Index::iy)
+    {
+        m_regs.iy = p_value;
+    }
+    else
+    {
+        m_regs.SetHL(p_value);
+    }
+}
+
+
+
+// (HL) or (IX+d): fetches displacement, which takes 8 extra T-states.
+uint16_t Z80Cpu::GetIndexAddress()
+{
+    if (m_index == Index::hl)
+    {
+        return m_regs.GetHL();
+    }
+    int8_t displacement = int8_t(Fetch8());
+    m_extra_tstates = 8;
+    return uint16_t(GetIndex() + displacement);
+}
+
+
+
+uint8_t Z80Cpu::GetReg(int p_reg, bool p_use_index) const
+{
+    switch (p_reg)
+    {
+        case 0: return m_regs.b;
+        case 1: return m_regs.c;
+        case 2: return m_regs.d;
+        case 3: return m_regs.e;
+        case 4: return p_use_index && m_index != Index::hl ? uint8_t(GetIndex() >> 8) : m_regs.h;
+        case 5: return p_use_index && m_index != Index::hl ? uint8_t(GetIndex())      : m_regs.l;
+        case 7: return m_regs.a;
+        default: return 0xff;
+    }
+}
+
+
+
+void Z80Cpu::SetReg(int p_reg, uint8_t p_value, bool p_use_index)
+{
+    switch (p_reg)
+    {
+        case 0: m_regs.b = p_value; break;
+        case 1: m_regs.c = p_value; break;
+        case 2: m_regs.d = p_value; break;
+        case 3: m_regs.e = p_value; break;
+        case 4:
+            if (p_use_index && m_index != Index::hl)
+            {
+                SetIndex(uint16_t(p_value << 8 | (GetIndex() & 0xff)));
+            }
+            else
+            {
+                m_regs.h = p_value;
+            }
+            break;
+        case 5:
+            if (p_use_index && m_index != Index::hl)
+            {
+                SetIndex(uint16_t((GetIndex() & 0xff00) | p_value));
+            }
+            else
+            {
+                m_regs.l = p_value;
+            }
+            break;
+        case 7: m_regs.a = p_value; break;
+        default: break;
+    }
+}
+
+
+
+uint16_t Z80Cpu::GetRegPair(int p_pair, bool p_af) const
+{
+    switch (p_pair)
+    {
+        case 0:  return m_regs.GetBC();
+        case 1:  return m_regs.GetDE();
+        case 2:  return GetIndex();
+        default: return p_af ? m_regs.GetAF() : m_regs.sp;
+    }
+}
+
+
+
+void Z80Cpu::SetRegPair(int p_pair, uint16_t p_value, bool p_af)
+{
+    switch (p_pair)
+    {
+        case 0:  m_regs.SetBC(p_value); break;
+        case 1:  m_regs.SetDE(p_value); break;
+        case 2:  SetIndex(p_value);     break;
+        default:
+            if (p_af)
+            {
+                m_regs.SetAF(p_value);
+            }
+            else
+            {
+                m_regs.sp = p_value;
+            }
+            break;
+    }
+}
+
+
+
+// cc[y]: NZ Z NC C PO PE P M
+bool Z80Cpu::Condition(int p_cc) const
+{
+    static constexpr uint8_t masks[4] = { flag_z, flag_c, flag_pv, flag_s };
+    bool set = m_regs.f & masks[p_cc >> 1];
+    return (p_cc & 1) ? set : !set;
+}
+
+
+
+// alu[y]: ADD ADC SUB SBC AND XOR OR CP
+void Z80Cpu::Alu(int p_operation, uint8_t p_value)
+{
+    uint8_t &a = m_regs.a;
+    uint8_t &f = m_regs.f;
+    switch (p_operation)
+    {
+        case 0:
+        case 1:
+        {
+            int carry  = p_operation == 1 ? (f & flag_c) : 0;
+            int result = a + p_value + carry;
+            f = uint8_t(SZ(uint8_t(result)) |
+                        ((a ^ p_value ^ result) & flag_h) |
+                        (((a ^ ~p_value) & (a ^ result) & 0x80) ? flag_pv : 0) |
+                        (result > 0xff ? flag_c : 0));
+            a = uint8_t(result);
+            break;
+        }
+        case 2:
+        case 3:
+        case 7:
+        {
+            int carry  = p_operation == 3 ? (f & flag_c) : 0;
+            int result = a - p_value - carry;
+            f = uint8_t(SZ(uint8_t(result)) | flag_n |
+                        ((a ^ p_value ^ result) & flag_h) |
+                        (((a ^ p_value) & (a ^ result) & 0x80) ? flag_pv : 0) |
+                        (result < 0 ? flag_c : 0));
+            if (p_operation == 7)
+            {
+                f = uint8_t((f & ~flags_xy) | (p_value & flags_xy));     // CP: undocumented bits from operand
+            }
+            else
+            {
+                a = uint8_t(result);
+            }
+            break;
+        }
+        case 4:
+            a &= p_value;
+            f  = uint8_t(SZP(a) | flag_h);
+            break;
+        case 5:
+            a ^= p_value;
+            f  = SZP(a);
+            break;
+        default:
+            a |= p_value;
+            f  = SZP(a);
+            break;
+    }
+}
+
+
+
+uint8_t Z80Cpu::Inc8(uint8_t p_value)
+{
+    uint8_t result = uint8_t(p_value + 1);
+    m_regs.f = uint8_t((m_regs.f & flag_c) | SZ(result) |
+                       ((p_value & 0x0f) == 0x0f ? flag_h : 0) |
+                       (p_value == 0x7f ? flag_pv : 0));
+    return result;
+}
+
+
+
+uint8_t Z80Cpu::Dec8(uint8_t p_value)
+{
+    uint8_t result = uint8_t(p_value - 1);
+    m_regs.f = uint8_t((m_regs.f & flag_c) | SZ(result) | flag_n |
+                       ((p_value & 0x0f) == 0 ? flag_h : 0) |
+                       (p_value == 0x80 ? flag_pv : 0));
+    return result;
+}
+
+
+
+uint16_t Z80Cpu::Add16(uint16_t p_value1, uint16_t p_value2)
+{
+    int result = p_value1 + p_value2;
+    m_regs.f = uint8_t((m_regs.f & flags_szpv) |
+                       (((p_value1 ^ p_value2 ^ result) >> 8) & flag_h) |
+                       ((result >> 8) & flags_xy) |
+                       (result > 0xffff ? flag_c : 0));
+    return uint16_t(result);
+}
+
+
+
+void Z80Cpu::Adc16(uint16_t p_value)
+{
+    int hl     = m_regs.GetHL();
+    int result = hl + p_value + (m_regs.f & flag_c);
+    m_regs.f = uint8_t(((result >> 8) & (flag_s | flags_xy)) |
+                       ((result & 0xffff) ? 0 : flag_z) |
+                       (((hl ^ p_value ^ result) >> 8) & flag_h) |
+                       (((hl ^ ~p_value) & (hl ^ result) & 0x8000) ? flag_pv : 0) |
+                       (result > 0xffff ? flag_c : 0));
+    m_regs.SetHL(uint16_t(result));
+}
+
+
+
+void Z80Cpu::Sbc16(uint16_t p_value)
+{
+    int hl     = m_regs.GetHL();
+    int result = hl - p_value - (m_regs.f & flag_c);
+    m_regs.f = uint8_t(((result >> 8) & (flag_s | flags_xy)) | flag_n |
+                       ((result & 0xffff) ? 0 : flag_z) |
+                       (((hl ^ p_value ^ result) >> 8) & flag_h) |
+                       (((hl ^ p_value) & (hl ^ result) & 0x8000) ? flag_pv : 0) |
+                       (result < 0 ? flag_c : 0));
+    m_regs.SetHL(uint16_t(result));
+}
+
+
+
+// rot[y]: RLC RRC RL RR SLA SRA SLL SRL
+uint8_t Z80Cpu::Rotate(int p_operation, uint8_t p_value)
+{
+    int carry;
+    uint8_t result;
+    switch (p_operation)
+    {
+        case 0:  carry = p_value >> 7; result = uint8_t(p_value << 1 | carry);                 break;
+        case 1:  carry = p_value & 1;  result = uint8_t(p_value >> 1 | carry << 7);            break;
+        case 2:  carry = p_value >> 7; result = uint8_t(p_value << 1 | (m_regs.f & flag_c));   break;
+        case 3:  carry = p_value & 1;  result = uint8_t(p_value >> 1 | (m_regs.f & flag_c) << 7); break;
+        case 4:  carry = p_value >> 7; result = uint8_t(p_value << 1);                         break;
+        case 5:  carry = p_value & 1;  result = uint8_t(p_value >> 1 | (p_value & 0x80));      break;
+        case 6:  carry = p_value >> 7; result = uint8_t(p_value << 1 | 1);                     break;
+        default: carry = p_value & 1;  result = uint8_t(p_value >> 1);                         break;
+    }
+    m_regs.f = uint8_t(SZP(result) | carry);
+    return result;
+}
+
+
+
+void Z80Cpu::Bit(int p_bit, uint8_t p_value)
+{
+    uint8_t f = uint8_t((m_regs.f & flag_c) | flag_h | (p_value & flags_xy));
+    if (!(p_value & (1 << p_bit)))
+    {
+        f |= flag_z | flag_pv;
+    }
+    if (p_bit == 7 && (p_value & 0x80))
+    {
+        f |= flag_s;
+    }
+    m_regs.f = f;
+}
+
+
+
+void Z80Cpu::Daa()
+{
+    uint8_t a          = m_regs.a;
+    uint8_t f          = m_regs.f;
+    uint8_t correction = 0;
+    uint8_t carry      = f & flag_c;
+    if ((f & flag_h) || (a & 0x0f) > 9)
+    {
+        correction |= 0x06;
+    }
+    if (carry || a > 0x99)
+    {
+        correction |= 0x60;
+        carry       = flag_c;
+    }
+    uint8_t half;
+    if (f & flag_n)
+    {
+        half     = (f & flag_h) && (a & 0x0f) < 6 ? flag_h : 0;
+        m_regs.a = uint8_t(a - correction);
+    }
+    else
+    {
+        half     = (a & 0x0f) > 9 ? flag_h : 0;
+        m_regs.a = uint8_t(a + correction);
+    }
+    m_regs.f = uint8_t(SZP(m_regs.a) | (f & flag_n) | half | carry);
+}
+
+
+
+int Z80Cpu::Execute(uint8_t p_opcode)
+{
+    auto &regs = m_regs;
+    int tstates = cycles_main[p_opcode];
+    m_extra_tstates = 0;
+    const int x = p_opcode >> 6;
+    const int y = (p_opcode >> 3) & 7;
+    const int z = p_opcode & 7;
+    const int p = y >> 1;
+    const int q = y & 1;
+    switch (x)
+    {
+        case 0:
+            switch (z)
+            {
+                case 0:
+                    if (y == 1)             // EX AF,AF'
+                    {
+                        std::swap(regs.a, regs.a_);
+                        std::swap(regs.f, regs.f_);
+                    }
+                    else if (y == 2)        // DJNZ d
+                    {
+                        int8_t displacement = int8_t(Fetch8());
+                        if (--regs.b)
+                        {
+                            regs.pc  = uint16_t(regs.pc + displacement);
+                            tstates += 5;
+                        }
+                    }
+                    else if (y >= 3)        // JR d; JR cc,d
+                    {
+                        int8_t displacement = int8_t(Fetch8());
+                        if (y == 3 || Condition(y - 4))
+                        {
+                            regs.pc  = uint16_t(regs.pc + displacement);
+                            tstates += y == 3 ? 0 : 5;
+                        }
+                    }
+                    break;                  // (y == 0: NOP)
+                case 1:
+                    if (q == 0)             // LD rp,nn
+                    {
+                        SetRegPair(p, Fetch16(), false);
+                    }
+                    else                    // ADD HL,rp
+                    {
+                        SetIndex(Add16(GetIndex(), GetRegPair(p, false)));
+                    }
+                    break;
+                case 2:
+                    switch (y)
+                    {
+                        case 0:  m_bus.Write(regs.GetBC(), regs.a);    break;      // LD (BC),A
+                        case 1:  regs.a = m_bus.Read(regs.GetBC());    break;      // LD A,(BC)
+                        case 2:  m_bus.Write(regs.GetDE(), regs.a);    break;      // LD (DE),A
+                        case 3:  regs.a = m_bus.Read(regs.GetDE());    break;      // LD A,(DE)
+                        case 4:  Write16(Fetch16(), GetIndex());       break;      // LD (nn),HL
+                        case 5:  SetIndex(Read16(Fetch16()));          break;      // LD HL,(nn)
+                        case 6:  m_bus.Write(Fetch16(), regs.a);       break;      // LD (nn),A
+                        default: regs.a = m_bus.Read(Fetch16());       break;      // LD A,(nn)
+                    }
+                    break;
+                case 3:                     // INC rp; DEC rp
+                    SetRegPair(p, uint16_t(GetRegPair(p, false) + (q ? -1 : 1)), false);
+                    break;
+                case 4:
+                case 5:                     // INC r; DEC r
+                    if (y == 6)
+                    {
+                        uint16_t address = GetIndexAddress();
+                        uint8_t value    = m_bus.Read(address);
+                        m_bus.Write(address, z == 4 ? Inc8(value) : Dec8(value));
+                    }
+                    else
+                    {
+                        SetReg(y, z == 4 ? Inc8(GetReg(y)) : Dec8(GetReg(y)));
+                    }
+                    break;
+                case 6:                     // LD r,n
+                    if (y == 6)
+                    {
+                        uint16_t address = GetIndexAddress();
+                        if (m_index != Index::hl)
+                        {
+                            m_extra_tstates = 5;        // LD (IX+d),n is 19
+                        }
+                        m_bus.Write(address, Fetch8());
+                    }
+                    else
+                    {
+                        SetReg(y, Fetch8());
+                    }
+                    break;
+                default:
+                {
+                    uint8_t a = regs.a;
+                    uint8_t f = regs.f;
+                    switch (y)
+                    {
+                        case 0:             // RLCA
+                            regs.a = uint8_t(a << 1 | a >> 7);
+                            regs.f = uint8_t((f & flags_szpv) | (regs.a & flags_xy) | (a >> 7));
+                            break;
+                        case 1:             // RRCA
+                            regs.a = uint8_t(a >> 1 | a << 7);
+                            regs.f = uint8_t((f & flags_szpv) | (regs.a & flags_xy) | (a & 1));
+                            break;
+                        case 2:             // RLA
+                            regs.a = uint8_t(a << 1 | (f & flag_c));
+                            regs.f = uint8_t((f & flags_szpv) | (regs.a & flags_xy) | (a >> 7));
+                            break;
+                        case 3:             // RRA
+                            regs.a = uint8_t(a >> 1 | (f & flag_c) << 7);
+                            regs.f = uint8_t((f & flags_szpv) | (regs.a & flags_xy) | (a & 1));
+                            break;
+                        case 4:             // DAA
+                            Daa();
+                            break;
+                        case 5:             // CPL
+                            regs.a = uint8_t(~a);
+                            regs.f = uint8_t((f & (flags_szpv | flag_c)) | flag_h | flag_n | (regs.a & flags_xy));
+                            break;
+                        case 6:             // SCF
+                            regs.f = uint8_t((f & flags_szpv) | (a & flags_xy) | flag_c);
+                            break;
+                        default:            // CCF
+                            regs.f = uint8_t(((f & (flags_szpv | flag_c)) | ((f & flag_c) ? flag_h : 0) | (a & flags_xy)) ^ flag_c);
+                            break;
+                    }
+                    break;
+                }
+            }
+            break;
+        case 1:
+            if (y == 6 && z == 6)           // HALT
+            {
+                m_halted = true;
+            }
+            else if (y == 6)                // LD (HL),r (r is never IXH/IXL)
+            {
+                uint16_t address = GetIndexAddress();
+                m_bus.Write(address, GetReg(z, false));
+            }
+            else if (z == 6)                // LD r,(HL) (r is never IXH/IXL)
+            {
+                uint16_t address = GetIndexAddress();
+                SetReg(y, m_bus.Read(address), false);
+            }
+            else                            // LD r,r
+            {
+                SetReg(y, GetReg(z));
+            }
+            break;
+        case 2:                             // alu r
+            Alu(y, z == 6 ? m_bus.Read(GetIndexAddress()) : GetReg(z));
+            break;
+        default:
+            switch (z)
+            {
+                case 0:                     // RET cc
+                    if (Condition(y))
+                    {
+                        regs.pc  = Pop();
+                        tstates += 6;
+                    }
+                    break;
+                case 1:
+                    if (q == 0)             // POP rp2
+                    {
+                        SetRegPair(p, Pop(), true);
+                    }
+                    else if (p == 0)        // RET
+                    {
+                        regs.pc = Pop();
+                    }
+                    else if (p == 1)        // EXX
+                    {
+                        std::swap(regs.b, regs.b_);
+                        std::swap(regs.c, regs.c_);
+                        std::swap(regs.d, regs.d_);
+                        std::swap(regs.e, regs.e_);
+                        std::swap(regs.h, regs.h_);
+                        std::swap(regs.l, regs.l_);
+                    }
+                    else if (p == 2)        // JP (HL)
+                    {
+                        regs.pc = GetIndex();
+                    }
+                    else                    // LD SP,HL
+                    {
+                        regs.sp = GetIndex();
+                    }
+                    break;
+                case 2:                     // JP cc,nn
+                {
+                    uint16_t address = Fetch16();
+                    if (Condition(y))
+                    {
+                        regs.pc = address;
+                    }
+                    break;
+                }
+                case 3:
+                    switch (y)
+                    {
+                        case 0:             // JP nn
+                            regs.pc = Fetch16();
+                            break;
+                        case 2:             // OUT (n),A
+                        {
+                            uint8_t port = Fetch8();
+                            m_bus.Out(uint16_t(regs.a << 8 | port), regs.a);
+                            break;
+                        }
+                        case 3:             // IN A,(n)
+                        {
+                            uint8_t port = Fetch8();
+                            regs.a = m_bus.In(uint16_t(regs.a << 8 | port));
+                            break;
+                        }
+                        case 4:             // EX (SP),HL
+                        {
+                            uint16_t value = Read16(regs.sp);
+                            Write16(regs.sp, GetIndex());
+                            SetIndex(value);
+                            break;
+                        }
+                        case 5:             // EX DE,HL (never IX)
+                        {
+                            uint16_t de = regs.GetDE();
+                            regs.SetDE(regs.GetHL());
+                            regs.SetHL(de);
+                            break;
+                        }
+                        case 6:             // DI
+                            regs.iff1 = false;
+                            regs.iff2 = false;
+                            break;
+                        case 7:             // EI
+                            regs.iff1  = true;
+                            regs.iff2  = true;
+                            m_after_ei = true;
+                            break;
+                        default:            // CB (handled at Step)
+                            break;
+                    }
+                    break;
+                case 4:                     // CALL cc,nn
+                {
+                    uint16_t address = Fetch16();
+                    if (Condition(y))
+                    {
+                        Push(regs.pc);
+                        regs.pc  = address;
+                        tstates += 7;
+                    }
+                    break;
+                }
+                case 5:
+                    if (q == 0)             // PUSH rp2
+                    {
+                        Push(GetRegPair(p, true));
+                    }
+                    else if (p == 0)        // CALL nn
+                    {
+                        uint16_t address = Fetch16();
+                        Push(regs.pc);
+                        regs.pc = address;
+                    }
+                    break;
+                case 6:                     // alu n
+                    Alu(y, Fetch8());
+                    break;
+                default:                    // RST
+                    Push(regs.pc);
+                    regs.pc = uint16_t(y * 8);
+                    break;
+            }
+            break;
+    }
+    return tstates + m_extra_tstates;
+}
+
+
+
+int Z80Cpu::ExecuteCB()
+{
+    uint8_t opcode = FetchOpcode();
+    const int x = opcode >> 6;
+    const int y = (opcode >> 3) & 7;
+    const int z = opcode & 7;
+    uint8_t value = z == 6 ? m_bus.Read(m_regs.GetHL()) : GetReg(z, false);
+    if (x == 1)                             // BIT y,r
+    {
+        Bit(y, value);
+        return z == 6 ? 12 : 8;
+    }
+    uint8_t result = x == 0 ? Rotate(y, value) :
+                     x == 2 ? uint8_t(value & ~(1 << y)) :      // RES
+                              uint8_t(value | (1 << y));        // SET
+    if (z == 6)
+    {
+        m_bus.Write(m_regs.GetHL(), result);
+        return 15;
+    }
+    SetReg(z, result, false);
+    return 8;
+}
+
+
+
+// DD CB d op: also copies result to register when z != 6 (undocumented).
+int Z80Cpu::ExecuteIndexCB()
+{
+    int8_t displacement = int8_t(Fetch8());
+    uint8_t opcode      = Fetch8();
+    const int x = opcode >> 6;
+    const int y = (opcode >> 3) & 7;
+    const int z = opcode & 7;
+    uint16_t address = uint16_t(GetIndex() + displacement);
+    uint8_t value    = m_bus.Read(address);
+    if (x == 1)
+    {
+        Bit(y, value);
+        m_regs.f = uint8_t((m_regs.f & ~flags_xy) | ((address >> 8) & flags_xy));
+        return 16;
+    }
+    uint8_t result = x == 0 ? Rotate(y, value) :
+                     x == 2 ? uint8_t(value & ~(1 << y)) :
+                              uint8_t(value | (1 << y));
+    m_bus.Write(address, result);
+    if (z != 6)
+    {
+        SetReg(z, result, false);
+    }
+    return 19;
+}
+
+
+
+int Z80Cpu::ExecuteED()
+{
+    auto &regs = m_regs;
+    uint8_t opcode = FetchOpcode();
+    const int x = opcode >> 6;
+    const int y = (opcode >> 3) & 7;
+    const int z = opcode & 7;
+    const int p = y >> 1;
+    const int q = y & 1;
+    if (x == 2 && z <= 3 && y >= 4)
+    {
+        return BlockInstruction(y, z);
+    }
+    if (x != 1)
+    {
+        return 8;                           // NONI, acts as NOP
+    }
+    switch (z)
+    {
+        case 0:                             // IN r,(C)
+        {
+            uint8_t value = m_bus.In(regs.GetBC());
+            if (y != 6)
+            {
+                SetReg(y, value, false);
+            }
+            regs.f = uint8_t((regs.f & flag_c) | SZP(value));
+            return 12;
+        }
+        case 1:                             // OUT (C),r
+            m_bus.Out(regs.GetBC(), y == 6 ? 0 : GetReg(y, false));
+            return 12;
+        case 2:                             // SBC HL,rp; ADC HL,rp
+            if (q == 0)
+            {
+                Sbc16(GetRegPair(p, false));
+            }
+            else
+            {
+                Adc16(GetRegPair(p, false));
+            }
+            return 15;
+        case 3:                             // LD (nn),rp; LD rp,(nn)
+        {
+            uint16_t address = Fetch16();
+            if (q == 0)
+            {
+                Write16(address, GetRegPair(p, false));
+            }
+            else
+            {
+                SetRegPair(p, Read16(address), false);
+            }
+            return 20;
+        }
+        case 4:                             // NEG
+        {
+            uint8_t value = regs.a;
+            regs.a = 0;
+            Alu(2, value);
+            return 8;
+        }
+        case 5:                             // RETN; RETI
+            regs.pc   = Pop();
+            regs.iff1 = regs.iff2;
+            return 14;
+        case 6:                             // IM
+        {
+            static constexpr int modes[8] = { 0, 0, 1, 2, 0, 0, 1, 2 };
+            regs.im = modes[y];
+            return 8;
+        }
+        default:
+            switch (y)
+            {
+                case 0:                     // LD I,A
+                    regs.i = regs.a;
+                    return 9;
+                case 1:                     // LD R,A
+                    regs.r = regs.a;
+                    return 9;
+                case 2:                     // LD A,I
+                case 3:                     // LD A,R
+                    regs.a = y == 2 ? regs.i : regs.r;
+                    regs.f = uint8_t((regs.f & flag_c) | SZ(regs.a) | (regs.iff2 ? flag_pv : 0));
+                    return 9;
+                case 4:                     // RRD
+                case 5:                     // RLD
+                {
+                    uint8_t value = m_bus.Read(regs.GetHL());
+                    if (y == 4)
+                    {
+                        m_bus.Write(regs.GetHL(), uint8_t(regs.a << 4 | value >> 4));
+                        regs.a = uint8_t((regs.a & 0xf0) | (value & 0x0f));
+                    }
+                    else
+                    {
+                        m_bus.Write(regs.GetHL(), uint8_t(value << 4 | (regs.a & 0x0f)));
+                        regs.a = uint8_t((regs.a & 0xf0) | value >> 4);
+                    }
+                    regs.f = uint8_t((regs.f & flag_c) | SZP(regs.a));
+                    return 18;
+                }
+                default:
+                    return 8;
+            }
+    }
+}
+
+
+
+// bli[y,z]: LDI CPI INI OUTI / LDD CPD IND OUTD / LDIR CPIR INIR OTIR / LDDR CPDR INDR OTDR
+int Z80Cpu::BlockInstruction(int p_y, int p_z)
+{
+    auto &regs = m_regs;
+    const int  direction = (p_y & 1) ? -1 : 1;
+    const bool repeat    = p_y >= 6;
+    bool again           = false;
+    switch (p_z)
+    {
+        case 0:                             // LDI
+        {
+            uint8_t value = m_bus.Read(regs.GetHL());
+            m_bus.Write(regs.GetDE(), value);
+            regs.SetHL(uint16_t(regs.GetHL() + direction));
+            regs.SetDE(uint16_t(regs.GetDE() + direction));
+            regs.SetBC(uint16_t(regs.GetBC() - 1));
+            uint8_t n = uint8_t(value + regs.a);
+            regs.f = uint8_t((regs.f & (flags_sz | flag_c)) | (regs.GetBC() ? flag_pv : 0) |
+                             (n & flag_x) | ((n << 4) & flag_y));
+            again  = regs.GetBC() != 0;
+            break;
+        }
+        case 1:                             // CPI
+        {
+            uint8_t value  = m_bus.Read(regs.GetHL());
+            uint8_t result = uint8_t(regs.a - value);
+            uint8_t half   = (regs.a ^ value ^ result) & flag_h;
+            uint8_t n      = uint8_t(result - (half ? 1 : 0));
+            regs.SetHL(uint16_t(regs.GetHL() + direction));
+            regs.SetBC(uint16_t(regs.GetBC() - 1));
+            regs.f = uint8_t((regs.f & flag_c) | flag_n | (SZ(result) & flags_sz) | half |
+                             (regs.GetBC() ? flag_pv : 0) | (n & flag_x) | ((n << 4) & flag_y));
+            again  = regs.GetBC() != 0 && result != 0;
+            break;
+        }
+        case 2:                             // INI
+        {
+            uint8_t value = m_bus.In(regs.GetBC());
+            m_bus.Write(regs.GetHL(), value);
+            regs.SetHL(uint16_t(regs.GetHL() + direction));
+            regs.b--;
+            regs.f = uint8_t(SZ(regs.b) | flag_n);
+            again  = regs.b != 0;
+            break;
+        }
+        default:                            // OUTI
+        {
+            uint8_t value = m_bus.Read(regs.GetHL());
+            regs.b--;
+            m_bus.Out(regs.GetBC(), value);
+            regs.SetHL(uint16_t(regs.GetHL() + direction));
+            regs.f = uint8_t(SZ(regs.b) | flag_n);
+            again  = regs.b != 0;
+            break;
+        }
+    }
+    if (repeat && again)
+    {
+        regs.pc -= 2;
+        return 21;
+    }
+    return 16;
+}
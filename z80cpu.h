@@ -0,0 +1,161 @@
+// ==============================================================================
+// PROJECT:         zqloader
+// FILE:            z80cpu.h
+// DESCRIPTION:     Definition of class Z80Cpu
+//
+// Copyright (c) 2025 Daan Scherft [Oxidaan]
+// This project uses the MIT license. See LICENSE.txt for details.
+// ==============================================================================
+
+#pragma once
+
+#include <cstdint>
+
+
+/// A Z80 CPU.
+/// Executes one instruction at a time, see Step, counting T-states as on a
+/// ZX Spectrum without memory or IO contention.
+/// Includes the undocumented instructions commonly used (IXH/IXL, SLL, DDCB with register copy).
+/// Memory and IO are accessed through a Bus given at CTOR.
+class Z80Cpu
+{
+public:
+
+    /// Memory and IO as seen by the CPU.
+    class Bus
+    {
+    public:
+        virtual ~Bus() = default;
+        virtual uint8_t Read(uint16_t p_address) = 0;
+        virtual void    Write(uint16_t p_address, uint8_t p_value) = 0;
+        virtual uint8_t In(uint16_t p_port) = 0;
+        virtual void    Out(uint16_t p_port, uint8_t p_value) = 0;
+    };
+
+    /// Flag bits at F
+    enum Flag : uint8_t
+    {
+        flag_c  = 0x01,
+        flag_n  = 0x02,
+        flag_pv = 0x04,
+        flag_x  = 0x08,         // undocumented, bit 3
+        flag_h  = 0x10,
+        flag_y  = 0x20,         // undocumented, bit 5
+        flag_z  = 0x40,
+        flag_s  = 0x80,
+    };
+
+    /// All registers.
+    struct Registers
+    {
+        uint8_t  a = 0xff, f = 0xff;
+        uint8_t  b = 0, c = 0, d = 0, e = 0, h = 0, l = 0;
+        uint8_t  a_ = 0, f_ = 0, b_ = 0, c_ = 0, d_ = 0, e_ = 0, h_ = 0, l_ = 0;    // alternate set
+        uint16_t ix = 0, iy = 0, sp = 0xffff, pc = 0;
+        uint8_t  i = 0, r = 0;
+        bool     iff1 = false, iff2 = false;
+        int      im = 0;
+
+        uint16_t GetBC() const { return uint16_t(b << 8 | c); }
+        uint16_t GetDE() const { return uint16_t(d << 8 | e); }
+        uint16_t GetHL() const { return uint16_t(h << 8 | l); }
+        uint16_t GetAF() const { return uint16_t(a << 8 | f); }
+        void SetBC(uint16_t p_value) { b = uint8_t(p_value >> 8); c = uint8_t(p_value); }
+        void SetDE(uint16_t p_value) { d = uint8_t(p_value >> 8); e = uint8_t(p_value); }
+        void SetHL(uint16_t p_value) { h = uint8_t(p_value >> 8); l = uint8_t(p_value); }
+        void SetAF(uint16_t p_value) { a = uint8_t(p_value >> 8); f = uint8_t(p_value); }
+    };
+
+public:
+
+    explicit Z80Cpu(Bus &p_bus);
+
+    /// Reset CPU (PC=0, interrupts disabled, IM 0).
+    void Reset();
+
+    /// Execute one instruction (including its prefixes).
+    /// Returns # T-states it took. When halted executes a NOP (4 T-states).
+    int Step();
+
+    /// Request maskable interrupt.
+    /// Returns # T-states taken when accepted, 0 when not (DI or just after EI).
+    /// IM 0 is taken as RST 38h (as on a ZX Spectrum).
+    int Interrupt();
+
+    /// Is CPU at HALT?
+    bool IsHalted() const
+    {
+        return m_halted;
+    }
+
+    /// Read/write register access.
+    Registers& GetRegisters()
+    {
+        return m_regs;
+    }
+
+    /// Read register access.
+    const Registers& GetRegisters() const
+    {
+        return m_regs;
+    }
+
+private:
+
+    enum class Index { hl, ix, iy };
+
+    // Fetch opcode byte at PC (M1, increments R)
+    uint8_t FetchOpcode();
+    uint8_t Fetch8();
+    uint16_t Fetch16();
+    uint16_t Read16(uint16_t p_address);
+    void Write16(uint16_t p_address, uint16_t p_value);
+    void Push(uint16_t p_value);
+    uint16_t Pop();
+
+    // Execute unprefixed opcode (or DD/FD prefixed)
+    int Execute(uint8_t p_opcode);
+    // CB prefixed
+    int ExecuteCB();
+    // DD CB / FD CB prefixed
+    int ExecuteIndexCB();
+    // ED prefixed
+    int ExecuteED();
+
+    // HL or IX or IY depending on prefix
+    uint16_t GetIndex() const;
+    void SetIndex(uint16_t p_value);
+    // (HL) or (IX+d) or (IY+d); reads d when indexed.
+    uint16_t GetIndexAddress();
+
+    // r[y] as at 'Decoding Z80 opcodes'; 6 is (HL) not allowed here.
+    // When p_use_index H/L are IXH/IXL (or IYH/IYL).
+    uint8_t GetReg(int p_reg, bool p_use_index = true) const;
+    void SetReg(int p_reg, uint8_t p_value, bool p_use_index = true);
+
+    // rp[p] (p_af false) or rp2[p] (p_af true).
+    uint16_t GetRegPair(int p_pair, bool p_af) const;
+    void SetRegPair(int p_pair, uint16_t p_value, bool p_af);
+
+    bool Condition(int p_cc) const;
+
+    void Alu(int p_operation, uint8_t p_value);
+    uint8_t Inc8(uint8_t p_value);
+    uint8_t Dec8(uint8_t p_value);
+    uint16_t Add16(uint16_t p_value1, uint16_t p_value2);
+    void Adc16(uint16_t p_value);
+    void Sbc16(uint16_t p_value);
+    uint8_t Rotate(int p_operation, uint8_t p_value);
+    void Bit(int p_bit, uint8_t p_value);
+    void Daa();
+    int BlockInstruction(int p_y, int p_z);
+
+private:
+
+    Bus        &m_bus;
+    Registers   m_regs;
+    Index       m_index     = Index::hl;
+    bool        m_halted    = false;
+    bool        m_after_ei  = false;        // no interrupt directly after EI
+    int         m_extra_tstates = 0;        // at (IX+d), see GetIndexAddress
+}; // class Z80Cpu
@@ -14,6 +14,7 @@
 #include "symbols.h"
 #include "turboblocks.h"
 #include "memoryblock.h"
+#include "loaderplanner.h"
 #include "byte_tools.h"
 #include "tools.h"
 #include "spectrum_screen.h"
@@ -139,15 +140,16 @@ SnapShotLoader& SnapShotLoader::LoadZ80(std::istream& p_stream)
     if (header.PC_reg != 0)      // v1
     {
         MemoryBlock mem48k;
-        mem48k.m_datablock.resize(48 * 1024);
+        DataBlock mem48k_data(48 * 1024);
         mem48k.m_address = spectrum::RAM_START;
         std::cout << "Z80 version 1 file" << std::endl;
-        p_stream.read(reinterpret_cast<char*>(mem48k.m_datablock.data()), 48 * 1024);       // will normally read less than 48k
-        mem48k.m_datablock = DeCompress(mem48k.m_datablock);
-        if( mem48k.m_datablock.size() != 48 * 1024)
+        p_stream.read(reinterpret_cast<char*>(mem48k_data.data()), 48 * 1024);       // will normally read less than 48k
+        mem48k_data = DeCompress(mem48k_data);
+        if( mem48k_data.size() != 48 * 1024)
         {
-            throw std::runtime_error("Size of uncompressed Z80 block should be 48K but is: " + std::to_string(mem48k.m_datablock.size()));
+            throw std::runtime_error("Size of uncompressed Z80 block should be 48K but is: " + std::to_string(mem48k_data.size()));
         }
+        mem48k.m_datablock = std::move(mem48k_data);
         m_ram.push_back(std::move(mem48k));
         m_is_48K = true;
     }
@@ -186,7 +188,7 @@ SnapShotLoader& SnapShotLoader::LoadZ80(std::istream& p_stream)
         }
 
         MemoryBlock mem48k;
-        mem48k.m_datablock.resize(48 * 1024);
+        DataBlock mem48k_data(48 * 1024);
         mem48k.m_address = spectrum::RAM_START;
         int cnt = 0;
         // Read 16K data blocks
@@ -195,19 +197,21 @@ SnapShotLoader& SnapShotLoader::LoadZ80(std::istream& p_stream)
             cnt++;
             auto data_header = LoadBinary<Z80SnapShotDataHeader>(p_stream);
             MemoryBlock bank16k;
+            DataBlock bank16k_data;
             // "If length=0xffff, data is 16384 bytes long and not compressed"
             if (data_header.length != 0xffff)
             {
                 DataBlock cblock;
                 cblock.resize(data_header.length);
                 p_stream.read(reinterpret_cast<char*>(cblock.data()), data_header.length);
-                bank16k.m_datablock = DeCompress(cblock);        // z80 decompression algo
+                bank16k_data = DeCompress(cblock);        // z80 decompression algo
             }
             else
             {
-                bank16k.m_datablock.resize(16384);
-                p_stream.read(reinterpret_cast<char*>(bank16k.m_datablock.data()), 16384);
+                bank16k_data.resize(16384);
+                p_stream.read(reinterpret_cast<char*>(bank16k_data.data()), 16384);
             }
+            bank16k.m_datablock = std::move(bank16k_data);
             if (bank16k.size() != 16384)
             {
                 throw std::runtime_error("Error reading z80 file block size not correct must be 16384 but is: " + std::to_string(bank16k.size()) + ".");
@@ -220,7 +224,7 @@ SnapShotLoader& SnapShotLoader::LoadZ80(std::istream& p_stream)
                 // asume bank 0 is set by default
                 // Copy these banks to the 48K datablock; will be the first.
                 // Same as v1 snapshot. And SNA snapshot.
-                std::copy(bank16k.m_datablock.begin(), bank16k.m_datablock.end(), mem48k.m_datablock.begin() +  bank16k.m_address - spectrum::RAM_START);
+                std::copy(bank16k.m_datablock.begin(), bank16k.m_datablock.end(), mem48k_data.begin() +  bank16k.m_address - spectrum::RAM_START);
                 std::cout << " (48k block)" << std::endl;
             }
             else
@@ -230,6 +234,7 @@ SnapShotLoader& SnapShotLoader::LoadZ80(std::istream& p_stream)
                 std::cout << " (switchable bank)" << std::endl;
             }
         }
+        mem48k.m_datablock = std::move(mem48k_data);
         m_ram.push_front( std::move(mem48k));
         if(m_is_48K)
         {
@@ -256,9 +261,9 @@ SnapShotLoader& SnapShotLoader::LoadSna(std::istream& p_stream)
     SnaSnapshotShotHeader header = LoadBinary<SnaSnapshotShotHeader>(p_stream);
 
     MemoryBlock mem48k;
-    mem48k.m_datablock.resize(48 * 1024);
+    DataBlock mem48k_data(48 * 1024);
     mem48k.m_address = spectrum::RAM_START;
-    p_stream.read(reinterpret_cast<char*>(mem48k.m_datablock.data()), 48 * 1024);
+    p_stream.read(reinterpret_cast<char*>(mem48k_data.data()), 48 * 1024);
 
     uint16_t pc;
     if(p_stream.peek() && p_stream.good())
@@ -280,21 +285,22 @@ SnapShotLoader& SnapShotLoader::LoadSna(std::istream& p_stream)
                 std::cout << p_stream.tellg() << " Reading bank: " << bank << std::endl;
                 MemoryBlock bank16k;
                 bank16k.m_address = 0xc000;
-                bank16k.m_datablock.resize(16384);
+                DataBlock bank16k_data(16384);
                 // we want to have bank 0 in mem48k
                 if(bank == 0)  // note current_bank != 0
                 {
                     // last 16k of earlier read mem48k->bank16k
-                    std::copy(mem48k.m_datablock.begin() + 0x8000, mem48k.m_datablock.end(), bank16k.m_datablock.begin());
+                    std::copy(mem48k_data.begin() + 0x8000, mem48k_data.end(), bank16k_data.begin());
                     bank16k.m_bank = current_bank;
                     // read (bank 0) into last 16k of mem48k (basically swap them)
-                    p_stream.read(reinterpret_cast<char*>(mem48k.m_datablock.data()) + 0x8000, 16384);
+                    p_stream.read(reinterpret_cast<char*>(mem48k_data.data()) + 0x8000, 16384);
                 }
                 else
                 {
-                    p_stream.read(reinterpret_cast<char*>(bank16k.m_datablock.data()), 16384);
+                    p_stream.read(reinterpret_cast<char*>(bank16k_data.data()), 16384);
                     bank16k.m_bank = bank;
                 }
+                bank16k.m_datablock = std::move(bank16k_data);
                 m_ram.push_back(std::move(bank16k));
             }
         }
@@ -303,9 +309,10 @@ SnapShotLoader& SnapShotLoader::LoadSna(std::istream& p_stream)
     {
         std::cout << "48K SNA snapshot." << std::endl;
         // 'pop pc'
-        pc = uint16_t(mem48k.m_datablock[header.SP_reg - spectrum::RAM_START]) + 256 * uint16_t(mem48k.m_datablock[header.SP_reg + 1 - spectrum::RAM_START]);
+        pc = uint16_t(mem48k_data[header.SP_reg - spectrum::RAM_START]) + 256 * uint16_t(mem48k_data[header.SP_reg + 1 - spectrum::RAM_START]);
         header.SP_reg += 2;
     }
+    mem48k.m_datablock = std::move(mem48k_data);
     m_ram.push_front(std::move(mem48k));
     // sna snapshot header -> z80 snapshot header
     m_z80_snapshot_header.A_reg            = (header.AF_reg >> 8) & 0xff;
@@ -458,60 +465,34 @@ X  X XXX   XX  XXX  XXX X   XXXX X  X X  XX  X  X XXX X X X X  X  XX  X      XX
 
 
 
-// Get emtpy space (zero's of given length) in given block
-inline uint16_t GetEmptySpaceLocation(const DataBlock &p_block, uint16_t p_len, uint16_t p_offset = 0)
-{
-    int cnt = 0;
-    for(uint16_t n = p_offset; n < p_block.size(); n++)
-    {
-        auto b = p_block[n];
-        if(b == 0_byte)
-        {
-            cnt++;
-            if(cnt == p_len)
-            {
-                return n + 1 - p_len;
-            }
-        }
-        else
-        {
-            cnt = 0;
-        }
-    }
-    return 0;
-}
-
-
-
 /// Move this snapshot -as read from Z80 file- to given TurboBlocks.
 /// p_new_loader_location: were to copy loader to. 0 is automatic (empty location when found, else screen)
 void SnapShotLoader::MoveToTurboBlocks(TurboBlocks& p_turbo_blocks, uint16_t p_new_loader_location, bool p_write_fun_attribs)
 {
     const auto &symbols = p_turbo_blocks.GetSymbols();              // alias
     MemoryBlocks all_blocks =  GetRam();
+    if(p_new_loader_location == 0)
+    {
+        // Zero filled memory can be used; but not just below the stack pointer: the
+        // interrupt (at start) would overwrite the register restore code.
+        auto sp = m_z80_snapshot_header.SP_reg;
+        auto placement = p_turbo_blocks.GetLoaderPlanner(true).
+                         SetAllowZeroRegions(true).
+                         AddReserved(sp - 32, sp + 2).
+                         Run(all_blocks);
+        p_new_loader_location = placement.m_address ? placement.m_address : spectrum::screen::SCREEN_23RD;
+        std::cout << "Will copy loader code to: " << p_new_loader_location << " (length = " << p_turbo_blocks.GetLoaderCodeLength(true) <<
+                     "); " << placement.m_reason << std::endl;
+    }
+    m_loader_location = p_new_loader_location;
     bool first = true;
     for(auto &block: all_blocks)
     {
         if(first)
         {
-            DataBlock &first_block  = block.m_datablock;                               // the first block
+            DataBlock first_block  = std::move(block.m_datablock).Release();          // the first block (not shared so not copied)
 
             uint16_t z80_snapshot_offset = uint16_t(block.GetStartAddress());                                    // 48k z80 snapshot starts here (offset)
-            if(p_new_loader_location == 0)
-            {
-                uint16_t len_needed = p_turbo_blocks.GetLoaderCodeLength(true); // space needed for our loader code
-                p_new_loader_location = GetEmptySpaceLocation(first_block, len_needed, 6 * 1024 + 768); // location for our loader code
-                if(p_new_loader_location == 0)                                                            // no empty space found, use last 3rd of screen
-                {
-                    p_new_loader_location = spectrum::screen::SCREEN_23RD;
-                    std::cout << "Not enough empty space found in snapshot. Will copy loader code to screen. (" << spectrum::screen::SCREEN_23RD << "; length = " << len_needed << ")" << std::endl;
-                }
-                else
-                {
-                    p_new_loader_location += z80_snapshot_offset;       // adjust offset within (48k) snapshot
-                    std::cout << "Found empty space to copy loader code to: " << p_new_loader_location << ". (length = " << len_needed << ")" << std::endl;
-                }
-            }
             uint16_t register_code_start = p_new_loader_location +
                                            symbols.GetSymbol("STACK_SIZE") +
                                            symbols.GetSymbol("ASM_CONTROL_CODE_LEN") +
@@ -523,9 +504,6 @@ void SnapShotLoader::MoveToTurboBlocks(TurboBlocks& p_turbo_blocks, uint16_t p_n
             // or put brackets around it. Else iterator is temporary out of range which asserts.
             std::copy(m_reg_block.begin(), m_reg_block.end(), first_block.begin() + (register_code_start - z80_snapshot_offset));
 
-            DataBlock screenblock(first_block.begin(), first_block.begin() + spectrum::screen::SCREEN_SIZE);      // split
-            DataBlock payload(first_block.begin() + spectrum::screen::SCREEN_SIZE, first_block.end());
-
             if(p_write_fun_attribs)
             {
                 // For fun write a attribute block -> text_attr (last 3rd)
@@ -534,9 +512,12 @@ void SnapShotLoader::MoveToTurboBlocks(TurboBlocks& p_turbo_blocks, uint16_t p_n
                 DataBlock text_attr;
                 text_attr.resize(256);
                 WriteTextToAttr(text_attr, ToUpper(m_name), 0_byte, true, 0);    // 0_byte: random colors
-                std::copy(text_attr.begin(), text_attr.end(), screenblock.begin() + (spectrum::screen::ATTR_23RD - z80_snapshot_offset));
+                std::copy(text_attr.begin(), text_attr.end(), first_block.begin() + (spectrum::screen::ATTR_23RD - z80_snapshot_offset));
 
             }
+
+            auto [screenblock, payload] = SplitBlock(DataBlockView(std::move(first_block)), spectrum::screen::SCREEN_SIZE);      // split (shares data)
+
             p_turbo_blocks.AddMemoryBlock({std::move(screenblock), spectrum::SCREEN_START});                     // screen
             p_turbo_blocks.SetLoaderCopyTarget(p_new_loader_location);
             p_turbo_blocks.AddMemoryBlock({std::move(payload), spectrum::SCREEN_START + spectrum::screen::SCREEN_SIZE}); // rest
@@ -143,6 +143,13 @@ public:
         return m_usr;
     }
 
+    /// Where MoveToTurboBlocks copied the loader (including register load code) to.
+    /// Memory there differs from the snapshot after loading.
+    uint16_t GetLoaderLocation() const
+    {
+        return m_loader_location;
+    }
+
     // Entire value for last OUT to 0x7ffd.
     // GetLastOut7ffd() & 0x7 = bank
     int GetLastOut7ffd() const
@@ -183,6 +190,7 @@ private:
     MemoryBlocks m_ram;         // All ram banks.
     DataBlock m_reg_block;      // Typically would be snapshotregs.bin as created by sjasmplus.
     uint16_t m_usr = 0;
+    uint16_t m_loader_location = 0;     // see GetLoaderLocation
     std::string m_name;
     bool m_is_48K = true;
 };
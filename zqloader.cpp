@@ -22,9 +22,15 @@
 #include "z80snapshot_loader.h"
 #include "samplesender.h"
 #include "sampletowav.h"
+#include "turbodemodulator.h"
+#include "timingoptimizer.h"
+#include "spectrumemulator.h"
+#include "tapeedges.h"
 #include "loader_defaults.h"
+#include "loadersession.h"
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <filesystem>
 namespace fs = std::filesystem;
 
@@ -96,6 +102,7 @@ public:
     /// Set spectrum clock frequency.
     void SetSpectrumClock(int p_spectrum_clock)
     {
+        m_spectrum_clock = p_spectrum_clock;
         m_spectrumloader.SetTstateDuration(1s / double(p_spectrum_clock));
     }
 
@@ -156,6 +163,8 @@ public:
             // normal, so play as sound
             m_spectrumloader.Attach(m_sample_sender);
             m_sample_sender.SetVolume(m_volume_left, m_volume_right).SetSampleRate(m_sample_rate);
+            // Until done the state of the loader at the ZX Spectrum is unknown (eg stopped).
+            m_session.SetResident(false).Save();
             if(p_threaded)
             {
                 m_is_busy = true;
@@ -189,6 +198,107 @@ public:
             std::cout << "Written " << outputfilename << std::endl;
             Reset();
         }
+        else if (m_action == Action::verify || m_action == Action::emulate)
+        {
+            // Render as wav in memory, then demodulate or emulate that
+            std::stringstream stream;
+            SampleToWav wav_writer;
+            m_spectrumloader.Attach(wav_writer);
+            wav_writer.SetSampleRate(m_sample_rate);
+            wav_writer.WriteToFile(stream);
+            try
+            {
+                if (m_action == Action::verify)
+                {
+                    Verify(stream);
+                }
+                else
+                {
+                    Emulate(stream);
+                }
+            }
+            catch(...)
+            {
+                Reset();
+                throw;
+            }
+            Reset();
+        }
+    }
+
+
+    /// Search fastest safe timing for current sample rate/clock, then use it.
+    void OptimizeTimings(int p_safety_margin)
+    {
+        uint32_t sample_rate = m_sample_rate;
+        if (sample_rate == 0)
+        {
+            sample_rate = m_action == Action::play_audio ? SampleSender::GetDeviceSampleRate() :
+                                                           48000;       // s/a SampleToWav
+        }
+        std::cout << "Searching fastest timing for sample rate " << sample_rate << "hz with safety margin " << p_safety_margin << " T states..." << std::endl;
+        TimingProfile profile = TimingOptimizer().
+                                    SetSampleRate(sample_rate).
+                                    SetSpectrumClock(m_spectrum_clock).
+                                    SetSafetyMargin(p_safety_margin).
+                                    Run();
+        m_sample_rate  = sample_rate;
+        m_bit_loop_max = profile.m_bit_loop_max;
+        m_zero_max     = profile.m_zero_max;
+        m_turboblocks.SetDurations(profile.m_zero_duration, profile.m_one_duration, profile.m_end_of_byte_delay).
+                      SetZeroMax(profile.m_zero_max).
+                      SetBitLoopMax(profile.m_bit_loop_max);
+        std::cout << "Timing profile: " << profile << '\n'
+                  << "(smallest margin " << profile.m_margin << " T states; about " << int(profile.GetBitsPerSecond()) << " bps)" << std::endl;
+    }
+
+
+    /// Demodulate given WAV stream using a model of the zqloader turbo loader.
+    /// Throws when not all blocks could be loaded.
+    void Verify(std::istream &p_stream) const
+    {
+        TurboDemodulator demodulator;
+        demodulator.SetBitLoopMax(m_bit_loop_max).
+                    SetZeroMax(m_zero_max).
+                    SetSpectrumClock(m_spectrum_clock).
+                    LoadWav(p_stream).
+                    Run().
+                    DebugDump();
+        if (!demodulator.IsOk())
+        {
+            throw std::runtime_error("Verify failed: not all turbo blocks could be loaded");
+        }
+    }
+
+    /// Load given WAV stream at an emulated ZX Spectrum, then compare its memory
+    /// with the turbo file. Throws when loading failed or memory differs.
+    /// Snapshots stop at the register load code, so the loader is still there: its
+    /// memory is not compared.
+    void Emulate(std::istream &p_stream) const
+    {
+        TurboDemodulator demodulator;
+        demodulator.SetSpectrumClock(m_spectrum_clock).LoadWav(p_stream);
+        SpectrumEmulator emulator;
+        emulator.SetRom(m_rom_filename).
+                 Set128K(m_128_mode).
+                 SetSpectrumClock(m_spectrum_clock).
+                 SetEdges(demodulator.GetEdges()).
+                 SetStopAddress(m_turboblocks.IsStayingInLoader() ? 0 : m_usr_address).
+                 SetStopWhenReturnToBasic(!m_turboblocks.IsStayingInLoader()).      // else waits for next program
+                 Run().
+                 DebugDump();
+        if (!emulator.IsOk())
+        {
+            throw std::runtime_error("Emulation failed: loading did not complete as expected");
+        }
+        if (!m_turbo_filename.empty())
+        {
+            auto differ = emulator.CompareMemory(WithoutNotAsSource(LoadSourceMemory()));
+            if (differ != 0)
+            {
+                throw std::runtime_error("Emulation failed: " + std::to_string(differ) + " bytes of memory differ from " + m_turbo_filename.string());
+            }
+        }
     }
 
     /// Only used for fun attributes and video fun.
@@ -198,6 +308,13 @@ public:
         m_turboblocks.MoveToLoader(m_spectrumloader, true, p_load_address);
     }
 
+    /// Only used for video fun.
+    void AddFrame(MemoryBlock p_frame, uint16_t p_load_address, std::chrono::milliseconds p_max_duration)
+    {
+        m_turboblocks.AddFrameAsTurboBlocks(std::move(p_frame), p_load_address, p_max_duration);
+        m_turboblocks.MoveToLoader(m_spectrumloader, true, p_load_address);
+    }
+
     /// Stop/cancel playing immidiately
     /// Keeps preloaded state
     /// Can cause tape loading error when not calling WaitUntilDone first.
@@ -217,9 +334,11 @@ public:
     {
         auto onDone = std::move(m_OnDone);  // keep call back
         auto exe_path = std::move(m_exe_path);
+        auto session = std::move(m_session);    // keep session
         SampleSender remove = std::move(m_sample_sender);   // <- Because else move assign causes problems. Dtor target not called. So ma_device_uninit not called.
         *this = Impl();
         m_exe_path = std::move(exe_path);
+        m_session = std::move(session);
         m_OnDone = std::move(onDone);
     }
 
@@ -285,6 +404,7 @@ private:
             m_time_needed = GetCurrentTime();
             std::cout << "Took: " << std::dec << m_time_needed.count() << " ms" << std::endl;
             m_is_busy = false;
+            SaveSession();
         }
         if(m_OnDone)
         {
@@ -384,19 +504,86 @@ private:
     }
 
     // Add/load zqloader.tap (to turboblocks) when not already done so.
+    // When resident at the ZX Spectrum (session) with same parameters only its symbols are needed.
     // throws when p_filename is not zqloader or could not be found/
     void AddZqLoader(const fs::path &p_filename)
     {
-        if(!m_is_preloaded && !m_turboblocks.IsZqLoaderAdded())
+        if(!m_is_preloaded && !m_turboblocks.IsZqLoaderAdded() && !m_turboblocks.IsZqLoaderResident())
         {
             auto filename = FindZqLoaderTapfile(p_filename);
-            m_turboblocks.AddZqLoader(filename);                 // zqloader.tap
+            m_loader_parameters = { fs::weakly_canonical(filename), m_bit_loop_max, m_zero_max, m_io_init_value, m_io_xor_value };
+            m_was_resident = m_session.IsResident(m_loader_parameters);
+            if(m_was_resident && m_session.IsStarted() && !m_returned_to_basic)
+            {
+                // Program might have overwritten zqloader or memory as send.
+                std::cout << "Session: program started last time was not confirmed to have returned to BASIC (returned), sending all." << std::endl;
+                m_was_resident = false;
+            }
+            if(m_was_resident)
+            {
+                m_turboblocks.SetZqLoaderResident(filename);
+                if(m_delta && !m_session.GetImage().IsEmpty())
+                {
+                    m_turboblocks.SetDeltaBase(m_session.GetImage());
+                }
+            }
+            else
+            {
+                if(m_session.IsResident())
+                {
+                    std::cout << "Session: resident zqloader has other parameters, sending it again." << std::endl;
+                }
+                if(m_delta)
+                {
+                    std::cout << "Delta: zqloader not resident, sending all." << std::endl;
+                }
+                m_turboblocks.AddZqLoader(filename);                 // zqloader.tap
+            }
+        }
+    }
+
+    // When all was send: zqloader still at the ZX Spectrum (so resident)?
+    // With delta the started program is expected to return to BASIC leaving zqloader alone;
+    // as only the user knows that, next time it needs to be confirmed (SetReturnedToBasic).
+    // Then also remember memory as send, to send only changes next time.
+    // Only after playing audio, others do not reach a ZX Spectrum.
+    void SaveSession()
+    {
+        if(m_action == Action::play_audio && m_session.IsSet())
+        {
+            bool is_resident = !m_loader_parameters.m_filename.empty() &&       // zqloader was send or resident
+                               (m_turboblocks.IsZqLoaderKept() || (m_delta && m_turboblocks.IsZqLoaderIntact()));
+            bool is_started  = is_resident && !m_turboblocks.IsZqLoaderKept();     // delta and machine code started
+            std::cout << "Session: zqloader " << (is_resident ? "stays resident" : "is not resident anymore") << std::endl;
+            if(is_started)
+            {
+                std::cout << "<b>Session: zqloader and memory as send are only used again when the program returns to BASIC "
+                             "without overwriting them: then confirm with 'returned'. Memory the program changed itself "
+                             "while running is not send again.</b>" << std::endl;
+            }
+            auto &image = m_session.GetImage();
+            if(!is_resident || !m_was_resident)
+            {
+                image.Clear();          // not known (anymore)
+            }
+            if(is_resident)
+            {
+                image.Apply(LoadSourceMemory());
+            }
+            m_session.SetResident(is_resident, m_loader_parameters).SetStarted(is_started).Save();
         }
     }
 
     void AddTurboSpeedFile(const fs::path &p_filename, const std::string &p_zxfilename)
     {
-        if (ToLower(p_filename.extension().string()) == ".tap")
+        if (m_capture && (ToLower(p_filename.extension().string()) == ".tap" ||
+                          ToLower(p_filename.extension().string()) == ".tzx"))
+        {
+            m_turbo_filename = CaptureSnapshot(p_filename);     // whole tape, as the program loads it
+            std::cout << "Processing captured snapshot file: " << m_turbo_filename << " (turbo speed)" << std::endl;
+            AddSnapshotToTurboBlocks(m_turbo_filename);
+        }
+        else if (ToLower(p_filename.extension().string()) == ".tap")
         {
             std::cout << "Processing tap file: " << p_filename << " (turbo speed)" << std::endl;
             AddFileToTurboBlocks<TapLoader>(p_filename, p_zxfilename);
@@ -417,9 +604,9 @@ private:
         {
             // reserved for Test
             extern uint16_t Test(TurboBlocks & p_blocks, const fs::path &p_filename);
-            auto adr = Test(m_turboblocks, p_filename);
+            m_usr_address = Test(m_turboblocks, p_filename);
             AddZqLoader(m_normal_filename);
-            m_turboblocks.Finalize(adr);
+            m_turboblocks.Finalize(m_usr_address);
         }
         else if(!p_filename.empty())
         {
@@ -451,10 +638,10 @@ private:
         {
             std::cout << "<b>Warning: Number of found code blocks (" << m_turboblocks.size() << ") not equal to LOAD \"\" CODE statements in BASIC (" << tab_to_turbo_blocks.GetNumberLoadCode() << ")!</b>\n" << std::endl;
         }
-        auto size = m_turboblocks.Finalize(m_when_done_return_to_basic ? 0 :
-                                           m_when_done_call_usr == 0 ? tab_to_turbo_blocks.GetUsrAddress() :
-                                           m_when_done_call_usr,
-                                           tab_to_turbo_blocks.GetClearAddress());
+        m_usr_address = m_when_done_return_to_basic ? 0 :
+                        m_when_done_call_usr == 0 ? tab_to_turbo_blocks.GetUsrAddress() :
+                        m_when_done_call_usr;
+        auto size = m_turboblocks.Finalize(m_usr_address, tab_to_turbo_blocks.GetClearAddress());
         if(size == 0)
         {
             throw std::runtime_error("No blocks present in file: '" + p_filename.string() + "' that could be turboloaded (note: can only handle code blocks, not BASIC)");
@@ -476,7 +663,149 @@ private:
         snapshot_regs_filename.replace_extension("bin");
         DataBlock regblock = LoadFromFile(snapshot_regs_filename);
         snapshotloader.SetRegBlock(std::move(regblock)).MoveToTurboBlocks(m_turboblocks, m_new_loader_location, m_use_fun_attribs);
-        m_turboblocks.Finalize(snapshotloader.GetUsrAddress(), 0, snapshotloader.GetLastOut7ffd());
+        m_usr_address = snapshotloader.GetUsrAddress();
+        m_turboblocks.Finalize(m_usr_address, 0, snapshotloader.GetLastOut7ffd());
+        auto loader_location = snapshotloader.GetLoaderLocation();
+        m_not_as_source.emplace_back(loader_location, loader_location + m_turboblocks.GetLoaderCodeLength(true));
+        if (m_use_fun_attribs)
+        {
+            m_not_as_source.emplace_back(spectrum::screen::ATTR_23RD, spectrum::screen::ATTR_23RD + 256);
+        }
+    }
+
+
+
+    // Load given tap/tzx file as from tape (pulse timings as at the file) at an emulated ZX Spectrum with ROM,
+    // so including loading done by the program itself (custom loaders, headerless blocks, loading after USR).
+    // When the game started write a snapshot (path/to/name_capture.sna); returns its filename.
+    fs::path CaptureSnapshot(const fs::path &p_filename) const
+    {
+        if (m_rom_filename.empty())
+        {
+            throw std::runtime_error("Capture needs a ROM image, please give rom=\"path/to/48.rom\"");
+        }
+        std::cout << "Capturing: " << p_filename << " (loading at emulated ZX Spectrum)" << std::endl;
+        // Edges with the pulse timings as at the file, so custom (turbo) blocks load as from tape.
+        // Tzx T-states are at 3.5Mhz.
+        auto edges = TapeEdges().Load(p_filename).GetEdges();
+        for (auto &edge : edges)
+        {
+            edge = edge * m_spectrum_clock / spectrum::spectrum_clock;
+        }
+        SpectrumEmulator emulator;
+        emulator.SetRom(m_rom_filename).
+                 Set128K(fs::file_size(m_rom_filename) > 16384).
+                 SetSpectrumClock(m_spectrum_clock).
+                 SetEdges(std::move(edges)).
+                 SetStopAddress(m_capture_address).
+                 SetStopWhenReturnToBasic(false).
+                 SetTimeout(m_capture_time).
+                 Run().
+                 DebugDump();
+        if (m_capture_address != 0 && !emulator.IsDone())
+        {
+            throw std::runtime_error("Capture failed: game did not start (PC did not reach " + std::to_string(m_capture_address) + ")");
+        }
+        constexpr int max_ula_reads = 200;     // per frame: more is a loader waiting for an edge, not a game
+        if (m_capture_address == 0 &&
+            (emulator.GetPc() < spectrum::RAM_START || emulator.GetUlaReadsLastFrame() > max_ula_reads))
+        {
+            // still in ROM (eg waiting for LOAD), or a loader still waiting for an edge
+            throw std::runtime_error("Capture failed: game did not start " + std::to_string(int(m_capture_time.count() * 1000)) +
+                                     "ms after the end of the tape (PC = " + std::to_string(emulator.GetPc()) +
+                                     (emulator.GetUlaReadsLastFrame() > max_ula_reads ? ", still loading" : "") +
+                                     "); please give capture_pc=xxxx or a longer capture_time");
+        }
+        auto filename = p_filename;
+        filename.replace_filename(p_filename.stem().string() + "_capture.sna");
+        std::ofstream filewrite = OpenFileToWrite(filename, m_allow_overwrite);
+        emulator.WriteSnapshot(filewrite);
+        std::cout << "Written " << filename << std::endl;
+        return filename;
+    }
+
+
+
+    // Memory as it should be after loading the turbo file:
+    // the snapshot RAM, or the code blocks at a tap/tzx file.
+    MemoryBlocks LoadSourceMemory() const
+    {
+        auto extension = ToLower(m_turbo_filename.extension().string());
+        if (extension == ".z80" || extension == ".sna")
+        {
+            return SnapShotLoader().Load(m_turbo_filename).GetRam();
+        }
+        if (extension == ".tap")
+        {
+            return LoadCodeBlocks<TapLoader>(m_turbo_filename);
+        }
+        if (extension == ".tzx")
+        {
+            return LoadCodeBlocks<TzxLoader>(m_turbo_filename);
+        }
+        return {};
+    }
+
+
+
+    // Given blocks without the parts at m_not_as_source (not at 128K banks).
+    MemoryBlocks WithoutNotAsSource(MemoryBlocks p_blocks) const
+    {
+        for (auto [start, end] : m_not_as_source)
+        {
+            MemoryBlocks retval;
+            for (auto &block : p_blocks)
+            {
+                if (block.m_bank < 0 && block.GetStartAddress() < end && block.GetEndAddress() > start)
+                {
+                    auto [before, skip, after] = SplitBlock3(block, std::max(start, block.GetStartAddress()), std::min(end, block.GetEndAddress()));
+                    for (auto *part : { &before, &after })
+                    {
+                        if (part->size() > 0)
+                        {
+                            retval.push_back(std::move(*part));
+                        }
+                    }
+                }
+                else
+                {
+                    retval.push_back(std::move(block));
+                }
+            }
+            p_blocks = std::move(retval);
+        }
+        return p_blocks;
+    }
+
+
+
+    // Get all code blocks (with their header start address) from given tap/tzx file.
+    // TLoader is TapLoader or TzxLoader
+    template<class Tloader>
+    static MemoryBlocks LoadCodeBlocks(const fs::path &p_filename)
+    {
+        using namespace spectrum;
+        MemoryBlocks retval;
+        TapeHeader header{};
+        bool have_code_header = false;
+        Tloader tap_or_tzx_loader;
+        tap_or_tzx_loader.SetOnHandleTapBlock([&](DataBlock p_block, std::string)
+                                              {
+                                                  if (p_block.size() >= sizeof(TapeHeader) + 2 && p_block[0] == std::byte(TapeBlockType::header))
+                                                  {
+                                                      std::copy(p_block.begin() + 1, p_block.begin() + 1 + sizeof(TapeHeader), reinterpret_cast<std::byte*>(&header));
+                                                      have_code_header = header.m_type == TapeHeader::Type::code;
+                                                  }
+                                                  else if (p_block.size() >= 2 && p_block[0] == std::byte(TapeBlockType::data) && have_code_header)
+                                                  {
+                                                      retval.push_back({ DataBlock(p_block.begin() + 1, p_block.end() - 1), header.m_start_address });
+                                                      have_code_header = false;
+                                                  }
+                                                  return false;
+                                              }
+                                              );
+        tap_or_tzx_loader.Load(p_filename, "");
+        return retval;
     }
 
 
@@ -484,7 +813,7 @@ private:
     // Add given file (tap/tzx) to given SpectrumLoader so uses normal speed
     // TLoader is TapLoader or TzxLoader
     template<class Tloader>
-    void AddNormalSpeedFile(const fs::path &p_filename, SpectrumLoader &p_spectrum_loader, const std::string &p_zxfilename)
+    static void AddNormalSpeedFile(const fs::path &p_filename, SpectrumLoader &p_spectrum_loader, const std::string &p_zxfilename)
     {
         Tloader tap_or_tzx_loader;
         tap_or_tzx_loader.SetOnHandleTapBlock([&](DataBlock p_block, std::string)
@@ -565,6 +894,19 @@ public:
     bool                                    m_is_preloaded = false;
     DoneFun                                 m_OnDone;
     std::chrono::milliseconds               m_time_needed{};
+    int                                     m_bit_loop_max        = 0;     // 0 = default
+    int                                     m_zero_max            = 0;     // 0 = default
+    fs::path                                m_rom_filename;                // for Action::emulate, empty: no ROM; and capture
+    bool                                    m_capture = false;
+    uint16_t                                m_capture_address = 0;         // game started when PC here; 0: use time
+    Doublesec                               m_capture_time = 2s;           // when m_capture_address 0: run this long after tape
+    int                                     m_io_init_value       = loader_defaults::io_init_value;
+    int                                     m_io_xor_value        = loader_defaults::io_xor_value;
+    LoaderSession                           m_session;                     // when set: keeps track of zqloader resident at ZX Spectrum
+    LoaderParameters                        m_loader_parameters;           // zqloader as send or resident
+    bool                                    m_was_resident        = false;     // zqloader was resident before this program
+    bool                                    m_delta               = false;     // send only changes, see SetDelta
+    bool                                    m_returned_to_basic   = false;     // see SetReturnedToBasic
 
 private:
 
@@ -577,7 +919,10 @@ private:
     fs::path                                m_output_filename;             // writing wav or tzx
 
     bool                                    m_128_mode = false;
+    uint16_t                                m_usr_address = 0;             // as given to Finalize; 0 return to BASIC
+    std::vector<std::pair<int, int>>        m_not_as_source;               // [start, end) memory differs from turbo file after loading: loader at a snapshot
     bool                                    m_from_dialog;
+    int                                     m_spectrum_clock      = spectrum::spectrum_clock;
 
     std::chrono::steady_clock::time_point   m_start_time{};
 }; // class ZQLoader::Impl
@@ -637,6 +982,7 @@ ZQLoader& ZQLoader::SetSampleRate(uint32_t p_sample_rate)
 
 ZQLoader& ZQLoader::SetBitLoopMax(int p_value)
 {
+    m_pimpl->m_bit_loop_max = p_value;
     m_pimpl->m_turboblocks.SetBitLoopMax(p_value);
     return *this;
 }
@@ -645,12 +991,15 @@ ZQLoader& ZQLoader::SetBitLoopMax(int p_value)
 
 ZQLoader& ZQLoader::SetZeroMax(int p_value)
 {
+    m_pimpl->m_zero_max = p_value;
     m_pimpl->m_turboblocks.SetZeroMax(p_value);
     return *this;
 }
 
 ZQLoader& ZQLoader::SetIoValues(int p_io_init_value, int p_io_xor_value)
 {
+    m_pimpl->m_io_init_value = p_io_init_value;
+    m_pimpl->m_io_xor_value  = p_io_xor_value;
     m_pimpl->m_turboblocks.SetIoValues(p_io_init_value, p_io_xor_value);
     return *this;
 }
@@ -683,6 +1032,12 @@ ZQLoader& ZQLoader::SetInitialWait(std::chrono::milliseconds p_initial_wait)
     return *this;
 }
 
+ZQLoader& ZQLoader::SetSkipPilots(bool p_to_what)
+{
+    m_pimpl->m_turboblocks.SetSkipPilots(p_to_what);
+    return *this;
+}
+
 
 ZQLoader& ZQLoader::SetSpectrumClock(int p_spectrum_clock)
 {
@@ -702,6 +1057,11 @@ ZQLoader& ZQLoader::SetAction(Action p_what)
     return *this;
 }
 
+ZQLoader::Action ZQLoader::GetAction() const
+{
+    return m_pimpl->m_action;
+}
+
 
 
 ZQLoader& ZQLoader::SetLoaderCopyTarget(uint16_t p_address)
@@ -741,6 +1101,34 @@ ZQLoader& ZQLoader::SetWhenDoneDo(uint16_t p_value, bool p_return_to_basic)
 }
 
 
+ZQLoader& ZQLoader::SetWhenDoneStayInLoader(bool p_to_what)
+{
+    m_pimpl->m_turboblocks.SetWhenDoneStayInLoader(p_to_what);
+    return *this;
+}
+
+
+ZQLoader& ZQLoader::SetDelta(bool p_to_what)
+{
+    m_pimpl->m_delta = p_to_what;
+    return *this;
+}
+
+
+ZQLoader& ZQLoader::SetReturnedToBasic(bool p_to_what)
+{
+    m_pimpl->m_returned_to_basic = p_to_what;
+    return *this;
+}
+
+
+ZQLoader& ZQLoader::SetSessionFilename(const fs::path &p_filename)
+{
+    m_pimpl->m_session.SetFilename(p_filename);
+    return *this;
+}
+
+
 ZQLoader& ZQLoader::Reset()
 {
     m_pimpl->Reset();
@@ -813,6 +1201,46 @@ ZQLoader& ZQLoader::PlayleaderTone()
 }
 
 
+
+ZQLoader& ZQLoader::OptimizeTimings(int p_safety_margin)
+{
+    m_pimpl->OptimizeTimings(p_safety_margin);
+    return *this;
+}
+
+
+
+ZQLoader& ZQLoader::SetRomFilename(const fs::path &p_filename)
+{
+    m_pimpl->m_rom_filename = p_filename;
+    return *this;
+}
+
+
+
+ZQLoader& ZQLoader::SetCapture(uint16_t p_started_address, std::chrono::milliseconds p_run_after_tape)
+{
+    m_pimpl->m_capture         = true;
+    m_pimpl->m_capture_address = p_started_address;
+    m_pimpl->m_capture_time    = p_run_after_tape;
+    return *this;
+}
+
+
+
+ZQLoader& ZQLoader::VerifyWavFile(const fs::path &p_filename)
+{
+    std::ifstream fileread(p_filename, std::ios::binary);
+    if (!fileread)
+    {
+        throw std::runtime_error("Could not open file " + p_filename.string() + " for reading");
+    }
+    std::cout << "Verifying WAV file: " << p_filename << std::endl;
+    m_pimpl->Verify(fileread);
+    return *this;
+}
+
+
 // Time last action took
 std::chrono::milliseconds ZQLoader::GetTimeNeeded() const
 {
@@ -836,6 +1264,12 @@ int ZQLoader::GetDurationInTStates() const
     return m_pimpl->m_spectrumloader.GetDurationInTStates();
 }
 
+std::chrono::microseconds ZQLoader::GetQueuedDuration() const
+{
+    const auto &loader = m_pimpl->m_spectrumloader;
+    return std::chrono::duration_cast<std::chrono::microseconds>(loader.GetDurationInTStates() * loader.GetTstateDuration());
+}
+
 /// path to current zqloader.exe (this program)
 /// (only to help find zqloader.tap)
 ZQLoader &ZQLoader::SetExeFilename(fs::path p_filename)
@@ -869,6 +1303,14 @@ ZQLoader& ZQLoader::AddMemoryBlock(MemoryBlock p_block, uint16_t p_load_address)
     return *this;
 }
 
+
+
+ZQLoader& ZQLoader::AddFrame(MemoryBlock p_frame, uint16_t p_load_address, std::chrono::milliseconds p_max_duration)
+{
+    m_pimpl->AddFrame(std::move(p_frame), p_load_address, p_max_duration);
+    return *this;
+}
+
 // static
 bool ZQLoader::WriteTextToAttr(DataBlock& out_attr, const std::string& p_text, std::byte p_color, bool p_center, int p_col)
 {
@@ -48,6 +48,8 @@ public:
         play_audio,
         write_wav,
         write_tzx,
+        verify,         // render as wav (in memory) then demodulate that, see TurboDemodulator
+        emulate,        // render as wav (in memory) then load that at an emulated ZX Spectrum, see SpectrumEmulator
     };
     enum class LoaderLocation
     {
@@ -95,6 +97,9 @@ public:
     ///  Set time to wait after ZQLoader was loaded
     ZQLoader& SetInitialWait(std::chrono::milliseconds p_initial_wait);
 
+    /// Chain turbo blocks: only first has a full pilot tone, others a short resync.
+    ZQLoader& SetSkipPilots(bool p_to_what);
+
     /// Set clock frequency in hz
     ZQLoader& SetSpectrumClock(int p_spectrum_clock);
 
@@ -106,6 +111,9 @@ public:
     /// Play sound/ or write wav file/ or write tzx file.
     ZQLoader& SetAction(Action p_what);
 
+    /// What to do (on Run/Start), see SetAction.
+    Action GetAction() const;
+
     /// Address where to put loader when loading snapshot or when overwriting BASIC.
     /// When <>0 always move loader to that location.
     ZQLoader &SetLoaderCopyTarget(uint16_t p_address);
@@ -119,6 +127,32 @@ public:
     /// Dont call machine code (USR) at end of loading, return to BASIC instead
     ZQLoader& SetWhenDoneDo(uint16_t p_usr_address, bool p_return_to_basic );
 
+    /// When done loading do not start machine code or return to BASIC, but stay in the
+    /// loader, waiting for the next program. (Only when the loader is not overwritten.)
+    /// Call before setting files.
+    ZQLoader& SetWhenDoneStayInLoader(bool p_to_what);
+
+    /// Session mode: keep track (in given file) of zqloader being resident at the ZX Spectrum
+    /// over multiple runs. When resident (with same parameters) zqloader.tap is not send again,
+    /// only the turbo blocks. It stays resident when, after playing, the loader is intact and
+    /// waits for the next program (SetWhenDoneStayInLoader) or returned to BASIC (then type RUN).
+    /// Call before setting files, after setting loader parameters (eg bit_loop_max).
+    ZQLoader& SetSessionFilename(const std::filesystem::path &p_filename);
+
+    /// Delta (needs session): when zqloader is resident send only what changed compared to
+    /// the memory as send before during the session, then start (USR) as usual.
+    /// Zqloader then stays resident also after starting machine code, which is expected to
+    /// return to BASIC (then type RUN) leaving zqloader (BASIC) alone; next time that needs
+    /// to be confirmed (SetReturnedToBasic) else all is send again.
+    /// Note memory changed by the program itself while running is not send again.
+    /// Call before setting files.
+    ZQLoader& SetDelta(bool p_to_what);
+
+    /// Session: confirm the program started last time returned to BASIC without overwriting
+    /// zqloader or memory as send (at the ZX Spectrum nothing checks that), see SetDelta.
+    /// Call before setting files.
+    ZQLoader& SetReturnedToBasic(bool p_to_what);
+
     ///  Reset, stop, wipe all added data (files)
     ZQLoader& Reset();
 
@@ -142,12 +176,46 @@ public:
     // Was zqloader.tap added to be preloaded?
     bool IsPreLoaded() const;
     
+    /// Search the fastest zero/one durations, zero_max and bit_loop_max that still load
+    /// with at least given safety margin (T-states) at sample rate and clock as set.
+    /// Applies these and shows them as command line options. See TimingOptimizer.
+    /// Call before setting files.
+    ZQLoader &OptimizeTimings(int p_safety_margin);
+
+    /// Demodulate given WAV file using a model of the zqloader turbo loader.
+    /// Reports blocks found and timing margins. Uses bit_loop_max/zero_max/clock as set.
+    /// Throws when not all blocks could be loaded.
+    ZQLoader &VerifyWavFile(const std::filesystem::path &p_filename);
+
+    /// Set ROM image used with Action::emulate and SetCapture (16K 48K ROM or 32K 128K ROMs).
+    /// When not set the emulator starts the loader directly, without ROM (not with SetCapture).
+    ZQLoader &SetRomFilename(const std::filesystem::path &p_filename);
+
+    /// Capture a tap/tzx turbo file: load it at normal speed at an emulated ZX Spectrum
+    /// (needs the ROM), including its own (custom/headerless) loading, until the game started.
+    /// The tape is played with the pulse timings as at the file (eg custom turbo blocks).
+    /// Then writes a .sna snapshot which is turbo loaded instead.
+    /// Game started is when PC reaches p_started_address, or (when 0) p_run_after_tape
+    /// after the end of the tape, when the PC is outside ROM and not (by the rate it reads
+    /// port 0xfe) still at a loader. Throws when the game did not start.
+    /// Call before setting files.
+    ZQLoader &SetCapture(uint16_t p_started_address, std::chrono::milliseconds p_run_after_tape);
+
     /// Play an infinite leader tone for tuning.
     ZQLoader &PlayleaderTone();
 
     /// Only used for fun attributes
     ZQLoader &AddMemoryBlock(MemoryBlock p_block, uint16_t p_load_address = 0);
 
+    /// Only used for video fun: add a frame (eg all attributes). Only what changed since the
+    /// previous frame is send, as blocks scattered by the loader; all of it when
+    /// first frame or when most changed (scene cut). Frames are chained: no full pilot.
+    /// Frames are forgotten at Stop.
+    /// p_max_duration: when not 0 send no more than takes about this long (frame budget);
+    /// what did not fit is send with the next frame(s). For a full screen (pixels plus
+    /// attributes at SCREEN_START) the cells with most visual error go first, see CellSelector.
+    ZQLoader &AddFrame(MemoryBlock p_frame, uint16_t p_load_address = 0, std::chrono::milliseconds p_max_duration = {});
+
     /// Time at end so actual time needed once done.
     std::chrono::milliseconds GetTimeNeeded() const;
     
@@ -161,6 +229,10 @@ public:
     /// Get time in TStates.
     int GetDurationInTStates() const;
 
+    /// Time it takes to send what is at the loader now, without margin.
+    /// Eg right after AddFrame (from OnDone): exact airtime of that frame.
+    std::chrono::microseconds GetQueuedDuration() const;
+
     /// path to current zqloader.exe (this program)
     /// (only to help find zqloader.tap)
     ZQLoader& SetExeFilename(std::filesystem::path p_filename);
@@ -36,6 +36,7 @@ constexpr const char *DefaultZxFilename = "[Optional first name as in LOAD \"som
 constexpr const char *DefaultTurboFilename = "[Select a file to speed load here, a game for example.]";
 constexpr const char *DefaultOutputFilename = "[To write an output file instead of playing sound enter a .wav or .tzx output file here. Leave empty for normal usage (playing audio)]";
 constexpr const char *DefaultVideoFile = "[To have 'live' (...) video on ZX spectrum. Enter a filename here or 'camera' for webcam.]";
+constexpr double DefaultVideoFps = 5.0;        // video fun: frames per second to send at most, see FrameScheduler
 constexpr const char *DefaultImageDir = "[To have images as dia show on ZX spectrum. Not working yet.]";
 
 inline void MakeBlack(QLineEdit *p_line_edit)
@@ -492,6 +493,7 @@ inline void Dialog::OnDone()
         try
         {
             ui->zxvideo->Play(ui->lineEditVideoFile->text().toStdString());
+            m_frame_scheduler.Reset();                                  // target fps set at Go
             m_state = State::VideoFunNext;
         }
         catch(const std::exception &e)
@@ -503,16 +505,30 @@ inline void Dialog::OnDone()
     }
     else if( m_state == State::VideoFunNext)
     {
-        Attributes all_attr = ui->zxvideo->GetAttributes();
-        // cast Attributes -> to DataBlock
-        auto* raw = reinterpret_cast<std::byte*>(all_attr.data());
-        DataBlock attrs(raw, raw + all_attr.size());
-        if(attrs.size() == spectrum::screen::ATTR_SIZE)
+        m_frame_scheduler.OnFrameShown(FrameScheduler::Clock::now());   // previous frame is loaded
+        if(m_frame_scheduler.IsReportDue())
         {
-            m_zqloader.SetCompressionType(CompressionType::automatic);
-            m_zqloader.AddMemoryBlock({std::move(attrs), spectrum::screen::ATTR_BEGIN}, 40000);
+            // log at ui thread, not here at miniaudio thread
+            QMetaObject::invokeMethod(this, [report = m_frame_scheduler.GetReport()]
+            {
+                std::cout << report << std::endl;
+            });
         }
-        
+        const VideoFrame &frame = ui->zxvideo->GetFrame();              // already converted, does not wait
+        if(!frame.m_attributes.empty())
+        {
+            const Attributes &all_attr = frame.m_attributes;
+            // cast Attributes -> to DataBlock
+            auto* raw = reinterpret_cast<const std::byte*>(all_attr.data());
+            DataBlock attrs(raw, raw + all_attr.size());
+            if(attrs.size() == spectrum::screen::ATTR_SIZE)
+            {
+                m_zqloader.SetCompressionType(CompressionType::automatic);
+                m_zqloader.AddFrame({std::move(attrs), spectrum::screen::ATTR_BEGIN}, 40000, m_frame_scheduler.GetFrameBudget());     // only what changed
+                m_frame_scheduler.OnFrameSend(frame.m_capture_time, m_zqloader.GetQueuedDuration());
+            }
+        }
+
     }
     else if( m_state == State::ImageFun)
     {
@@ -590,6 +606,8 @@ inline void Dialog::RestoreDefaults()
     ui->comboBoxLoaderLocation->setCurrentIndex(0);     // automatic.
     ui->lineEditLoaderAddress->setText(QString::number(spectrum::screen::SCREEN_23RD));
 
+    ui->lineEditVideoFps->setText(QString::number(DefaultVideoFps));
+
     ui->lineEditSampleRate->setText("");
     ui->lineEditSampleRate->signalFocusOut();       // also gives correct tip-text
     // no defaults for volume
@@ -644,6 +662,7 @@ inline void Dialog::Go()
                 fs::path filename1 = ui->lineEditNormalFile->text().toStdString();
                 m_zqloader.SetNormalFilename(filename1).SetPreload();       // should be zqloader or empty
                 SetZqLoaderParameters();
+                m_frame_scheduler.SetTargetFps(ui->lineEditVideoFps->text().toDouble());   // here: not at miniaudio thread
                 m_zqloader.Start();
                 if(!video_url.empty() && video_url[0] != '[')
                 {
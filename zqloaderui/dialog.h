@@ -12,6 +12,7 @@
 
 #include <QDialog>
 #include <zqloader.h>
+#include "framescheduler.h"
 //#include "zxvideo.h"
 
 
@@ -68,6 +69,7 @@ private:
     Ui::Dialog *ui;
     ZQLoader m_zqloader;
     State m_state;
+    FrameScheduler m_frame_scheduler;       // video fun
 //    ZxVideo m_zxvideo;
 };
 
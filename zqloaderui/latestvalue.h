@@ -0,0 +1,63 @@
+//==============================================================================
+// PROJECT:         zqloader
+// FILE:            latestvalue.h
+// DESCRIPTION:     Definition of template class LatestValue
+//
+// Copyright (c) 2026 Daan Scherft [Oxidaan]
+// This project uses the MIT license. See LICENSE.txt for details.
+//==============================================================================
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <utility>
+
+
+/// Slot holding the latest value given by one (producer) thread, to be taken by
+/// one other (consumer) thread, eg a real time (audio) thread.
+/// Lock free: a triple buffer, producer and consumer each own one of three values,
+/// the third (middle) is swapped using a single atomic exchange.
+/// Consumer never waits and never (de)allocates: values are moved into
+/// their slot and freed at the producer.
+/// Values not taken before a newer one is set are dropped.
+template <class T>
+class LatestValue
+{
+public:
+
+    /// Producer: publish given value, replacing any value not taken yet.
+    void Set(T p_value)
+    {
+        m_slots[m_back] = std::move(p_value);
+        m_back = m_middle.exchange(m_back | fresh, std::memory_order_acq_rel) & index_mask;
+    }
+
+    /// Consumer: is a value set that was not taken yet?
+    bool IsNew() const
+    {
+        return m_middle.load(std::memory_order_acquire) & fresh;
+    }
+
+    /// Consumer: take latest value, or the one taken before when nothing new.
+    /// (Default constructed T when nothing was ever set.)
+    /// Reference stays valid until next Get.
+    const T& Get()
+    {
+        if (IsNew())
+        {
+            m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & index_mask;
+        }
+        return m_slots[m_front];
+    }
+
+private:
+
+    static constexpr int fresh      = 4;       // bit at m_middle: set, not taken yet
+    static constexpr int index_mask = 3;
+
+    std::array<T, 3>  m_slots{};
+    int               m_back   = 0;            // owned by producer
+    std::atomic<int>  m_middle = 1;
+    int               m_front  = 2;            // owned by consumer
+}; // class LatestValue
@@ -19,6 +19,7 @@
 #include <QMediaCaptureSession>
 #include <QMediaDevices>
 #include <iostream>
+#include <algorithm>
 
 namespace fs = std::filesystem;
 
@@ -135,19 +136,197 @@ public:
     }
 
 
-    // Get last frame as QImage
-    QImage GetImage() const
+    // Get last frame as QImage, scaled to given (small) size.
+    // Box filter straight from the planes of the frame as received (eg YUV), so
+    // no conversion of the full frame to RGB.
+    // Mirrored frames (eg front camera) are mirrored after scaling.
+    QImage GetImage(int p_width, int p_height) const
     {
-        if( m_frame_received )
+        if( !m_frame_received )
         {
-            return m_frame.toImage();
+            return QImage{};
         }
-        return QImage{};
+        QVideoFrame frame = m_frame;            // shared, not copied
+        if( !IsTransformed(frame) && frame.map(QVideoFrame::ReadOnly) )
+        {
+            QImage image = Downscale(frame, p_width, p_height);
+            frame.unmap();
+            if( !image.isNull() )
+            {
+                return frame.mirrored() ? image.mirrored(true, false) : image;
+            }
+        }
+        // other pixel formats, rotated, upside down
+        return m_frame.toImage().scaled(p_width, p_height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
     }
 
 
 
 
+private:
+
+    // Is given frame to be shown other than as its planes are: rotated, or stored
+    // upside down or mirrored at the surface. Then Downscale can not be used: leave
+    // that to QVideoFrame::toImage. (Mirrored at frame is handled at GetImage.)
+    static bool IsTransformed(const QVideoFrame &p_frame)
+    {
+#if QT_VERSION >= QT_VERSION_CHECK(6, 7, 0)
+        bool is_rotated = p_frame.rotation() != QtVideo::Rotation::None;
+#else
+        bool is_rotated = p_frame.rotationAngle() != QVideoFrame::Rotation0;
+#endif
+        return is_rotated ||
+               p_frame.surfaceFormat().isMirrored() ||
+               p_frame.surfaceFormat().scanLineDirection() != QVideoFrameFormat::TopToBottom;
+    }
+
+    // Scale given mapped frame to given size: average of the source pixels covering each
+    // destination pixel, read straight from its planes.
+    // YUV is averaged first, then converted to RGB (once per destination pixel).
+    // Null image when pixel format is not supported here.
+    static QImage Downscale(const QVideoFrame &p_frame, int p_width, int p_height)
+    {
+        int width  = p_frame.width();
+        int height = p_frame.height();
+        const uchar *plane0 = p_frame.bits(0);
+        const uchar *plane1 = p_frame.planeCount() > 1 ? p_frame.bits(1) : nullptr;
+        const uchar *plane2 = p_frame.planeCount() > 2 ? p_frame.bits(2) : nullptr;
+        int stride0 = p_frame.bytesPerLine(0);
+        int stride1 = p_frame.planeCount() > 1 ? p_frame.bytesPerLine(1) : 0;
+        int stride2 = p_frame.planeCount() > 2 ? p_frame.bytesPerLine(2) : 0;
+        auto format = p_frame.surfaceFormat();
+        auto ToRgb  = [bt709      = format.colorSpace() == QVideoFrameFormat::ColorSpace_BT709,
+                       full_range = format.colorRange() == QVideoFrameFormat::ColorRange_Full](int y, int u, int v)
+        {
+            return YuvToRgb(y, u, v, bt709, full_range);
+        };
+        // 4 bytes per pixel: offsets of red, green and blue
+        auto Packed = [&](int p_red, int p_green, int p_blue)
+        {
+            return BoxFilter(width, height, p_width, p_height, [&](int x, int y, int *out_sum)
+            {
+                const uchar *pixel = plane0 + y * stride0 + 4 * x;
+                out_sum[0] += pixel[p_red];
+                out_sum[1] += pixel[p_green];
+                out_sum[2] += pixel[p_blue];
+            }, [](int r, int g, int b)
+            {
+                return qRgb(r, g, b);
+            });
+        };
+        // Y plane, plus interleaved U and V at half resolution
+        auto SemiPlanar = [&](int p_u, int p_v)
+        {
+            return BoxFilter(width, height, p_width, p_height, [&](int x, int y, int *out_sum)
+            {
+                const uchar *chroma = plane1 + (y / 2) * stride1 + (x / 2) * 2;
+                out_sum[0] += plane0[y * stride0 + x];
+                out_sum[1] += chroma[p_u];
+                out_sum[2] += chroma[p_v];
+            }, ToRgb);
+        };
+        // Y plane, plus U and V planes at half resolution
+        auto Planar = [&](const uchar *p_u, int p_stride_u, const uchar *p_v, int p_stride_v)
+        {
+            return BoxFilter(width, height, p_width, p_height, [&](int x, int y, int *out_sum)
+            {
+                out_sum[0] += plane0[y * stride0 + x];
+                out_sum[1] += p_u[(y / 2) * p_stride_u + x / 2];
+                out_sum[2] += p_v[(y / 2) * p_stride_v + x / 2];
+            }, ToRgb);
+        };
+        // 2 pixels in 4 bytes: offset of y (for even pixel), u and v
+        auto Packed422 = [&](int p_y, int p_u, int p_v)
+        {
+            return BoxFilter(width, height, p_width, p_height, [&](int x, int y, int *out_sum)
+            {
+                const uchar *pair = plane0 + y * stride0 + (x / 2) * 4;
+                out_sum[0] += pair[p_y + 2 * (x % 2)];
+                out_sum[1] += pair[p_u];
+                out_sum[2] += pair[p_v];
+            }, ToRgb);
+        };
+        switch( p_frame.pixelFormat() )
+        {
+        case QVideoFrameFormat::Format_ARGB8888:
+        case QVideoFrameFormat::Format_XRGB8888:
+            return Packed(1, 2, 3);
+        case QVideoFrameFormat::Format_BGRA8888:
+        case QVideoFrameFormat::Format_BGRX8888:
+            return Packed(2, 1, 0);
+        case QVideoFrameFormat::Format_RGBA8888:
+        case QVideoFrameFormat::Format_RGBX8888:
+            return Packed(0, 1, 2);
+        case QVideoFrameFormat::Format_ABGR8888:
+        case QVideoFrameFormat::Format_XBGR8888:
+            return Packed(3, 2, 1);
+        case QVideoFrameFormat::Format_NV12:
+            return plane1 ? SemiPlanar(0, 1) : QImage{};
+        case QVideoFrameFormat::Format_NV21:
+            return plane1 ? SemiPlanar(1, 0) : QImage{};
+        case QVideoFrameFormat::Format_YUV420P:
+            return plane2 ? Planar(plane1, stride1, plane2, stride2) : QImage{};
+        case QVideoFrameFormat::Format_YV12:
+            return plane2 ? Planar(plane2, stride2, plane1, stride1) : QImage{};
+        case QVideoFrameFormat::Format_YUYV:
+            return Packed422(0, 1, 3);
+        case QVideoFrameFormat::Format_UYVY:
+            return Packed422(1, 0, 2);
+        default:
+            return QImage{};
+        }
+    }
+
+
+
+    // Box filter: for each destination pixel p_add_pixel(x, y, sum) adds the 3 components
+    // of each source pixel covering it; p_to_rgb converts their averages.
+    template <class TAddPixel, class TToRgb>
+    static QImage BoxFilter(int p_src_width, int p_src_height, int p_width, int p_height, TAddPixel p_add_pixel, TToRgb p_to_rgb)
+    {
+        QImage image(p_width, p_height, QImage::Format_RGB32);
+        for (int y = 0; y < p_height; y++)
+        {
+            int y0 = y * p_src_height / p_height;
+            int y1 = std::max(y0 + 1, (y + 1) * p_src_height / p_height);
+            QRgb *line = reinterpret_cast<QRgb *>(image.scanLine(y));
+            for (int x = 0; x < p_width; x++)
+            {
+                int x0 = x * p_src_width / p_width;
+                int x1 = std::max(x0 + 1, (x + 1) * p_src_width / p_width);
+                int sum[3] = {};
+                for (int sy = y0; sy < y1; sy++)
+                {
+                    for (int sx = x0; sx < x1; sx++)
+                    {
+                        p_add_pixel(sx, sy, sum);
+                    }
+                }
+                int count = (y1 - y0) * (x1 - x0);
+                line[x] = p_to_rgb(sum[0] / count, sum[1] / count, sum[2] / count);
+            }
+        }
+        return image;
+    }
+
+
+
+    // BT.601 (SD) or BT.709 (HD); video range (16-235) unless full range.
+    static QRgb YuvToRgb(int p_y, int p_u, int p_v, bool p_bt709, bool p_full_range)
+    {
+        double y  = p_full_range ? p_y : (p_y - 16) * 255.0 / 219.0;
+        double cb = (p_u - 128) * (p_full_range ? 1.0 : 255.0 / 224.0);
+        double cr = (p_v - 128) * (p_full_range ? 1.0 : 255.0 / 224.0);
+        double r  = p_bt709 ? y + 1.5748 * cr                 : y + 1.402 * cr;
+        double g  = p_bt709 ? y - 0.1873 * cb - 0.4681 * cr  : y - 0.3441 * cb - 0.7141 * cr;
+        double b  = p_bt709 ? y + 1.8556 * cb                 : y + 1.772 * cb;
+        auto Clamp = [](double p_value)
+        {
+            return std::clamp(int(p_value + 0.5), 0, 255);
+        };
+        return qRgb(Clamp(r), Clamp(g), Clamp(b));
+    }
+
 private:
     bool                        m_auto_repeat = true;
     Video *                     m_this;
@@ -196,9 +375,9 @@ bool Video::IsPlaying() const
 
 
 
-QImage Video::GetImage() const
+QImage Video::GetImage(int p_width, int p_height) const
 {
-    return m_pimpl->GetImage();
+    return m_pimpl->GetImage(p_width, p_height);
 }
 
 
@@ -41,8 +41,10 @@ public:
 
     bool IsPlaying() const;
 
-    /// Get last frame as QImage
-    QImage GetImage() const;
+    /// Get last frame as QImage, scaled to given (small) size.
+    /// Scaled straight from the frame as received (eg YUV), the full frame
+    /// is not converted.
+    QImage GetImage(int p_width, int p_height) const;
 signals:
     // A new frame is present.
     void FrameReceived();
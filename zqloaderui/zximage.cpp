@@ -11,10 +11,14 @@
 #include "zximage.h"
 #include "spectrum_consts.h"
 #include "spectrum_screen.h"
-#include <span>
-#include "color_distance.h"
+#include "screenconverter.h"
 #include <mutex>
+#include <future>
+#include <deque>
+#include <map>
 #include <QPainter>
+#include <QFile>
+#include <QCryptographicHash>
 #include <iostream>
 #include "tools.h"
 
@@ -24,30 +28,18 @@ namespace fs = std::filesystem;
 
 
 
-// color categories
-using enum spectrum::screen::PaletteColor;
-
-// Spectrum colors considered 'dark'
-constexpr int spectrum_dark_colors[] = { black , blue, red };
-// Spectrum colors considered 'light'
-constexpr int spectrum_light_colors[] = { green, cyan, yellow, white, br_green, br_cyan, br_yellow, br_white};
-
-constexpr int spectrum_gray_colors[] = { black, white, br_black, br_white };
-
-
-using Attributes = std::vector<spectrum::screen::Attr>;
-
-
-struct AlgorithmParameters
-{
-    bool m_use_distance_to_black_white = true;
-    bool m_use_floyd_steinberg = true;
-    std::span<const int> m_dark_colors = spectrum_dark_colors;
-    std::span<const int> m_light_colors = spectrum_light_colors;
-};
-
 class ZxImage::Impl
 {
+    // An image as converted.
+    struct Slide
+    {
+        QImage                   m_image;       // scaled to 256x192, as converted, to show
+        spectrum::screen::Screen m_screen;
+    };
+    using SlidePtr = std::shared_ptr<const Slide>;
+
+    static constexpr size_t prefetch_count = 4;         // images converted ahead
+    static constexpr size_t max_cached     = 256;       // converted images kept
 
 public:
 
@@ -55,7 +47,10 @@ public:
         m_this(p_this)
     {}
 
-
+    ~Impl()
+    {
+        m_prefetch.clear();         // waits for conversions running
+    }
 
 
     void paintEvent(QPaintEvent*)
@@ -63,13 +58,12 @@ public:
 
         QPainter painter(m_this);
         std::unique_lock lock(m_mutex);
-        if (!m_image.isNull())
+        if (m_slide && !m_slide->m_image.isNull())
         {
             auto w = 2 * spectrum::screen::SCREEN_WIDTH;
             auto h = 2 * spectrum::screen::SCREEN_HEIGHT;
-//            painter.drawImage(0, 0, m_image.scaled(w, h, Qt::KeepAspectRatioByExpanding));              // draw the original image
-            painter.drawImage(0, 0, CenterScale(m_image, w, h));              // draw the original image
-            painter.drawImage(w, 0, SpectrumScreenToImage(m_screen).scaled(w, h));
+            painter.drawImage(0, 0, m_slide->m_image.scaled(w, h));              // draw the original image
+            painter.drawImage(w, 0, SpectrumScreenToImage(m_slide->m_screen).scaled(w, h));
         }
     }
 
@@ -78,47 +72,46 @@ public:
 
     void SetDirectory(const fs::path &p_dir)
     {
-        std::unique_lock lock(m_mutex);
-        m_index = 0;
-        m_filenames.clear();
+        std::vector<fs::path> filenames;
         for (fs::path filename : fs::directory_iterator{p_dir})
         {
             if(ToLower(filename.extension().string()) == ".png" || ToLower(filename.extension().string()) == ".jpg")
             {
-                m_filenames.push_back(std::move(filename));
+                filenames.push_back(std::move(filename));
             }
         }
-        if(m_filenames.size() == 0)
+        if(filenames.size() == 0)
         {
             throw std::runtime_error("No image (.png/.jpg) filenames found at directory: " + p_dir.string());
         }
+        std::unique_lock lock(m_mutex);
+        m_prefetch.clear();         // waits for conversions running
+        m_filenames = std::move(filenames);
+        m_index = 0;
+        Prefetch();
     }
 
     // Runs in miniaudio thread
-    // Return spectrum screen that can be sent as data to Spectrum
+    // Return spectrum screen that can be sent as data to Spectrum.
+    // Normally already converted by a worker. Never waits: when the next one is not
+    // ready yet, returns the current one again (blank screen when none yet).
+    // Reference valid until next call.
     const spectrum::screen::Screen &LoadNext()
     {
-        fs::path image_filename;
+        std::unique_lock lock(m_mutex);
+        Prefetch();
+        if (m_prefetch.empty() || m_prefetch.front().wait_for(std::chrono::seconds(0)) != std::future_status::ready)
         {
-            std::unique_lock lock(m_mutex);
-            image_filename = m_filenames[m_index];
-            m_index++;
-            if(m_index >= m_filenames.size())
-            {
-                m_index = 0;
-            }
+            return m_slide ? m_slide->m_screen : m_blank;
         }
-        QImage image(QString::fromStdString(image_filename.string()));
-        AlgorithmParameters how;
-        auto screen =  ImageToSpectrumScreen(image, how);
-
+        m_slide = m_prefetch.front().get();
+        m_prefetch.pop_front();
+        Prefetch();
+        QMetaObject::invokeMethod(m_this, [this]
         {
-            std::unique_lock lock(m_mutex);
-            m_image = std::move(image);
-            m_screen = std::move(screen);
-        }
-        m_this->update();       // -> paintEvent
-        return m_screen;
+            m_this->update();       // -> paintEvent, at ui thread
+        });
+        return m_slide->m_screen;
     }
 
 
@@ -127,73 +120,16 @@ public:
 
     /// Convert given QImage to spectrum screen
     /// Can run in miniaudio thread
-    static spectrum::screen::Screen ImageToSpectrumScreen(const QImage &p_image, AlgorithmParameters p_how)
+    static spectrum::screen::Screen ImageToSpectrumScreen(const QImage &p_image, const ScreenConverter &p_how)
     {
-        spectrum::screen::Screen spectrum_screen;
         // 1) Scale down to spectrum resolution (256x192)
         QImage image256x192 = CenterScale(p_image, spectrum::screen::SCREEN_WIDTH, spectrum::screen::SCREEN_HEIGHT);
-
-        // 2) Determine color attribute using the scaled image
-        for (int attry = 0; attry < 24; attry++)
-        {
-            for (int attrx = 0; attrx < 32; attrx++)
-            {
-                spectrum::screen::Attr attr = DetermineAttributeForCell(image256x192, attrx, attry, p_how);
-                //attr.attr.ink = spectrum::Screen::AttributeColor::black;
-                //attr.attr.paper = spectrum::Screen::AttributeColor::white;
-                spectrum_screen.SetAttribute(attrx, attry, attr);
-            }
-        }
-
-
-        QImage image256x192gray = image256x192.convertToFormat(QImage::Format_Grayscale8);    // to gray
-        //image256x192gray = image256x192gray.convertToFormat(QImage::Format_RGB32);    // needed?
-        auto formt = image256x192.format();
-        if (formt != QImage::Format_RGB32)
+        if (image256x192.format() != QImage::Format_RGB32)
         {
             image256x192 = image256x192.convertToFormat(QImage::Format_RGB32);
         }
-
-
-
-        QImage &image = p_how.m_use_distance_to_black_white ? image256x192gray : image256x192;
-        QRgb color_paper;
-        QRgb color_ink;
-
-        // Writing pixels. Optional with Floyd–Steinberg dithering
-        for (int y = 0; y < spectrum::screen::SCREEN_HEIGHT; y++)
-        {
-            for (int x = 0; x < spectrum::screen::SCREEN_WIDTH; x++)
-            {
-                if(p_how.m_use_distance_to_black_white)
-                {
-                    // using distance to black/white
-                    color_ink = 0x000000;
-                    color_paper = 0xffffff;
-                }
-                else
-                {
-                    // using distance to (earlier determined) attribute colors
-                    auto attr = spectrum_screen.GetAttribute(x/8, y/8);
-                    color_ink = spectrum::screen::AttrInkToRgbColor(attr);
-                    color_paper = spectrum::screen::AttrPaperToRgbColor(attr);
-                }
-
-                QRgb oldcolor = image.pixel(x, y);
-                auto dist_to_ink   = ColorDistanceRgb(oldcolor, color_ink);
-                auto dist_to_paper = ColorDistanceRgb(oldcolor, color_paper);
-                bool is_ink = dist_to_ink < dist_to_paper;
-                // not needed image.setPixel(x, y, newcolor);
-                if(p_how.m_use_floyd_steinberg)
-                {
-                    QRgb newcolor = is_ink ? color_ink : color_paper;
-                    SetFloydSteinbergColor4(image, x, y, oldcolor, newcolor);
-                }
-                spectrum_screen.SetPixel(x, y, is_ink);         // write to spectrum screen itself
-            }
-        }
-
-        return spectrum_screen;
+        // 2) Determine color attributes and pixels, at raw scanlines
+        return p_how.Run(reinterpret_cast<const Rgb *>(image256x192.constBits()), int(image256x192.bytesPerLine() / sizeof(Rgb)));
     }
 
     /// Convert given spectrum screen to a QImage.
@@ -216,166 +152,66 @@ public:
 
 private:
 
-
-
-
-
-    // p_attr_x,  p_attr_y are attribute (32x24) coordinates thus corresponding to top left pixel
-    // (as QRgb) of an 8x8 cell at a QImage.
-    // For each 8x8 (=64) pixels of that cell determine:
-    // nearest spectrum color considered dark and nearest spectrum color considered light
-    // and count them both. Lower distances to nearest color count heavier.
-    // Then find the indexes for the most used spectrum color considered dark and light,
-    // return those as spectrum attibute: dark for ink and light for paper.
-    // The used the light color also determines bright flag.
-    // (At spectrum bright flag has barely effect on dark colors).
-    static spectrum::screen::Attr DetermineAttributeForCell(const QImage &p_image, int p_attr_x, int p_attr_y, AlgorithmParameters p_how)
+    // Start converting next images (wrapping) at worker threads, up to prefetch_count ahead.
+    // Call with m_mutex locked.
+    void Prefetch()
     {
-        int count_dark[16]{};
-        int count_light[16]{};
-
-        for(int y = 0; y < 8; y++)
+        while (m_prefetch.size() < prefetch_count && !m_filenames.empty())
         {
-            for(int x = 0; x < 8; x++)
+            fs::path filename = m_filenames[m_index];
+            m_index = (m_index + 1) % m_filenames.size();
+            m_prefetch.push_back(std::async(std::launch::async, [this, filename]
             {
-                QRgb rgb = p_image.pixel(p_attr_x * 8 + x, p_attr_y * 8 + y);
-                if(IsAlmostGray(rgb))
-                {
-                    auto [dist_dark,  index_dark]  = GetNearestColor(rgb, spectrum::screen::palette, {black});
-                    auto [dist_light, index_light] = GetNearestColor(rgb, spectrum::screen::palette, {white, br_white});
-                    count_dark [index_dark]       += (( 256 * 256 * 3 ) - dist_dark );
-                    count_light[index_light]      += (( 256 * 256 * 3 ) - dist_light );
-                }
-                else if(IsAlmostSkin(rgb))
-                {
-                    auto [dist_dark,  index_dark]  = GetNearestColor(rgb, spectrum::screen::palette, p_how.m_dark_colors);
-                    auto [dist_light, index_light] = GetNearestColor(rgb, spectrum::screen::palette, { white, br_white});
-                    count_dark [index_dark]       += (( 256 * 256 * 3 ) - dist_dark );
-                    count_light[index_light]      += (( 256 * 256 * 3 ) - dist_light );
-                }
-                else
-                {
-                    auto [dist_dark,  index_dark]  = GetNearestColor(rgb, spectrum::screen::palette, p_how.m_dark_colors);
-                    auto [dist_light, index_light] = GetNearestColor(rgb, spectrum::screen::palette, p_how.m_light_colors);
-                    count_dark [index_dark]       += (( 256 * 256 * 3 ) - dist_dark );
-                    count_light[index_light]      += (( 256 * 256 * 3 ) - dist_light );
-                }
-            }
+                return Convert(filename);
+            }));
         }
-
-        auto FindMax = [](const int p_values[])
-        {
-            int idx_max    = 0;
-            int idx_2ndmax = -1;
-
-            for (int i = 1; i < 16; i++)
-            {
-                if (p_values[i] >= p_values[idx_max])
-                {
-                    idx_2ndmax = idx_max;
-                    idx_max    = i;
-                }
-                else if (idx_2ndmax == -1 || p_values[i] > p_values[idx_2ndmax])
-                {
-                    idx_2ndmax = i;
-                }
-            }
-            return std::pair<int, int>{idx_max, idx_2ndmax};
-        };
-
-        auto dark_color = FindMax(count_dark).first;     // black, blue, red so 0, 1 or 2
-        auto light_color = FindMax(count_light).first;    // so magenta(3) -- bright white (15)
-        spectrum::screen::Attr attr{};
-        attr.attr.ink    = static_cast<spectrum::screen::Attr::Color>(dark_color % 8);
-        attr.attr.paper  = static_cast<spectrum::screen::Attr::Color>(light_color % 8);
-        attr.attr.bright = light_color > 8;
-        return attr;
     }
 
-
-
-    // p_attr_x,  p_attr_y are attribute (32x24) coordinates thus corresponding to top left pixel
-    // (as QRgb) of an 8x8 cell at a QImage.
-    // For each 8x8 (=64) pixels of that cell determine:
-    // nearest spectrum color considered dark and nearest spectrum color considered light
-    // and count them both. Lower distances to nearest color count heavier.
-    // Then find the indexes for the most used spectrum color considered dark and light,
-    // return those as spectrum attibute: dark for ink and light for paper.
-    // The used the light color also determines bright flag.
-    // (At spectrum bright flag has barely effect on dark colors).
-    static spectrum::screen::Attr DetermineAttributeForCell2(const QImage &p_image, int p_attr_x, int p_attr_y, AlgorithmParameters p_how)
+    // Runs at worker thread.
+    // Read, decode and convert given image file; or take it from cache when its content
+    // was converted before (eg at previous round).
+    // Does not throw: shows error and gives empty screen.
+    SlidePtr Convert(const fs::path &p_filename)
     {
-        int count_all[16]{};
-        int cnt_bright = 0;
-        // determine bright
-        for(int y = 0; y < 8; y++)
+        QFile file(QString::fromStdString(p_filename.string()));
+        QByteArray data;
+        if (file.open(QIODevice::ReadOnly))
         {
-            for(int x = 0; x < 8; x++)
-            {
-                QRgb rgb = p_image.pixel(p_attr_x * 8 + x, p_attr_y * 8 + y);
-                auto [dummy,  index]  = GetNearestColor(rgb, spectrum::screen::palette);
-                if(index >= br_black)
-                {
-                    cnt_bright++;
-                }
-             }
+            data = file.readAll();
         }
-        bool is_bright = cnt_bright > 32;   // more than half
-
-
-
-        for(int y = 0; y < 8; y++)
+        QByteArray key = QCryptographicHash::hash(data, QCryptographicHash::Sha1);
         {
-            for(int x = 0; x < 8; x++)
+            std::unique_lock lock(m_cache_mutex);
+            auto found = m_cache.find(key);
+            if (found != m_cache.end())
             {
-                QRgb rgb = p_image.pixel(p_attr_x * 8 + x, p_attr_y * 8 + y);
-                if(IsAlmostGray(rgb))
-                {
-                    constexpr int gray_bright_colors[] = { br_black, br_white };
-                    constexpr int gray_normal_colors[] = { black, white};
-                    auto [dist_all,  index_all]  = GetNearestColor(rgb, spectrum::screen::palette, is_bright ? gray_bright_colors : gray_normal_colors);
-                    count_all [index_all]       += (( 256 * 256 * 3 ) - dist_all );
-
-                }
-                else
-                {
-                    constexpr int normal_colors[] = { black, blue, red, magenta, green, cyan, yellow, white };
-                    constexpr int bright_colors[] = { br_black, br_blue, br_red, br_magenta, br_green, br_cyan, br_yellow, br_white };
-                    auto [dist_all,  index_all]  = GetNearestColor(rgb, spectrum::screen::palette, is_bright ? bright_colors : normal_colors);
-                    count_all [index_all]        = (( 256 * 256 * 3 ) - dist_all );
-                }
+                return found->second;
             }
         }
-
-        auto FindMax = [](const int p_values[])
+        auto slide = std::make_shared<Slide>();
+        QImage image = QImage::fromData(data);
+        if (image.isNull())
         {
-            int idx_max    = 0;
-            int idx_2ndmax = -1;
-
-            for (int i = 1; i < 16; i++)
-            {
-                if (p_values[i] >= p_values[idx_max])
-                {
-                    idx_2ndmax = idx_max;
-                    idx_max    = i;
-                }
-                else if (idx_2ndmax == -1 || p_values[i] > p_values[idx_2ndmax])
-                {
-                    idx_2ndmax = i;
-                }
-            }
-            return std::pair<int, int>{idx_max, idx_2ndmax};
-        };
-
-        auto [dark_color, light_color]  = FindMax(count_all);
-        spectrum::screen::Attr attr{};
-        attr.attr.ink    = static_cast<spectrum::screen::Attr::Color>(dark_color % 8);
-        attr.attr.paper  = static_cast<spectrum::screen::Attr::Color>(light_color % 8);
-        attr.attr.bright = is_bright;
-        return attr;
+            std::cout << "Could not load image: " << p_filename << std::endl;
+            return slide;
+        }
+        ScreenConverter how;
+        how.SetThreadCount(1);              // images are converted in parallel instead
+        slide->m_image  = CenterScale(image, spectrum::screen::SCREEN_WIDTH, spectrum::screen::SCREEN_HEIGHT);
+        slide->m_screen = ImageToSpectrumScreen(slide->m_image, how);
+        std::unique_lock lock(m_cache_mutex);
+        if (m_cache.size() >= max_cached)
+        {
+            m_cache.erase(m_cache_order.front());
+            m_cache_order.pop_front();
+        }
+        if (m_cache.emplace(key, slide).second)
+        {
+            m_cache_order.push_back(key);
+        }
+        return slide;
     }
 
-
     // scale centered, keep aspect ratio, crop sides.
     static QImage CenterScale(const QImage &p_image, int w, int h)
     {
@@ -391,46 +227,17 @@ private:
         return scaled.copy(x, y, w, h);
     }
 
-    // Set floyd-steinberg color
-    static void SetFloydSteinbergColor(QImage &p_image, int x, int y, int p_red_error, int p_green_error, int p_blue_error, int p_factor)
-    {
-        QRgb sample = p_image.pixel(x, y);
-        auto r     = qRed(sample)   + (p_red_error   * p_factor) / 16;
-        auto g     = qGreen(sample) + (p_green_error * p_factor) / 16;
-        auto b     = qBlue(sample)  + (p_blue_error  * p_factor) / 16;
-        p_image.setPixel(x, y, qRgb(r, g, b));
-    }
-
-    static void SetFloydSteinbergColor4(QImage &p_image, int x, int y, unsigned int oldcolor, unsigned int newcolor)
-    {
-        int error_r = qRed(oldcolor) - qRed(newcolor);
-        int error_g = qGreen(oldcolor) - qGreen(newcolor);
-        int error_b = qBlue(oldcolor) - qBlue(newcolor);
-        if (x < (p_image.width() - 1))
-        {
-            SetFloydSteinbergColor(p_image, x + 1, y,     error_r, error_g, error_b, 7);     // right
-        }
-        if (x > 0 && y < (p_image.height() - 1))
-        {
-            SetFloydSteinbergColor(p_image, x - 1, y + 1, error_r, error_g, error_b, 3); // left below
-        }
-        if (y < (p_image.height() - 1))
-        {
-            SetFloydSteinbergColor(p_image, x,     y + 1, error_r, error_g, error_b, 5);     // below
-        }
-        if (x < (p_image.width() - 1) && y <  (p_image.height() - 1))
-        {
-            SetFloydSteinbergColor(p_image, x + 1, y + 1, error_r, error_g, error_b, 1);     // below right
-        }
-    }
-
 private:
     std::vector<fs::path> m_filenames;
-    int m_index = 0;
+    size_t m_index = 0;                 // next to prefetch
     ZxImage * m_this;
-    QImage    m_image;      // original image as loaded from file
-    spectrum::screen::Screen m_screen;
+    SlidePtr  m_slide;                  // last loaded, to show
+    spectrum::screen::Screen m_blank;   // send while no slide converted yet
     mutable std::mutex m_mutex;
+    std::map<QByteArray, SlidePtr> m_cache;         // by Sha1 of image file content
+    std::deque<QByteArray> m_cache_order;           // oldest first
+    std::mutex m_cache_mutex;
+    std::deque<std::future<SlidePtr>> m_prefetch;   // last: destroyed (waited for) first
 }; // class ZxImage::Impl
 
 
@@ -18,7 +18,11 @@
 #include <QCamera>
 #include <QMediaCaptureSession>
 #include <mutex>
-#include "color_distance.h"
+#include <thread>
+#include <condition_variable>
+#include "screenconverter.h"
+#include "temporalquantizer.h"
+#include "latestvalue.h"
 #include "spectrum_screen.h"
 namespace fs = std::filesystem;
 
@@ -35,46 +39,97 @@ public:
         {
             {
                 auto [width, height] = GetWidthAndHeight(m_width_and_height);
-                QImage image =  m_video.GetImage().scaled(width, height,
-                              Qt::IgnoreAspectRatio,
-                              Qt::FastTransformation);
+                QImage image = m_video.GetImage(width, height);      // scaled straight from frame
                 std::unique_lock lock(m_image_mutex);
-                m_image = image;
+                m_image        = image;
+                m_capture_time = std::chrono::steady_clock::now();
+                m_new_image    = true;
             }
-            m_this->update();       // -> paintEvent
+            m_image_cv.notify_one();        // -> ConvertLoop
+        });
+        m_convert_thread = std::thread([this]
+        {
+            ConvertLoop();
         });
     }
+
+    ~Impl()
+    {
+        {
+            std::unique_lock lock(m_image_mutex);
+            m_stop = true;
+        }
+        m_image_cv.notify_one();
+        m_convert_thread.join();
+    }
  
     void paintEvent(QPaintEvent* )  
     {
         QPainter painter(m_this);
-        if (!m_image.isNull()) 
+        QImage image;
+        QImage image_attr;
+        {
+            std::unique_lock lock(m_image_mutex);
+            image      = m_image;
+            image_attr = m_image_attr;
+        }
+        if (!image.isNull() && !image_attr.isNull())
         {
-            auto w = m_image.width() * 4;
-            auto h = m_image.height() * 8;
-            painter.drawImage(0, 0, m_video.GetImage().scaled(w, h));   // draw the original image
-            painter.drawImage(w, 0, m_image.scaled(w, h));              // draw the image at spectrum resolution
-            auto image_attr = AttrToImage(m_width_and_height, ImageToAttr(m_image));
+            auto w = image.width() * 4;
+            auto h = image.height() * 8;
+            painter.drawImage(0, 0, m_video.GetImage(w, h));            // draw the original image
+            painter.drawImage(w, 0, image.scaled(w, h));                // draw the image at spectrum resolution
             painter.drawImage(2 * w, 0,  image_attr.scaled(w, h));      // draw the spectrum image at (w,0)
         }
     }
 
     // Runs in miniaudio thread
-    Attributes GetAttributes() const
+    // Only takes the frame as already converted by ConvertLoop, so never waits.
+    // Empty when no frame converted yet.
+    // Reference valid until next call.
+    const VideoFrame &GetFrame() const
     {
-        QImage image;
-        {
-            std::unique_lock lock(m_image_mutex);
-            image = m_image;
-        }
-        if(!image.isNull())
+        return m_frame.Get();
+    }
+
+private:
+
+    // Runs in m_convert_thread.
+    // Converts each new frame (as scaled at m_image) to attributes, publishes it
+    // at m_frame for the miniaudio thread. When frames come in faster than they
+    // can be converted, only the latest is converted.
+    void ConvertLoop()
+    {
+        std::unique_lock lock(m_image_mutex);
+        while (true)
         {
-            return ImageToAttr(image);
+            m_image_cv.wait(lock, [this]
+            {
+                return m_new_image || m_stop;
+            });
+            if (m_stop)
+            {
+                break;
+            }
+            QImage image = m_image;
+            auto capture_time = m_capture_time;
+            auto width_and_height = m_width_and_height;
+            m_new_image = false;
+            lock.unlock();
+
+            Attributes attributes = ImageToAttr(image);
+            QImage image_attr = AttrToImage(width_and_height, attributes);
+            m_frame.Set({ std::move(attributes), capture_time });
+
+            lock.lock();
+            m_image_attr = std::move(image_attr);
+            QMetaObject::invokeMethod(m_this, [this]
+            {
+                m_this->update();       // -> paintEvent, at ui thread
+            });
         }
-        return {};
     }
 
-private:
     static std::pair<int, int> GetWidthAndHeight(WidthAndHeight p_width_and_height)
     {
         switch(p_width_and_height)
@@ -190,8 +245,9 @@ private:
     
     // Get zx spectrum attribute array for image, can be sent to ZX Spectrum.
     // given image must be 32x48 or 64x24
-    // Can run in miniaudio thread
-    static Attributes ImageToAttr(QImage p_image)
+    // Runs in m_convert_thread: cells only change when the image really did,
+    // see TemporalQuantizer.
+    Attributes ImageToAttr(QImage p_image)
     {
         auto formt = p_image.format();
         if (formt != QImage::Format_RGB32)
@@ -199,70 +255,10 @@ private:
             p_image = p_image.convertToFormat(QImage::Format_RGB32);
         }
         p_image = NormalizeContrast(p_image);
-        int width = p_image.width();
-        int height = p_image.height();
-        const auto* data = p_image.bits();
-        auto bytesPerLine = p_image.bytesPerLine();
-        Attributes attribs;
-
-        if(height == 48)
-        {
-            for (int y = 0; y < height; y+=2) 
-            {
-                const QRgb* row1 = reinterpret_cast<const QRgb*>(data + y     * bytesPerLine);
-                const QRgb* row2 = reinterpret_cast<const QRgb*>(data + (y+1) * bytesPerLine);
-                for (int x = 0; x < width; ++x) 
-                {
-                    QRgb color_paper = row1[x];
-                    QRgb color_ink = row2[x];
-                    auto attr = GetSpectrumAttribute(color_paper, color_ink);
-                    attribs.push_back(attr);
-                }
-            }
-        }
-        else
-        {
-            for (int y = 0; y < height; y++) 
-            {
-                const QRgb* row = reinterpret_cast<const QRgb*>(data + y     * bytesPerLine);
-                for (int x = 0; x < width; x+=2) 
-                {
-                    QRgb color_paper = row[x];      // paper first
-                    QRgb color_ink = row[x + 1];
-                    auto attr = GetSpectrumAttribute(color_paper, color_ink);
-                    attribs.push_back(attr);
-                }
-            }
-        }
-        return attribs;
-    }
-
-
-    // Color attr:
-    // F  B  P2 P1 P0 I2 I1 I0
-    static spectrum::screen::Attr GetSpectrumAttribute(QRgb p_color_paper, QRgb p_color_ink)
-    {
-
-        using enum spectrum::screen::PaletteColor;
-        constexpr int spectrum_normal_colors[] = { black, blue, red, magenta, green, cyan, yellow, white };
-        constexpr int spectrum_bright_colors[] = { br_black, br_blue, br_red, br_magenta, br_green, br_cyan, br_yellow, br_white };
-
-
-        auto [mindist_norm_paper,   found_norm_paper]   = GetNearestColor(p_color_paper, spectrum::screen::palette,  spectrum_normal_colors);
-        auto [mindist_bright_paper, found_bright_paper] = GetNearestColor(p_color_paper, spectrum::screen::palette,  spectrum_bright_colors);
-        auto [mindist_norm_ink,     found_norm_ink]     = GetNearestColor(p_color_ink,   spectrum::screen::palette,  spectrum_normal_colors);
-        auto [mindist_bright_ink,   found_bright_ink]   = GetNearestColor(p_color_ink,   spectrum::screen::palette,  spectrum_bright_colors);
-        bool use_bright = (mindist_bright_ink + mindist_bright_paper) < (mindist_norm_ink + mindist_norm_paper);
-        //std::uint8_t retval;        // can you do anything usefull with std::byte ;-(
-        //retval = use_bright ? 0b01000000 : 0;       
-        //retval |= (use_bright ? found_bright_paper : found_norm_paper) << 3;
-        //retval |= (use_bright ? found_bright_ink : found_norm_ink);
-        spectrum::screen::Attr retval{};
-        retval.attr.bright = use_bright;
-        retval.attr.paper  = static_cast<spectrum::screen::Attr::Color>(use_bright ? found_bright_paper - 8 : found_norm_paper);
-        retval.attr.ink    = static_cast<spectrum::screen::Attr::Color>(use_bright ? found_bright_ink - 8 : found_norm_ink);
-        retval.attr.flash = 0;
-        return retval;
+        auto pixels = reinterpret_cast<const Rgb*>(p_image.constBits());
+        int stride  = int(p_image.bytesPerLine() / sizeof(Rgb));
+        auto attributes = ScreenConverter().RunBars(pixels, p_image.width(), p_image.height(), stride);
+        return m_temporal_quantizer.Run(pixels, p_image.width(), p_image.height(), stride, attributes);
     }
 
 public:
@@ -271,7 +267,15 @@ public:
 private:
     ZxVideo *m_this;
     QImage m_image;         // image resulution is 64x24 or 32x48 depending on m_width_and_height
+    std::chrono::steady_clock::time_point m_capture_time;      // of m_image
+    QImage m_image_attr;    // attributes as last converted from m_image, to show
+    bool m_new_image = false;
+    bool m_stop = false;
     mutable std::mutex m_image_mutex;
+    std::condition_variable m_image_cv;
+    TemporalQuantizer m_temporal_quantizer;             // owned by m_convert_thread
+    mutable LatestValue<VideoFrame> m_frame;            // from m_convert_thread to miniaudio thread
+    std::thread m_convert_thread;
 };
 
 
@@ -292,9 +296,9 @@ void ZxVideo::paintEvent(QPaintEvent* event)
     m_pimpl->paintEvent(event);
 }
 
-Attributes ZxVideo::GetAttributes() const
+const VideoFrame &ZxVideo::GetFrame() const
 {
-    return m_pimpl->GetAttributes();
+    return m_pimpl->GetFrame();
 }
 
 ZxVideo &ZxVideo::SetWidthAndHeight(WidthAndHeight p_width_and_height)
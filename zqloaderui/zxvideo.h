@@ -15,6 +15,7 @@
 
 #include <memory>
 #include <vector>
+#include <chrono>
 #include <QWidget>
 #include "spectrum_screen.h"
 
@@ -26,6 +27,15 @@ class QPaintEvent;
 //using ColorAttr = std::byte;
 using Attributes = std::vector<spectrum::screen::Attr> ;
 
+/// Latest converted video frame, with the time it was captured.
+/// (Capturing live, all frames are older than when a frame send now gets visible, so
+/// the latest is always the nearest: no use keeping older ones, see FrameScheduler.)
+struct VideoFrame
+{
+    Attributes                            m_attributes;
+    std::chrono::steady_clock::time_point m_capture_time;
+};
+
 // By using horizontal or vertical blocks the spectrum can show these
 // resulutions without color clash. ZQLoader only needs to send attribute blocks.
 enum WidthAndHeight
@@ -43,7 +53,9 @@ public:
     ~ZxVideo();
 
     void paintEvent(QPaintEvent* event) override;
-    Attributes GetAttributes() const;
+    /// Latest video frame, as converted at a worker thread.
+    /// Can be called from miniaudio thread, does not wait.
+    const VideoFrame &GetFrame() const;
     ZxVideo &SetWidthAndHeight(WidthAndHeight p_width_and_height);
 
     ZxVideo &Play(const std::string &p_url);